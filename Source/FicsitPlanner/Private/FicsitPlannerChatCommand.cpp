@@ -0,0 +1,527 @@
+#include "FicsitPlannerChatCommand.h"
+
+#include "FicsitPlannerEngine.h"
+#include "Command/CommandSender.h"
+#include "Subsystem/SubsystemActorManager.h"
+
+AFicsitPlannerChatCommand::AFicsitPlannerChatCommand()
+{
+	CommandName = TEXT("planner");
+	Usage = NSLOCTEXT("FicsitPlanner", "ChatCommandUsage", "/planner <command> [arguments]");
+	MinNumberOfArguments = 1;
+	bOnlyUsableByPlayer = false;
+}
+
+EExecutionStatus AFicsitPlannerChatCommand::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label)
+{
+	// Get the engine for this world
+	AFicsitPlannerEngine* Engine = GetEngine();
+	if (!Engine)
+	{
+		Sender->SendChatMessage(TEXT("Ficsit Planner is not running in this world!"), FLinearColor::Red);
+		return EExecutionStatus::UNCOMPLETED;
+	}
+
+	const FString Command = Arguments[0].ToLower();
+
+	// pruned ["locked"]
+	if (Command == TEXT("pruned"))
+	{
+		const bool bAllowLockedRecipes = Arguments.Num() > 1 && Arguments[1].Equals(TEXT("locked"), ESearchCase::IgnoreCase);
+		Sender->SendChatMessage(Engine->PrunedRecipesToString(bAllowLockedRecipes));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// export [path]
+	if (Command == TEXT("export"))
+	{
+		const FString Path = Arguments.Num() > 1 ? Arguments[1] : AFicsitPlannerEngine::GetGameDataExportPath();
+		if (!Engine->ExportGameData(Path))
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Failed to export game data to %s!"), *Path), FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(FString::Printf(TEXT("Exported game data to %s"), *Path));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// list
+	if (Command == TEXT("list"))
+	{
+		const TConstArrayView<UFicsitPlannerFactory*> Factories = Engine->GetFactories();
+		const TConstArrayView<int> FactoryIDs = Engine->GetFactoryIDs();
+		FString FactoryList = FString::Printf(TEXT("%d factories:\n"), Factories.Num());
+		for (int i = 0; i < Factories.Num(); i++)
+		{
+			FactoryList += FString::Printf(TEXT("%d: %s"), FactoryIDs[i], *Engine->FactoryPlanToHeaderString(Factories[i]));
+		}
+		Sender->SendChatMessage(FactoryList);
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// mem [FactoryID] / mem budget <KiB> ["evict"]
+	if (Command == TEXT("mem"))
+	{
+		if (Arguments.Num() > 1 && Arguments[1].Equals(TEXT("budget"), ESearchCase::IgnoreCase))
+		{
+			if (Arguments.Num() < 3 || !Arguments[2].IsNumeric())
+			{
+				Sender->SendChatMessage(TEXT("Usage: /planner mem budget <KiB> [evict]"), FLinearColor::Red);
+				return EExecutionStatus::BAD_ARGUMENTS;
+			}
+
+			const bool bEvict = Arguments.Num() > 3 && Arguments[3].Equals(TEXT("evict"), ESearchCase::IgnoreCase);
+			Engine->SetFactoryMemoryBudget(FCString::Atoi64(*Arguments[2]) * 1024, bEvict);
+			Sender->SendChatMessage(Engine->MemoryStatsToString(Engine->GetMemoryStats()));
+			return EExecutionStatus::COMPLETED;
+		}
+
+		if (Arguments.Num() > 1)
+		{
+			const FFicsitPlannerMemoryStats Stats = Engine->GetFactoryMemoryStats(FCString::Atoi(*Arguments[1]));
+			if (!Arguments[1].IsNumeric() || Stats.Factories == 0)
+			{
+				Sender->SendChatMessage(FString::Printf(TEXT("Invalid factory ID %s!"), *Arguments[1]), FLinearColor::Red);
+				return EExecutionStatus::BAD_ARGUMENTS;
+			}
+			Sender->SendChatMessage(Engine->MemoryStatsToString(Stats));
+			return EExecutionStatus::COMPLETED;
+		}
+
+		Sender->SendChatMessage(Engine->MemoryStatsToString(Engine->GetMemoryStats()));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// undo <FactoryID> / redo <FactoryID>
+	if (Command == TEXT("undo") || Command == TEXT("redo"))
+	{
+		if (Arguments.Num() < 2 || !Arguments[1].IsNumeric())
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Usage: /planner %s <FactoryID>"), *Command), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		const int FactoryID = FCString::Atoi(*Arguments[1]);
+		const bool bUndo = Command == TEXT("undo");
+		if (!(bUndo ? Engine->UndoFactory(FactoryID) : Engine->RedoFactory(FactoryID)))
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Nothing to %s for factory %d!"), *Command, FactoryID), FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(Engine->FactoryPlanToHeaderString(Engine->GetFactory(FactoryID)));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// optimal <Quantity> <Item Name>
+	if (Command == TEXT("optimal"))
+	{
+		if (Arguments.Num() < 3 || !Arguments[1].IsNumeric())
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner optimal <Quantity> <Item Name>"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		// Item names may contain spaces
+		const FString ItemName = FString::Join(MakeArrayView(Arguments).Slice(2, Arguments.Num() - 2), TEXT(" ")).TrimQuotes();
+		const TSubclassOf<UFGItemDescriptor> Item = Engine->FindItem(ItemName);
+		if (!Item)
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Unknown item %s!"), *ItemName), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		UFicsitPlannerFactory* Factory = Engine->CreateOptimalFactoryPlan(FItemAmount(Item, FCString::Atoi(*Arguments[1])), false, EFactoryOptimizationType::EFOT_PowerConsumption);
+		const int FactoryID = Factory ? Engine->SaveFactory(Factory) : INDEX_NONE;
+		if (FactoryID == INDEX_NONE)
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Failed to plan %s!"), *ItemName), FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(FString::Printf(TEXT("%d: %s"), FactoryID, *Engine->FactoryPlanToHeaderString(Factory)));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// estimate <Quantity> <Item Name>
+	if (Command == TEXT("estimate"))
+	{
+		if (Arguments.Num() < 3 || !Arguments[1].IsNumeric())
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner estimate <Quantity> <Item Name>"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		// Item names may contain spaces
+		const FString ItemName = FString::Join(MakeArrayView(Arguments).Slice(2, Arguments.Num() - 2), TEXT(" ")).TrimQuotes();
+		const TSubclassOf<UFGItemDescriptor> Item = Engine->FindItem(ItemName);
+		if (!Item)
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Unknown item %s!"), *ItemName), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		// Warn before anyone creates a plan that won't be expanded in full
+		const FFicsitPlannerPlanSizeEstimate Estimate = Engine->EstimateFactoryPlan(FItemAmount(Item, FCString::Atoi(*Arguments[1])), false);
+		const bool bLarge = Estimate.Strategy != EFactoryPlanStrategy::EFPS_Full;
+		Sender->SendChatMessage(FString::Printf(TEXT("%s: %s"), *ItemName, *Engine->PlanEstimateToString(Estimate)), bLarge ? FLinearColor::Yellow : FLinearColor::White);
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// top <K> <Quantity> <Item Name>
+	if (Command == TEXT("top"))
+	{
+		if (Arguments.Num() < 4 || !Arguments[1].IsNumeric() || !Arguments[2].IsNumeric())
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner top <K> <Quantity> <Item Name>"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		// Item names may contain spaces
+		const FString ItemName = FString::Join(MakeArrayView(Arguments).Slice(3, Arguments.Num() - 3), TEXT(" ")).TrimQuotes();
+		const TSubclassOf<UFGItemDescriptor> Item = Engine->FindItem(ItemName);
+		if (!Item)
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Unknown item %s!"), *ItemName), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		// Saved as shared plans, so any of them can be loaded as a factory later
+		FString Ranking;
+		const TArray<int> PlanIDs = Engine->SaveTopSharedPlans(FItemAmount(Item, FCString::Atoi(*Arguments[2])), false, EFactoryOptimizationType::EFOT_PowerConsumption, FCString::Atoi(*Arguments[1]), Ranking);
+		if (PlanIDs.Num() == 0)
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Failed to plan %s!"), *ItemName), FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(Ranking);
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// shared [list] / save <Quantity> <Item Name> / get, clone, load, delete <PlanID> / update <PlanID> <NodeID> <RecipeIndex> / scale <PlanID> <Rate>
+	if (Command == TEXT("shared"))
+	{
+		const FString Action = Arguments.Num() > 1 ? Arguments[1].ToLower() : TEXT("list");
+		if (Action == TEXT("list"))
+		{
+			Sender->SendChatMessage(Engine->SharedPlansToString());
+			return EExecutionStatus::COMPLETED;
+		}
+
+		if (Action == TEXT("save") && Arguments.Num() >= 4 && Arguments[2].IsNumeric())
+		{
+			// Item names may contain spaces
+			const FString ItemName = FString::Join(MakeArrayView(Arguments).Slice(3, Arguments.Num() - 3), TEXT(" ")).TrimQuotes();
+			const TSubclassOf<UFGItemDescriptor> Item = Engine->FindItem(ItemName);
+			const int PlanID = Item ? Engine->SaveSharedPlan(FItemAmount(Item, FCString::Atoi(*Arguments[2])), false, EFactoryOptimizationType::EFOT_PowerConsumption) : INDEX_NONE;
+			if (PlanID == INDEX_NONE)
+			{
+				Sender->SendChatMessage(FString::Printf(TEXT("Failed to plan %s!"), *ItemName), FLinearColor::Red);
+				return EExecutionStatus::UNCOMPLETED;
+			}
+			Sender->SendChatMessage(FString::Printf(TEXT("Saved shared plan %d"), PlanID));
+			return EExecutionStatus::COMPLETED;
+		}
+
+		if (Arguments.Num() < 3 || !Arguments[2].IsNumeric())
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner shared [list / save <Quantity> <Item Name> / get, clone, load, delete <PlanID> / update <PlanID> <NodeID> <RecipeIndex> / scale <PlanID> <Rate>]"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		const int PlanID = FCString::Atoi(*Arguments[2]);
+		bool bDone = false;
+		FString Reply;
+		if (Action == TEXT("get"))
+		{
+			Reply = Engine->SharedPlanToString(PlanID);
+			bDone = Engine->GetAllSharedPlanIDs().Contains(PlanID);
+		}
+		else if (Action == TEXT("clone"))
+		{
+			const int CloneID = Engine->CloneSharedPlan(PlanID);
+			bDone = CloneID != INDEX_NONE;
+			Reply = FString::Printf(TEXT("Cloned shared plan %d as %d"), PlanID, CloneID);
+		}
+		else if (Action == TEXT("load"))
+		{
+			// Expand into a regular saved factory (editable with update, optimize, undo, ...)
+			UFicsitPlannerFactory* Factory = Engine->CreateFactoryFromSharedPlan(PlanID);
+			const int FactoryID = Factory ? Engine->SaveFactory(Factory) : INDEX_NONE;
+			bDone = FactoryID != INDEX_NONE;
+			Reply = FString::Printf(TEXT("Loaded shared plan %d as factory %d"), PlanID, FactoryID);
+		}
+		else if (Action == TEXT("delete"))
+		{
+			bDone = Engine->DeleteSharedPlan(PlanID);
+			Reply = FString::Printf(TEXT("Deleted shared plan %d"), PlanID);
+		}
+		else if (Action == TEXT("update") && Arguments.Num() >= 5 && Arguments[3].IsNumeric() && Arguments[4].IsNumeric())
+		{
+			bDone = Engine->UpdateSharedPlan(PlanID, FCString::Atoi(*Arguments[3]), FCString::Atoi(*Arguments[4]));
+			Reply = FString::Printf(TEXT("Updated shared plan %d"), PlanID);
+		}
+		else if (Action == TEXT("scale") && Arguments.Num() >= 4 && Arguments[3].IsNumeric())
+		{
+			bDone = Engine->ScaleSharedPlan(PlanID, FCString::Atof(*Arguments[3]));
+			Reply = FString::Printf(TEXT("Scaled shared plan %d"), PlanID);
+		}
+		else
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Unknown shared plan command: %s"), *Arguments[1]), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		if (!bDone)
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Failed to %s shared plan %d!"), *Action, PlanID), FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(Reply);
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// exclude [list] / add, remove <"item"/"recipe"/"building"> <Name>
+	if (Command == TEXT("exclude"))
+	{
+		const FString Action = Arguments.Num() > 1 ? Arguments[1].ToLower() : TEXT("list");
+		if (Action == TEXT("list"))
+		{
+			Sender->SendChatMessage(Engine->ExclusionRulesToString());
+			return EExecutionStatus::COMPLETED;
+		}
+
+		const FString Kind = Arguments.Num() > 2 ? Arguments[2].ToLower() : FString();
+		const bool bKnownKind = Kind == TEXT("item") || Kind == TEXT("recipe") || Kind == TEXT("building");
+		if ((Action != TEXT("add") && Action != TEXT("remove")) || !bKnownKind || Arguments.Num() < 4)
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner exclude [list / add <item/recipe/building> <Name> / remove <item/recipe/building> <Name>]"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		const EFactoryExclusionType Type = Kind == TEXT("item") ? EFactoryExclusionType::EFET_Item
+			: Kind == TEXT("recipe") ? EFactoryExclusionType::EFET_Recipe
+			: EFactoryExclusionType::EFET_Building;
+
+		// Items may also be given by display name (which may contain spaces), rules use class names
+		FString Rule = FString::Join(MakeArrayView(Arguments).Slice(3, Arguments.Num() - 3), TEXT(" ")).TrimQuotes();
+		if (Type == EFactoryExclusionType::EFET_Item)
+		{
+			if (const TSubclassOf<UFGItemDescriptor> Item = Engine->FindItem(Rule)) Rule = Item->GetName();
+		}
+
+		const bool bAdd = Action == TEXT("add");
+		if (!(bAdd ? Engine->AddExclusionRule(Type, Rule) : Engine->RemoveExclusionRule(Type, Rule)))
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("%s is %s excluded!"), *Rule, bAdd ? TEXT("already") : TEXT("not")), FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(Engine->ExclusionRulesToString());
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// scale <FactoryID> <Rate>
+	if (Command == TEXT("scale"))
+	{
+		if (Arguments.Num() < 3 || !Arguments[1].IsNumeric() || !Arguments[2].IsNumeric())
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner scale <FactoryID> <Rate>"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		const int FactoryID = FCString::Atoi(*Arguments[1]);
+		if (!Engine->ScaleFactory(FactoryID, FCString::Atof(*Arguments[2])))
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Failed to scale factory %d!"), FactoryID), FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(Engine->FactoryPlanToHeaderString(Engine->GetFactory(FactoryID)));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// queue / queue create <Quantity> <Item Name> ["confirm"] / queue optimize <FactoryID> <"power"/"complexity"/"clock">
+	if (Command == TEXT("queue"))
+	{
+		if (Arguments.Num() < 2)
+		{
+			Sender->SendChatMessage(Engine->JobsToString());
+			return EExecutionStatus::COMPLETED;
+		}
+
+		FFicsitPlannerJobRequest Request;
+		const FString Action = Arguments[1].ToLower();
+		if (Action == TEXT("create") && Arguments.Num() >= 4 && Arguments[2].IsNumeric())
+		{
+			// Item names may contain spaces, a trailing "confirm" creates plans too large to expand node by node
+			Request.bConfirmLargePlan = Arguments.Num() >= 5 && Arguments.Last().Equals(TEXT("confirm"), ESearchCase::IgnoreCase);
+			const int32 NumNameArguments = Arguments.Num() - 3 - (Request.bConfirmLargePlan ? 1 : 0);
+			const FString ItemName = FString::Join(MakeArrayView(Arguments).Slice(3, NumNameArguments), TEXT(" ")).TrimQuotes();
+			const TSubclassOf<UFGItemDescriptor> Item = Engine->FindItem(ItemName);
+			Request.Item = Item ? Engine->GetRecipeIndex().FindItem(Item) : INDEX_NONE;
+			Request.Rate = FCString::Atoi(*Arguments[2]);
+			if (Request.Item == INDEX_NONE || Request.Rate <= 0.0f)
+			{
+				Sender->SendChatMessage(FString::Printf(TEXT("Unknown item %s!"), *ItemName), FLinearColor::Red);
+				return EExecutionStatus::BAD_ARGUMENTS;
+			}
+		}
+		else if (Action == TEXT("optimize") && Arguments.Num() >= 4 && Arguments[2].IsNumeric())
+		{
+			const FString Objective = Arguments[3].ToLower();
+			Request.Type = EFicsitPlannerJobType::Optimize;
+			Request.FactoryID = FCString::Atoi(*Arguments[2]);
+			Request.Optimization = Objective == TEXT("power") ? EFactoryOptimizationType::EFOT_PowerConsumption
+				: Objective == TEXT("complexity") ? EFactoryOptimizationType::EFOT_Complexity
+				: Objective == TEXT("clock") ? EFactoryOptimizationType::EFOT_ClockSpeed
+				: EFactoryOptimizationType::EFOT_None;
+
+			// Target of the saved factory
+			UFicsitPlannerFactory* Factory = Engine->GetFactory(Request.FactoryID);
+			const FItemAmount Product = Factory ? Factory->GetPrimaryProduct() : FItemAmount();
+			Request.Item = Product.ItemClass ? Engine->GetRecipeIndex().FindItem(Product.ItemClass) : INDEX_NONE;
+			Request.Rate = Product.Amount;
+			Request.bAllowLockedRecipes = Factory && Factory->UsesLockedRecipes;
+			Request.bConfirmLargePlan = true;
+			if (Request.Item == INDEX_NONE || Request.Optimization == EFactoryOptimizationType::EFOT_None)
+			{
+				Sender->SendChatMessage(FString::Printf(TEXT("Can't optimize factory %s for %s!"), *Arguments[2], *Arguments[3]), FLinearColor::Red);
+				return EExecutionStatus::BAD_ARGUMENTS;
+			}
+		}
+		else
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner queue [create <Quantity> <Item Name> [confirm] / optimize <FactoryID> <power/complexity/clock>]"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		// Report back once it's done (the sender may be gone by then)
+		TWeakObjectPtr<UCommandSender> WeakSender = Sender;
+		TWeakObjectPtr<AFicsitPlannerEngine> WeakEngine = Engine;
+		const int32 JobID = Engine->EnqueueJob(Request, 0, [WeakSender, WeakEngine](const int32 DoneJobID, const int32 FactoryID)
+		{
+			UCommandSender* DoneSender = WeakSender.Get();
+			AFicsitPlannerEngine* DoneEngine = WeakEngine.Get();
+			if (!DoneSender || !DoneEngine) return;
+
+			if (FactoryID == INDEX_NONE)
+			{
+				DoneSender->SendChatMessage(FString::Printf(TEXT("Job %d failed!"), DoneJobID), FLinearColor::Red);
+				return;
+			}
+			DoneSender->SendChatMessage(FString::Printf(TEXT("Job %d done: %d: %s"), DoneJobID, FactoryID, *DoneEngine->FactoryPlanToHeaderString(DoneEngine->GetFactory(FactoryID))));
+		});
+		Sender->SendChatMessage(FString::Printf(TEXT("Queued as job %d (position %d)"), JobID, Engine->GetJobPosition(JobID)));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// clock <FactoryID> [MaxBuildings] [MaxShards]
+	if (Command == TEXT("clock"))
+	{
+		if (Arguments.Num() < 2 || !Arguments[1].IsNumeric())
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner clock <FactoryID> [MaxBuildings] [MaxShards]"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		const int MaxBuildings = Arguments.Num() > 2 ? FCString::Atoi(*Arguments[2]) : 0;
+		const int MaxShards = Arguments.Num() > 3 ? FCString::Atoi(*Arguments[3]) : 0;
+		Sender->SendChatMessage(Engine->FactoryClockSpeedsToString(FCString::Atoi(*Arguments[1]), MaxBuildings, MaxShards));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// balance <FactoryID>
+	if (Command == TEXT("balance"))
+	{
+		if (Arguments.Num() < 2 || !Arguments[1].IsNumeric())
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner balance <FactoryID>"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		FString Report;
+		const bool bBalanced = Engine->CheckFactoryBalance(FCString::Atoi(*Arguments[1]), Report);
+		Sender->SendChatMessage(Report, bBalanced ? FLinearColor::White : FLinearColor::Yellow);
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// research <FactoryID> ["power"/"complexity"/"raw"] / research <"power"/"complexity"/"raw"> <Quantity> <Item Name>
+	if (Command == TEXT("research"))
+	{
+		const auto ParseMetric = [](const FString& Name, EFactoryResearchMetric& OutMetric)
+		{
+			const FString Metric = Name.ToLower();
+			if (Metric == TEXT("power")) OutMetric = EFactoryResearchMetric::EFRM_Power;
+			else if (Metric == TEXT("complexity")) OutMetric = EFactoryResearchMetric::EFRM_Complexity;
+			else if (Metric == TEXT("raw")) OutMetric = EFactoryResearchMetric::EFRM_RawResources;
+			else return false;
+			return true;
+		};
+
+		EFactoryResearchMetric Metric = EFactoryResearchMetric::EFRM_Power;
+		if (Arguments.Num() >= 2 && Arguments[1].IsNumeric() && (Arguments.Num() < 3 || ParseMetric(Arguments[2], Metric)))
+		{
+			Sender->SendChatMessage(Engine->FactoryResearchToString(FCString::Atoi(*Arguments[1]), Metric));
+			return EExecutionStatus::COMPLETED;
+		}
+
+		if (Arguments.Num() < 4 || !ParseMetric(Arguments[1], Metric) || !Arguments[2].IsNumeric())
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner research <FactoryID> [power/complexity/raw] / <power/complexity/raw> <Quantity> <Item Name>"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		// Item names may contain spaces
+		const FString ItemName = FString::Join(MakeArrayView(Arguments).Slice(3, Arguments.Num() - 3), TEXT(" ")).TrimQuotes();
+		FFicsitPlannerBatchRequest Target;
+		Target.Item = Engine->FindItem(ItemName);
+		Target.Rate = FCString::Atoi(*Arguments[2]);
+		if (!Target.Item)
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Unknown item %s!"), *ItemName), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		Sender->SendChatMessage(Engine->ResearchToString({Target}, Metric));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	// export-plan <FactoryID> ["json"/"csv"] ["bom"] [path]
+	if (Command == TEXT("export-plan"))
+	{
+		if (Arguments.Num() < 2 || !Arguments[1].IsNumeric())
+		{
+			Sender->SendChatMessage(TEXT("Usage: /planner export-plan <FactoryID> [json/csv] [bom] [path]"), FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+
+		const int FactoryID = FCString::Atoi(*Arguments[1]);
+		EFactoryExportFormat Format = EFactoryExportFormat::EFEF_Json;
+		bool bBillOfMaterials = false;
+		FString Path;
+		for (int i = 2; i < Arguments.Num(); i++)
+		{
+			if (Arguments[i].Equals(TEXT("json"), ESearchCase::IgnoreCase)) Format = EFactoryExportFormat::EFEF_Json;
+			else if (Arguments[i].Equals(TEXT("csv"), ESearchCase::IgnoreCase)) Format = EFactoryExportFormat::EFEF_Csv;
+			else if (Arguments[i].Equals(TEXT("bom"), ESearchCase::IgnoreCase)) bBillOfMaterials = true;
+			else Path = Arguments[i];
+		}
+		if (Path.IsEmpty()) Path = AFicsitPlannerEngine::GetFactoryExportPath(FactoryID, Format, bBillOfMaterials);
+
+		if (!Engine->ExportFactory(FactoryID, Path, Format, bBillOfMaterials))
+		{
+			Sender->SendChatMessage(FString::Printf(TEXT("Failed to export factory %d!"), FactoryID), FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(FString::Printf(TEXT("Exported factory %d to %s"), FactoryID, *Path));
+		return EExecutionStatus::COMPLETED;
+	}
+
+	Sender->SendChatMessage(FString::Printf(TEXT("Unknown command: %s"), *Arguments[0]), FLinearColor::Red);
+	return EExecutionStatus::BAD_ARGUMENTS;
+}
+
+AFicsitPlannerEngine* AFicsitPlannerChatCommand::GetEngine() const
+{
+	// The engine is a mod subsystem, look it up through the world's subsystem actor manager
+	const UWorld* World = GetWorld();
+	USubsystemActorManager* SubsystemActorManager = World ? World->GetSubsystem<USubsystemActorManager>() : nullptr;
+	return SubsystemActorManager ? SubsystemActorManager->GetSubsystemActor<AFicsitPlannerEngine>() : nullptr;
+}
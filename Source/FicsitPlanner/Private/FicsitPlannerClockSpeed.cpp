@@ -0,0 +1,146 @@
+#include "FicsitPlannerClockSpeed.h"
+
+#include "FicsitPlannerRecipeIndex.h"
+
+namespace FicsitPlannerClockSpeed
+{
+	// Clock speeds within this are treated as equal (avoids an extra shard / building for float noise)
+	constexpr float CLOCK_TOLERANCE = 0.0001f;
+
+	struct FStep
+	{
+		int32 Group;
+		float Power;
+	};
+}
+
+float FFicsitPlannerClockSpeed::GetPower(const float BasePower, const float Multiplier, const int32 Buildings)
+{
+	if (Buildings <= 0 || Multiplier <= 0.0f) return 0.0f;
+	return BasePower * Buildings * FMath::Pow(Multiplier / Buildings, POWER_EXPONENT);
+}
+
+int32 FFicsitPlannerClockSpeed::GetShards(const float Multiplier, const int32 Buildings)
+{
+	if (Buildings <= 0) return 0;
+	const float Overclock = Multiplier / Buildings - 1.0f;
+	return Overclock > FicsitPlannerClockSpeed::CLOCK_TOLERANCE ? Buildings * FMath::CeilToInt(Overclock / SHARD_CLOCK_SPEED - FicsitPlannerClockSpeed::CLOCK_TOLERANCE) : 0;
+}
+
+void FFicsitPlannerClockSpeed::Solve(FFicsitPlannerClockPlan& Plan, const FFicsitPlannerClockLimits& Limits)
+{
+	using namespace FicsitPlannerClockSpeed;
+
+	const int32 GroupCount = Plan.Groups.Num();
+	TArray<int32> MinBuildings;
+	TArray<int32> MaxBuildings;
+	MinBuildings.SetNumZeroed(GroupCount);
+	MaxBuildings.SetNumZeroed(GroupCount);
+
+	// PART 1: Start with one building per started 100% (no shards), within the clock speed range of each group
+	Plan.TotalBuildings = 0;
+	Plan.TotalShards = 0;
+	Plan.LinearPower = 0.0f;
+	Plan.bWithinLimits = true;
+	for (int32 i = 0; i < GroupCount; ++i)
+	{
+		FFicsitPlannerMachineGroup& Group = Plan.Groups[i];
+		Plan.LinearPower += Group.BasePower * Group.Multiplier;
+		if (Group.Multiplier <= 0.0f)
+		{
+			Group.Buildings = 0;
+			continue;
+		}
+
+		MinBuildings[i] = FMath::Max(1, FMath::CeilToInt(Group.Multiplier / MAX_CLOCK_SPEED - CLOCK_TOLERANCE));
+		MaxBuildings[i] = FMath::Max(MinBuildings[i], FMath::FloorToInt(Group.Multiplier / FMath::Max(Limits.MinClockSpeed, CLOCK_TOLERANCE) + CLOCK_TOLERANCE));
+		Group.Buildings = FMath::Clamp(FMath::CeilToInt(Group.Multiplier - CLOCK_TOLERANCE), MinBuildings[i], MaxBuildings[i]);
+		Plan.TotalBuildings += Group.Buildings;
+		Plan.TotalShards += GetShards(Group.Multiplier, Group.Buildings);
+	}
+
+	const int32 Budget = Limits.MaxBuildings > 0 ? Limits.MaxBuildings : Plan.TotalBuildings;
+	const auto PowerDelta = [&](const int32 Group, const int32 Delta)
+	{
+		const FFicsitPlannerMachineGroup& MachineGroup = Plan.Groups[Group];
+		return GetPower(MachineGroup.BasePower, MachineGroup.Multiplier, MachineGroup.Buildings + Delta) - GetPower(MachineGroup.BasePower, MachineGroup.Multiplier, MachineGroup.Buildings);
+	};
+
+	// PART 2: Over budget, remove buildings where it costs the least power (overclocking, as long as shards are left)
+	TArray<FStep> Steps;
+	const auto CheapestFirst = [](const FStep& A, const FStep& B) { return A.Power < B.Power; };
+	if (Plan.TotalBuildings > Budget)
+	{
+		for (int32 i = 0; i < GroupCount; ++i)
+		{
+			if (Plan.Groups[i].Buildings > MinBuildings[i]) Steps.HeapPush({i, PowerDelta(i, -1)}, CheapestFirst);
+		}
+
+		while (Plan.TotalBuildings > Budget && Steps.Num() > 0)
+		{
+			FStep Step;
+			Steps.HeapPop(Step, CheapestFirst);
+			FFicsitPlannerMachineGroup& Group = Plan.Groups[Step.Group];
+
+			// Fewer buildings only ever need more shards, so a group out of shards is done
+			const int32 ShardDelta = GetShards(Group.Multiplier, Group.Buildings - 1) - GetShards(Group.Multiplier, Group.Buildings);
+			if (Plan.TotalShards + ShardDelta > Limits.MaxShards) continue;
+
+			Group.Buildings--;
+			Plan.TotalBuildings--;
+			Plan.TotalShards += ShardDelta;
+			if (Group.Buildings > MinBuildings[Step.Group]) Steps.HeapPush({Step.Group, PowerDelta(Step.Group, -1)}, CheapestFirst);
+		}
+
+		Plan.bWithinLimits = Plan.TotalBuildings <= Budget;
+	}
+
+	// PART 3: Under budget, add buildings where they save the most power (underclocking)
+	else if (Plan.TotalBuildings < Budget)
+	{
+		for (int32 i = 0; i < GroupCount; ++i)
+		{
+			if (Plan.Groups[i].Buildings < MaxBuildings[i]) Steps.HeapPush({i, PowerDelta(i, 1)}, CheapestFirst);
+		}
+
+		while (Plan.TotalBuildings < Budget && Steps.Num() > 0)
+		{
+			FStep Step;
+			Steps.HeapPop(Step, CheapestFirst);
+			FFicsitPlannerMachineGroup& Group = Plan.Groups[Step.Group];
+
+			Plan.TotalShards += GetShards(Group.Multiplier, Group.Buildings + 1) - GetShards(Group.Multiplier, Group.Buildings);
+			Group.Buildings++;
+			Plan.TotalBuildings++;
+			if (Group.Buildings < MaxBuildings[Step.Group]) Steps.HeapPush({Step.Group, PowerDelta(Step.Group, 1)}, CheapestFirst);
+		}
+	}
+
+	// Starting layouts may already need more shards than available (only when the clock speed range forces it)
+	Plan.bWithinLimits &= Plan.TotalShards <= Limits.MaxShards;
+
+	// PART 4: Group outputs & totals
+	Plan.TotalPower = 0.0f;
+	for (FFicsitPlannerMachineGroup& Group : Plan.Groups)
+	{
+		Group.ClockSpeed = Group.Buildings > 0 ? Group.Multiplier / Group.Buildings : 0.0f;
+		Group.Shards = GetShards(Group.Multiplier, Group.Buildings);
+		Group.Power = GetPower(Group.BasePower, Group.Multiplier, Group.Buildings);
+		Plan.TotalPower += Group.Power;
+	}
+}
+
+FString FFicsitPlannerClockSpeed::ToString(const FFicsitPlannerClockPlan& Plan, const FFicsitPlannerRecipeIndex& Index)
+{
+	FString ClockString = FString::Printf(TEXT("Clock Speeds (Power Consumption: %.2f MW, %.2f MW at 100%% | Buildings: %d | Power Shards: %d)%s\n"),
+		Plan.TotalPower, Plan.LinearPower, Plan.TotalBuildings, Plan.TotalShards, Plan.bWithinLimits ? TEXT("") : TEXT(" OVER LIMITS"));
+
+	for (const FFicsitPlannerMachineGroup& Group : Plan.Groups)
+	{
+		if (Group.Buildings == 0) continue;
+		ClockString += FString::Printf(TEXT("- %s: %dx @ %.1f%% (%d shards, %.2f MW)\n"),
+			*Index.GetRecipe(Group.Recipe).Name, Group.Buildings, Group.ClockSpeed * 100.0f, Group.Shards, Group.Power);
+	}
+
+	return ClockString;
+}
@@ -0,0 +1,341 @@
+#include "FicsitPlannerCommandlet.h"
+
+#include "FicsitPlannerCore.h"
+#include "FicsitPlannerEngine.h"
+#include "FicsitPlannerRecipeSource.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace FicsitPlannerCommandlet
+{
+	struct FTarget
+	{
+		FString Item;
+		float Rate = 0.0f;
+		EFactoryOptimizationType Optimization = EFactoryOptimizationType::EFOT_None;
+	};
+
+	EFactoryOptimizationType ParseOptimization(const FString& Value, const EFactoryOptimizationType Default)
+	{
+		if (Value.Equals(TEXT("power"), ESearchCase::IgnoreCase)) return EFactoryOptimizationType::EFOT_PowerConsumption;
+		if (Value.Equals(TEXT("complexity"), ESearchCase::IgnoreCase)) return EFactoryOptimizationType::EFOT_Complexity;
+		if (Value.Equals(TEXT("clock"), ESearchCase::IgnoreCase)) return EFactoryOptimizationType::EFOT_ClockSpeed;
+		if (Value.Equals(TEXT("none"), ESearchCase::IgnoreCase)) return EFactoryOptimizationType::EFOT_None;
+		return Default;
+	}
+
+	// Parses "<Item>:<Rate>[:<Optimization>]"
+	bool ParseTarget(const FString& Value, const EFactoryOptimizationType DefaultOptimization, FTarget& OutTarget)
+	{
+		TArray<FString> Parts;
+		Value.TrimStartAndEnd().ParseIntoArray(Parts, TEXT(":"));
+		if (Parts.Num() < 2 || !Parts[1].IsNumeric()) return false;
+
+		OutTarget.Item = Parts[0].TrimStartAndEnd();
+		OutTarget.Rate = FCString::Atof(*Parts[1]);
+		OutTarget.Optimization = Parts.Num() > 2 ? ParseOptimization(Parts[2], DefaultOptimization) : DefaultOptimization;
+		return OutTarget.Rate > 0.0f;
+	}
+
+	// Parses "<item|recipe|building>:<Name>,..." into exclusion rules (added to the ones given)
+	bool ParseExclusions(const FString& Value, FFicsitPlannerExclusionRules& OutRules)
+	{
+		TArray<FString> Exclusions;
+		Value.ParseIntoArray(Exclusions, TEXT(","));
+		for (const FString& Exclusion : Exclusions)
+		{
+			FString Kind, Name;
+			if (!Exclusion.TrimStartAndEnd().Split(TEXT(":"), &Kind, &Name) || Name.IsEmpty()) return false;
+
+			if (Kind.Equals(TEXT("item"), ESearchCase::IgnoreCase)) OutRules.Items.AddUnique(Name);
+			else if (Kind.Equals(TEXT("recipe"), ESearchCase::IgnoreCase)) OutRules.Recipes.AddUnique(Name);
+			else if (Kind.Equals(TEXT("building"), ESearchCase::IgnoreCase)) OutRules.Buildings.AddUnique(Name);
+			else return false;
+		}
+		return true;
+	}
+
+	// Finds an item by path, class name (Desc_IronPlate_C) or display name
+	int32 FindItem(const FFicsitPlannerRecipeIndex& Index, const FString& Item)
+	{
+		if (const int32 Id = Index.FindItemByPath(Item); Id != INDEX_NONE) return Id;
+		for (int32 Id = 0; Id < Index.NumItems(); ++Id)
+		{
+			if (Index.GetItem(Id).Path.EndsWith(TEXT(".") + Item, ESearchCase::IgnoreCase)) return Id;
+		}
+		return Index.FindItemByName(Item);
+	}
+}
+
+UFicsitPlannerCommandlet::UFicsitPlannerCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+	HelpDescription = TEXT("Plans factories from exported Ficsit Planner game data, without running the game.");
+	HelpUsage = TEXT("-run=FicsitPlanner -Data=<GameData.json> -Targets=\"<Item>:<Rate>,...\" [-TargetsFile=<file>] [-Optimize=power|complexity|clock] [-MaxBuildings=<N>] [-MaxShards=<N>] [-BeltTier=<N>] [-PipeTier=<N>] [-Locked] [-Flatten] [-Balance] [-Repeat=<N>] [-NoCache] [-Optimal] [-MaxNodes=<N>] [-Top=<K>] [-Exclude=\"item|recipe|building:<Name>,...\"] [-Research=power|complexity|raw] [-Format=json|csv] [-Output=<file>]");
+}
+
+int32 UFicsitPlannerCommandlet::Main(const FString& Params)
+{
+	using namespace FicsitPlannerCommandlet;
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamValues;
+	ParseCommandLine(*Params, Tokens, Switches, ParamValues);
+
+	// PART 1: Load & compile the exported game data (exclusion rules from Game.ini, then the command line, applied by the index)
+	const FString DataPath = ParamValues.Contains(TEXT("Data")) ? ParamValues[TEXT("Data")] : AFicsitPlannerEngine::GetGameDataExportPath();
+	const double LoadStart = FPlatformTime::Seconds();
+	FFicsitPlannerRecipeIndex Index;
+	FFicsitPlannerExclusionRules ExclusionRules = GetDefault<AFicsitPlannerEngine>()->GetExclusionRules();
+	if (!ParseExclusions(ParamValues.FindRef(TEXT("Exclude")), ExclusionRules))
+	{
+		UE_LOG(LogFicsitPlannerCore, Error, TEXT("Invalid exclusions! Usage: %s"), *HelpUsage);
+		return 1;
+	}
+	Index.SetExclusionRules(ExclusionRules);
+	if (!Index.Compile(FFicsitPlannerJsonRecipeSource(DataPath)))
+	{
+		UE_LOG(LogFicsitPlannerCore, Error, TEXT("Failed to load game data from %s!"), *DataPath);
+		return 1;
+	}
+	Index.BuildGraphs();
+	UE_LOG(LogFicsitPlannerCore, Display, TEXT("Loaded %d items and %d recipes from %s in %.2f ms (%d recipes excluded)."), Index.NumItems(), Index.NumRecipes(), *DataPath,
+		(FPlatformTime::Seconds() - LoadStart) * 1000.0, Index.NumExcludedRecipes());
+
+	// PART 2: Targets (command line, then targets file, one target per line)
+	const EFactoryOptimizationType DefaultOptimization = ParseOptimization(ParamValues.FindRef(TEXT("Optimize")), EFactoryOptimizationType::EFOT_None);
+	TArray<FString> TargetStrings;
+	ParamValues.FindRef(TEXT("Targets")).ParseIntoArray(TargetStrings, TEXT(","));
+	if (const FString* TargetsFile = ParamValues.Find(TEXT("TargetsFile")))
+	{
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, **TargetsFile))
+		{
+			UE_LOG(LogFicsitPlannerCore, Error, TEXT("Failed to read targets from %s!"), **TargetsFile);
+			return 1;
+		}
+		for (const FString& Line : Lines)
+		{
+			if (!Line.TrimStart().IsEmpty() && !Line.TrimStart().StartsWith(TEXT("#"))) TargetStrings.Add(Line);
+		}
+	}
+
+	if (TargetStrings.Num() == 0)
+	{
+		UE_LOG(LogFicsitPlannerCore, Error, TEXT("No targets given! Usage: %s"), *HelpUsage);
+		return 1;
+	}
+
+	// PART 3: Plan every target
+	const bool bAllowLockedRecipes = Switches.Contains(TEXT("Locked"));
+	const bool bFlatten = Switches.Contains(TEXT("Flatten"));
+	const bool bBalance = Switches.Contains(TEXT("Balance"));
+	FFicsitPlannerClockLimits ClockLimits;
+	ClockLimits.MaxBuildings = FCString::Atoi(*ParamValues.FindRef(TEXT("MaxBuildings")));
+	ClockLimits.MaxShards = FCString::Atoi(*ParamValues.FindRef(TEXT("MaxShards")));
+	const int32 Repeat = FMath::Max(1, FCString::Atoi(*ParamValues.FindRef(TEXT("Repeat"))));
+	FFicsitPlannerCore Core(Index);
+
+	// Best unlocked belt / pipe tier (every tier by default)
+	const auto TierParam = [&](const TCHAR* Name, const int32 Default)
+	{
+		const FString* Value = ParamValues.Find(Name);
+		return Value ? FCString::Atoi(**Value) : Default;
+	};
+	FFicsitPlannerLogistics Logistics;
+	Logistics.SetUnlockedTiers(TierParam(TEXT("BeltTier"), FFicsitPlannerLogistics::NUM_BELT_TIERS), TierParam(TEXT("PipeTier"), FFicsitPlannerLogistics::NUM_PIPE_TIERS));
+	Core.SetLogistics(Logistics);
+
+	// Sub-plans are shared between targets (and repeats) unless disabled
+	TUniquePtr<FFicsitPlannerPlanCache> Cache;
+	if (!Switches.Contains(TEXT("NoCache"))) Cache = MakeUnique<FFicsitPlannerPlanCache>(Index, bAllowLockedRecipes);
+
+	// Power plans can be made straight from the unit cost table (best recipes only, no alternatives)
+	const bool bOptimal = Switches.Contains(TEXT("Optimal"));
+
+	// Targets estimated over this many nodes are planned from the unit cost table instead (or skipped without an exact table)
+	const int32 MaxNodes = FCString::Atoi(*ParamValues.FindRef(TEXT("MaxNodes")));
+
+	// The K best plans of every target are ranked & logged (full plans only, optimal plans have no alternatives)
+	const int32 TopK = FCString::Atoi(*ParamValues.FindRef(TEXT("Top")));
+
+	// Locked recipes are valued over every target together (what unlocking each one would save)
+	const FString ResearchMetric = ParamValues.FindRef(TEXT("Research")).ToLower();
+	TArray<FFicsitPlannerItemRate> ResearchTargets;
+
+	// Exports are streamed to the output file while planning, instead of building a text report
+	TUniquePtr<FArchive> ExportArchive;
+	TUniquePtr<IFicsitPlannerPlanWriter> ExportWriter;
+	if (const FString* FormatValue = ParamValues.Find(TEXT("Format")))
+	{
+		const EFactoryExportFormat Format = FormatValue->Equals(TEXT("csv"), ESearchCase::IgnoreCase) ? EFactoryExportFormat::EFEF_Csv : EFactoryExportFormat::EFEF_Json;
+		const FString ExportPath = ParamValues.Contains(TEXT("Output")) ?
+			ParamValues[TEXT("Output")] :
+			FPaths::ProjectSavedDir() / TEXT("FicsitPlanner") / FString::Printf(TEXT("Plans.%s"), IFicsitPlannerPlanWriter::GetFileExtension(Format));
+
+		ExportArchive.Reset(IFileManager::Get().CreateFileWriter(*ExportPath));
+		if (!ExportArchive)
+		{
+			UE_LOG(LogFicsitPlannerCore, Error, TEXT("Failed to open %s for writing!"), *ExportPath);
+			return 1;
+		}
+		ExportWriter = IFicsitPlannerPlanWriter::Create(Format, *ExportArchive);
+		ExportWriter->BeginDocument(bFlatten);
+	}
+
+	FString Report;
+	int32 Failed = 0;
+	for (const FString& TargetString : TargetStrings)
+	{
+		FTarget Target;
+		const int32 Item = ParseTarget(TargetString, DefaultOptimization, Target) ? FindItem(Index, Target.Item) : INDEX_NONE;
+		if (Item == INDEX_NONE)
+		{
+			UE_LOG(LogFicsitPlannerCore, Error, TEXT("Invalid target: %s"), *TargetString);
+			Failed++;
+			continue;
+		}
+		ResearchTargets.Add({Item, Target.Rate});
+
+		// Count the plan before expanding it
+		bool bTargetOptimal = bOptimal;
+		if (MaxNodes > 0)
+		{
+			const FFicsitPlannerPlanEstimate Estimate = Core.EstimatePlan(Item, bAllowLockedRecipes);
+			const EFactoryPlanStrategy Strategy = Core.ChooseStrategy(Estimate, Item, bAllowLockedRecipes, Target.Optimization, MaxNodes, MaxNodes);
+			UE_LOG(LogFicsitPlannerCore, Display, TEXT("Estimated %s: %s%.0f nodes, %.0f KiB."), *TargetString.TrimStartAndEnd(),
+				Estimate.bComplete ? TEXT("") : TEXT("over "), Estimate.Nodes, Estimate.Bytes / 1024.0);
+
+			if (Strategy == EFactoryPlanStrategy::EFPS_TooLarge)
+			{
+				UE_LOG(LogFicsitPlannerCore, Error, TEXT("Target %s is too large to plan for its objective (over %d nodes)!"), *TargetString.TrimStartAndEnd(), MaxNodes);
+				Failed++;
+				continue;
+			}
+			if (Strategy == EFactoryPlanStrategy::EFPS_Optimal)
+			{
+				UE_LOG(LogFicsitPlannerCore, Warning, TEXT("Target %s is over %d nodes, planning it from the unit cost table."), *TargetString.TrimStartAndEnd(), MaxNodes);
+				bTargetOptimal = true;
+			}
+		}
+
+		// Plan (repeated for benchmarks, the last plan is kept)
+		FFicsitPlannerPlan Plan;
+		bool bPlanned = false;
+		const double PlanStart = FPlatformTime::Seconds();
+		for (int32 Run = 0; Run < Repeat; ++Run)
+		{
+			bPlanned = bTargetOptimal ?
+				Core.CreateOptimalPlan(Item, Target.Rate, bAllowLockedRecipes, Target.Optimization, Plan) :
+				Core.CreatePlan(Item, Target.Rate, bAllowLockedRecipes, Target.Optimization, Plan, Cache.Get());
+		}
+		const double PlanTime = (FPlatformTime::Seconds() - PlanStart) * 1000.0 / Repeat;
+		if (!bPlanned)
+		{
+			Failed++;
+			continue;
+		}
+
+		UE_LOG(LogFicsitPlannerCore, Display, TEXT("Planned %s (%d nodes) in %.3f ms."), *TargetString.TrimStartAndEnd(), Plan.Nodes.Num(), PlanTime);
+		if (TopK > 0 && !bTargetOptimal)
+		{
+			TArray<FFicsitPlannerRankedPlan> RankedPlans;
+			const double RankStart = FPlatformTime::Seconds();
+			Core.FindTopPlans(Plan, Target.Optimization, TopK, RankedPlans);
+			UE_LOG(LogFicsitPlannerCore, Display, TEXT("Ranked the %d best plans of %s in %.3f ms:"), RankedPlans.Num(), *TargetString.TrimStartAndEnd(), (FPlatformTime::Seconds() - RankStart) * 1000.0);
+			for (int32 i = 0; i < RankedPlans.Num(); ++i)
+			{
+				UE_LOG(LogFicsitPlannerCore, Display, TEXT("  #%d: score %.2f, %.2f MW, complexity %lld, %d selections"), i + 1,
+					RankedPlans[i].Score, RankedPlans[i].TotalPower, RankedPlans[i].TotalComplexity, RankedPlans[i].Selections.Num());
+			}
+		}
+		if (ExportWriter)
+		{
+			if (bFlatten) Core.WriteBill(Plan, *ExportWriter);
+			else Core.WritePlan(Plan, *ExportWriter);
+			continue;
+		}
+
+		Report += Core.PlanToString(Plan);
+		if (Target.Optimization == EFactoryOptimizationType::EFOT_ClockSpeed)
+		{
+			FFicsitPlannerClockPlan ClockPlan;
+			Core.CollectMachines(Plan, ClockPlan);
+			FFicsitPlannerClockSpeed::Solve(ClockPlan, ClockLimits);
+			Report += FFicsitPlannerClockSpeed::ToString(ClockPlan, Index);
+		}
+		if (bFlatten)
+		{
+			FFicsitPlannerBillOfMaterials Bill;
+			Core.FlattenPlan(Plan, Bill);
+			Report += Core.BillToString(Bill);
+		}
+		if (bBalance)
+		{
+			const double BalanceStart = FPlatformTime::Seconds();
+			FFicsitPlannerBillOfMaterials Bill;
+			Core.FlattenPlan(Plan, Bill);
+			FFicsitPlannerFlowMatrix Matrix;
+			Core.BuildFlowMatrix(Bill, Matrix);
+			FFicsitPlannerBalanceReport Balance;
+			Core.CheckBalance(Matrix, Item, Target.Rate, Balance);
+			UE_LOG(LogFicsitPlannerCore, Display, TEXT("Checked the balance of %s (%d matrix entries) in %.3f ms."), *TargetString.TrimStartAndEnd(), Matrix.Items.Num(), (FPlatformTime::Seconds() - BalanceStart) * 1000.0);
+			Report += Core.BalanceToString(Balance);
+		}
+		Report += TEXT("\n");
+	}
+
+	if (!ResearchMetric.IsEmpty())
+	{
+		const EFactoryResearchMetric Metric = ResearchMetric == TEXT("complexity") ? EFactoryResearchMetric::EFRM_Complexity
+			: ResearchMetric == TEXT("raw") ? EFactoryResearchMetric::EFRM_RawResources
+			: EFactoryResearchMetric::EFRM_Power;
+		const double ResearchStart = FPlatformTime::Seconds();
+		TArray<float> Demands;
+		Core.ComputeDemands(ResearchTargets, Demands);
+		TArray<FFicsitPlannerRecipeValue> RecipeValues;
+		Core.RankLockedRecipes(Demands, Metric, RecipeValues);
+		UE_LOG(LogFicsitPlannerCore, Display, TEXT("Valued %d locked recipes in %.3f ms."), Index.NumRecipes(), (FPlatformTime::Seconds() - ResearchStart) * 1000.0);
+
+		const FString ResearchString = Core.RecipeValuesToString(RecipeValues, Metric, RecipeValues.Num());
+		if (ExportWriter) UE_LOG(LogFicsitPlannerCore, Display, TEXT("%s"), *ResearchString);
+		else Report += ResearchString;
+	}
+
+	if (Cache)
+	{
+		UE_LOG(LogFicsitPlannerCore, Display, TEXT("Sub-plan cache: %d hits, %d misses, %d nodes."), Cache->GetHits(), Cache->GetMisses(), Cache->GetCachedNodes());
+	}
+
+	// PART 4: Output
+	if (ExportWriter)
+	{
+		ExportWriter->EndDocument();
+		if (!ExportArchive->Close())
+		{
+			UE_LOG(LogFicsitPlannerCore, Error, TEXT("Failed to write the exported plans!"));
+			return 1;
+		}
+	}
+	else if (const FString* OutputPath = ParamValues.Find(TEXT("Output")))
+	{
+		if (!FFileHelper::SaveStringToFile(Report, **OutputPath))
+		{
+			UE_LOG(LogFicsitPlannerCore, Error, TEXT("Failed to write output to %s!"), **OutputPath);
+			return 1;
+		}
+	}
+	else
+	{
+		UE_LOG(LogFicsitPlannerCore, Display, TEXT("\n%s"), *Report);
+	}
+
+	UE_LOG(LogFicsitPlannerCore, Display, TEXT("Planned %d of %d targets."), TargetStrings.Num() - Failed, TargetStrings.Num());
+	return Failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,1182 @@
+#include "FicsitPlannerCore.h"
+
+#include "Algo/StableSort.h"
+#include "FicsitPlannerFactoryGroup.h"
+
+bool FFicsitPlannerCore::CreatePlan(const int32 Item, const float Rate, const bool bAllowLockedRecipes, const EFactoryOptimizationType Optimization, FFicsitPlannerPlan& OutPlan, FFicsitPlannerPlanCache* Cache) const
+{
+	OutPlan = FFicsitPlannerPlan();
+	OutPlan.bAllowLockedRecipes = bAllowLockedRecipes;
+	OutPlan.Index = &Index;
+
+	// Check if the target product is valid
+	if (Item < 0 || Item >= Index.NumItems())
+	{
+		UE_LOG(LogFicsitPlannerCore, Error, TEXT("Invalid target product!"));
+		return false;
+	}
+
+	// Sub-plans can only be shared with plans in the same lock mode
+	if (Cache && Cache->AllowsLockedRecipes() != bAllowLockedRecipes) Cache = nullptr;
+
+	// Create the root node, and everything below it
+	TArray<int32> VisitedRecipes;
+	CreateNode(OutPlan, Item, Rate, VisitedRecipes, Cache);
+	if (OutPlan.Nodes[0].IsInput())
+	{
+		UE_LOG(LogFicsitPlannerCore, Error, TEXT("No recipes found for target product %s!"), *Index.GetItem(Item).Name);
+		OutPlan.Nodes.Empty();
+		return false;
+	}
+
+	// Select alternatives & compute totals
+	OptimizePlan(OutPlan, Optimization);
+	return true;
+}
+
+bool FFicsitPlannerCore::CreateOptimalPlan(const int32 Item, const float Rate, const bool bAllowLockedRecipes, const EFactoryOptimizationType Optimization, FFicsitPlannerPlan& OutPlan) const
+{
+	OutPlan = FFicsitPlannerPlan();
+	OutPlan.bAllowLockedRecipes = bAllowLockedRecipes;
+	OutPlan.Index = &Index;
+
+	// Check if the target product is valid
+	if (Item < 0 || Item >= Index.NumItems())
+	{
+		UE_LOG(LogFicsitPlannerCore, Error, TEXT("Invalid target product!"));
+		return false;
+	}
+
+	if (!SupportsOptimalPlan(Item, bAllowLockedRecipes, Optimization))
+	{
+		return CreatePlan(Item, Rate, bAllowLockedRecipes, Optimization, OutPlan);
+	}
+
+	// Follow the best recipe of every item, top-down
+	CreateOptimalNode(OutPlan, Item, Rate);
+	if (OutPlan.Nodes[0].IsInput())
+	{
+		UE_LOG(LogFicsitPlannerCore, Error, TEXT("No recipes found for target product %s!"), *Index.GetItem(Item).Name);
+		OutPlan.Nodes.Empty();
+		return false;
+	}
+
+	// Compute totals (no groups to select)
+	OptimizePlan(OutPlan, EFactoryOptimizationType::EFOT_None);
+	return true;
+}
+
+FFicsitPlannerPlanEstimate FFicsitPlannerCore::EstimatePlan(const int32 Item, const bool bAllowLockedRecipes, const int32 MaxSubPlans) const
+{
+	FFicsitPlannerPlanEstimate Estimate;
+	if (Item < 0 || Item >= Index.NumItems()) return Estimate;
+
+	// Count the nodes, top-down like CreatePlan (without a cache, sub-plans are copied in full)
+	TMap<FFicsitPlannerSubPlanKey, FFicsitPlannerPlanEstimate> SubPlans;
+	TArray<int32> VisitedRecipes;
+	bool bComplete = true;
+	Estimate = EstimateNode(bAllowLockedRecipes, Item, VisitedRecipes, SubPlans, MaxSubPlans, bComplete);
+	Estimate.SubPlans = SubPlans.Num();
+	Estimate.bComplete = bComplete;
+
+	// Every node but the root is a child or alternative of another one
+	Estimate.Bytes = Estimate.Nodes * (sizeof(FFicsitPlannerPlanNode) + sizeof(int32));
+	return Estimate;
+}
+
+bool FFicsitPlannerCore::SupportsOptimalPlan(const int32 Item, const bool bAllowLockedRecipes, const EFactoryOptimizationType Optimization) const
+{
+	if (Item < 0 || Item >= Index.NumItems()) return false;
+
+	// The table is only exact for power (linear in the rate), and only without unsolved cycles
+	float PowerWeight, ComplexityWeight;
+	UFicsitPlannerFactoryGroup::GetOptimizationWeights(Optimization, PowerWeight, ComplexityWeight);
+	return PowerWeight > 0.0f && ComplexityWeight == 0.0f && Index.GetUnitCost(bAllowLockedRecipes, Item).bExact;
+}
+
+EFactoryPlanStrategy FFicsitPlannerCore::ChooseStrategy(const FFicsitPlannerPlanEstimate& Estimate, const int32 Item, const bool bAllowLockedRecipes, const EFactoryOptimizationType Optimization, const double MaxFullNodes, const double MaxNodes) const
+{
+	if (Estimate.bComplete && Estimate.Nodes <= MaxFullNodes) return EFactoryPlanStrategy::EFPS_Full;
+	if (Estimate.bComplete && Estimate.Nodes <= MaxNodes) return EFactoryPlanStrategy::EFPS_Memoized;
+
+	// Past that, only the unit cost table plans in time linear in the plan (and only for the objectives it's exact for)
+	return SupportsOptimalPlan(Item, bAllowLockedRecipes, Optimization) ? EFactoryPlanStrategy::EFPS_Optimal : EFactoryPlanStrategy::EFPS_TooLarge;
+}
+
+const FFicsitPlannerPlanNode* FFicsitPlannerPlan::GetSelectedNode(const FFicsitPlannerPlanNode& Node) const
+{
+	if (!Node.IsGroup()) return &Node;
+	if (!Node.Alternatives.IsValidIndex(Node.Selected) || !Nodes.IsValidIndex(Node.Alternatives[Node.Selected])) return nullptr;
+	return &Nodes[Node.Alternatives[Node.Selected]];
+}
+
+namespace
+{
+	/**
+	 * Lazy k-best search over a plan's nodes: each node keeps its selections found so far (best first), and a heap of candidates.
+	 * Groups merge the ranked lists of their alternatives, other nodes combine one ranked selection per input.
+	 */
+	class FTopPlanSearch
+	{
+	public:
+		struct FSelection
+		{
+			double Score = 0.0;
+			double Power = 0.0;
+			int64 Complexity = 0;
+
+			// Groups: selected alternative & its rank (in Ranks[0]), other nodes: rank of every input
+			int32 Alternative = INDEX_NONE;
+			TArray<int32> Ranks;
+
+			static bool Less(const FSelection& A, const FSelection& B) { return A.Score < B.Score; }
+		};
+
+		FTopPlanSearch(const FFicsitPlannerPlan& InPlan, const float InPowerWeight, const float InComplexityWeight)
+			: Plan(InPlan), PowerWeight(InPowerWeight), ComplexityWeight(InComplexityWeight)
+		{
+			States.SetNum(Plan.Nodes.Num());
+		}
+
+		// Selection of the node with that rank (0 = best), or nullptr if it has fewer selections
+		const FSelection* Get(const int32 Node, const int32 Rank)
+		{
+			FNodeState& State = States[Node];
+			if (!State.bStarted) Start(Node);
+
+			while (State.Found.Num() <= Rank)
+			{
+				// Successors of the last selection found only enter the heap once a later one is needed
+				while (State.NumExpanded < State.Found.Num()) Expand(Node, State.NumExpanded++);
+				if (State.Candidates.Num() == 0) return nullptr;
+
+				FSelection Best;
+				State.Candidates.HeapPop(Best, FSelection::Less);
+				State.Found.Add(MoveTemp(Best));
+			}
+			return &State.Found[Rank];
+		}
+
+		void Collect(const int32 Node, const int32 Rank, FFicsitPlannerRankedPlan& OutPlan) const
+		{
+			const FSelection& Selection = States[Node].Found[Rank];
+			const FFicsitPlannerPlanNode& PlanNode = Plan.Nodes[Node];
+			if (PlanNode.IsGroup())
+			{
+				OutPlan.Selections.Add({Node, Selection.Alternative});
+				Collect(PlanNode.Alternatives[Selection.Alternative], Selection.Ranks[0], OutPlan);
+				return;
+			}
+			for (int32 i = 0; i < PlanNode.Children.Num(); ++i) Collect(PlanNode.Children[i], Selection.Ranks[i], OutPlan);
+		}
+
+	private:
+		struct FNodeState
+		{
+			bool bStarted = false;
+			int32 NumExpanded = 0;
+			TArray<FSelection> Found;
+			TArray<FSelection> Candidates;
+			TSet<TArray<int32>> Seen;
+		};
+
+		const FFicsitPlannerPlan& Plan;
+		float PowerWeight;
+		float ComplexityWeight;
+		TArray<FNodeState> States;
+
+		void Start(const int32 Node)
+		{
+			States[Node].bStarted = true;
+			const FFicsitPlannerPlanNode& PlanNode = Plan.Nodes[Node];
+
+			// Groups start from the best selection of every alternative
+			if (PlanNode.IsGroup())
+			{
+				for (int32 Alternative = 0; Alternative < PlanNode.Alternatives.Num(); ++Alternative) PushAlternative(Node, Alternative, 0);
+				return;
+			}
+
+			// Other nodes from the best selection of every input (leaf inputs have a single, empty one)
+			TArray<int32> Ranks;
+			Ranks.Init(0, PlanNode.Children.Num());
+			PushRanks(Node, MoveTemp(Ranks));
+		}
+
+		void Expand(const int32 Node, const int32 FoundIndex)
+		{
+			const FSelection Selection = States[Node].Found[FoundIndex];
+			if (Plan.Nodes[Node].IsGroup())
+			{
+				PushAlternative(Node, Selection.Alternative, Selection.Ranks[0] + 1);
+				return;
+			}
+
+			// Next selection of one input at a time
+			for (int32 i = 0; i < Selection.Ranks.Num(); ++i)
+			{
+				TArray<int32> Ranks = Selection.Ranks;
+				Ranks[i]++;
+				PushRanks(Node, MoveTemp(Ranks));
+			}
+		}
+
+		void PushAlternative(const int32 Node, const int32 Alternative, const int32 Rank)
+		{
+			const FSelection* AlternativeSelection = Get(Plan.Nodes[Node].Alternatives[Alternative], Rank);
+			if (!AlternativeSelection) return;
+
+			FSelection Selection;
+			Selection.Score = AlternativeSelection->Score;
+			Selection.Power = AlternativeSelection->Power;
+			Selection.Complexity = AlternativeSelection->Complexity;
+			Selection.Alternative = Alternative;
+			Selection.Ranks.Add(Rank);
+			States[Node].Candidates.HeapPush(MoveTemp(Selection), FSelection::Less);
+		}
+
+		void PushRanks(const int32 Node, TArray<int32>&& Ranks)
+		{
+			bool bSeen = false;
+			States[Node].Seen.Add(Ranks, &bSeen);
+			if (bSeen) return;
+
+			const FFicsitPlannerPlanNode& PlanNode = Plan.Nodes[Node];
+			FSelection Selection;
+			Selection.Power = PlanNode.Power;
+			Selection.Complexity = PlanNode.Complexity;
+			for (int32 i = 0; i < Ranks.Num(); ++i)
+			{
+				const FSelection* Input = Get(PlanNode.Children[i], Ranks[i]);
+				if (!Input) return;
+				Selection.Power += Input->Power;
+				Selection.Complexity += Input->Complexity;
+			}
+			Selection.Score = PowerWeight * Selection.Power + ComplexityWeight * Selection.Complexity;
+			Selection.Ranks = MoveTemp(Ranks);
+			States[Node].Candidates.HeapPush(MoveTemp(Selection), FSelection::Less);
+		}
+	};
+}
+
+void FFicsitPlannerCore::FindTopPlans(const FFicsitPlannerPlan& Plan, const EFactoryOptimizationType Optimization, const int32 K, TArray<FFicsitPlannerRankedPlan>& OutPlans) const
+{
+	OutPlans.Reset();
+	if (Plan.Nodes.Num() == 0 || K <= 0) return;
+
+	// Plans without an objective are ranked by power
+	float PowerWeight, ComplexityWeight;
+	UFicsitPlannerFactoryGroup::GetOptimizationWeights(Optimization, PowerWeight, ComplexityWeight);
+	if (PowerWeight == 0.0f && ComplexityWeight == 0.0f) PowerWeight = 1.0f;
+
+	FTopPlanSearch Search(Plan, PowerWeight, ComplexityWeight);
+	for (int32 Rank = 0; Rank < K; ++Rank)
+	{
+		const FTopPlanSearch::FSelection* Selection = Search.Get(0, Rank);
+		if (!Selection) break;
+
+		FFicsitPlannerRankedPlan& RankedPlan = OutPlans.AddDefaulted_GetRef();
+		RankedPlan.Score = Selection->Score;
+		RankedPlan.TotalPower = Selection->Power;
+		RankedPlan.TotalComplexity = Selection->Complexity;
+		Search.Collect(0, Rank, RankedPlan);
+	}
+}
+
+void FFicsitPlannerCore::ScalePlan(const FFicsitPlannerPlan& Plan, const float Rate, FFicsitPlannerPlan& OutPlan) const
+{
+	OutPlan = FFicsitPlannerPlan();
+	OutPlan.bAllowLockedRecipes = Plan.bAllowLockedRecipes;
+	OutPlan.Index = &Index;
+	AppendFragment(OutPlan, Plan, Rate);
+}
+
+void FFicsitPlannerCore::OptimizePlan(FFicsitPlannerPlan& Plan, const EFactoryOptimizationType Optimization) const
+{
+	if (Plan.Nodes.Num() == 0) return;
+
+	float PowerWeight, ComplexityWeight;
+	UFicsitPlannerFactoryGroup::GetOptimizationWeights(Optimization, PowerWeight, ComplexityWeight);
+	RefreshNode(Plan, 0, PowerWeight, ComplexityWeight, Optimization != EFactoryOptimizationType::EFOT_None);
+}
+
+void FFicsitPlannerCore::FlattenPlan(const FFicsitPlannerPlan& Plan, FFicsitPlannerBillOfMaterials& OutBill) const
+{
+	OutBill = FFicsitPlannerBillOfMaterials();
+	if (Plan.Nodes.Num() == 0) return;
+
+	const FFicsitPlannerRecipeGraph& Graph = Index.GetGraph(Plan.bAllowLockedRecipes);
+	TMap<int32, int32> RecipeRows;
+	TMap<int32, float> Inputs;
+	TMap<int32, float> Byproducts;
+
+	const auto AddRecipe = [&](const int32 Recipe, const float Multiplier)
+	{
+		const int32 Row = RecipeRows.FindOrAdd(Recipe, OutBill.Recipes.Num());
+		if (Row == OutBill.Recipes.Num()) OutBill.Recipes.Add({Recipe, 0.0f, 0.0f});
+		OutBill.Recipes[Row].Multiplier += Multiplier;
+		OutBill.Recipes[Row].Power += Index.GetRecipe(Recipe).Power * Multiplier;
+	};
+
+	// Walk the selected tree iteratively
+	TArray<int32> NodeStack;
+	NodeStack.Add(0);
+	while (NodeStack.Num() > 0)
+	{
+		const FFicsitPlannerPlanNode& Node = Plan.Nodes[NodeStack.Pop()];
+
+		if (Node.IsGroup())
+		{
+			if (Node.Alternatives.IsValidIndex(Node.Selected)) NodeStack.Add(Node.Alternatives[Node.Selected]);
+			continue;
+		}
+
+		if (Node.IsInput())
+		{
+			Inputs.FindOrAdd(Node.Item) += Node.Rate;
+			continue;
+		}
+
+		if (Node.IsLoop())
+		{
+			// Every recipe of the loop, plus its net surplus
+			const FFicsitPlannerLoopSolution& Solution = Graph.Loops[Node.Item][Node.Loop];
+			for (int32 i = 0; i < Solution.Recipes.Num(); ++i) AddRecipe(Solution.Recipes[i], Solution.Multipliers[i] * Node.Rate);
+			for (const FFicsitPlannerItemRate& Byproduct : Solution.Byproducts) Byproducts.FindOrAdd(Byproduct.Item) += Byproduct.Rate * Node.Rate;
+		}
+		else
+		{
+			// The recipe, plus every product other than the node's item
+			AddRecipe(Node.Recipe, Node.Multiplier);
+			for (const FFicsitPlannerItemRate& Product : Index.GetRecipe(Node.Recipe).Products)
+			{
+				if (Product.Item != Node.Item) Byproducts.FindOrAdd(Product.Item) += Product.Rate * Node.Multiplier;
+			}
+		}
+
+		OutBill.TotalComplexity += Node.Complexity;
+		NodeStack.Append(Node.Children);
+	}
+
+	for (const FFicsitPlannerRecipeUse& Use : OutBill.Recipes) OutBill.TotalPower += Use.Power;
+	for (const TPair<int32, float>& Input : Inputs) OutBill.Inputs.Add({Input.Key, Input.Value});
+	for (const TPair<int32, float>& Byproduct : Byproducts) OutBill.Byproducts.Add({Byproduct.Key, Byproduct.Value});
+}
+
+void FFicsitPlannerCore::BuildFlowMatrix(const FFicsitPlannerBillOfMaterials& Bill, FFicsitPlannerFlowMatrix& OutMatrix) const
+{
+	OutMatrix = FFicsitPlannerFlowMatrix();
+	OutMatrix.Recipes.Reserve(Bill.Recipes.Num());
+	OutMatrix.Multipliers.Reserve(Bill.Recipes.Num());
+	OutMatrix.ColumnStarts.Reserve(Bill.Recipes.Num() + 1);
+
+	// One column per recipe (the bill already sums every node running it)
+	for (const FFicsitPlannerRecipeUse& Use : Bill.Recipes)
+	{
+		const FFicsitPlannerRecipeData& RecipeData = Index.GetRecipe(Use.Recipe);
+		OutMatrix.Recipes.Add(Use.Recipe);
+		OutMatrix.Multipliers.Add(Use.Multiplier);
+		OutMatrix.ColumnStarts.Add(OutMatrix.Items.Num());
+		for (const FFicsitPlannerItemRate& Product : RecipeData.Products)
+		{
+			OutMatrix.Items.Add(Product.Item);
+			OutMatrix.Rates.Add(Product.Rate);
+		}
+		for (const FFicsitPlannerItemRate& Ingredient : RecipeData.Ingredients)
+		{
+			OutMatrix.Items.Add(Ingredient.Item);
+			OutMatrix.Rates.Add(-Ingredient.Rate);
+		}
+	}
+	OutMatrix.ColumnStarts.Add(OutMatrix.Items.Num());
+}
+
+void FFicsitPlannerCore::CheckBalance(const FFicsitPlannerFlowMatrix& Matrix, const int32 TargetItem, const float TargetRate, FFicsitPlannerBalanceReport& OutReport) const
+{
+	OutReport = FFicsitPlannerBalanceReport();
+	OutReport.TargetItem = TargetItem;
+	OutReport.TargetRate = TargetRate;
+
+	// PART 1: Net flows (one pass over the entries, items kept in first-seen order)
+	TArray<int32> ItemRows;
+	ItemRows.Init(INDEX_NONE, Index.NumItems());
+	TArray<FFicsitPlannerItemBalance> Balances;
+	for (int32 Column = 0; Column < Matrix.Recipes.Num(); ++Column)
+	{
+		for (int32 Entry = Matrix.ColumnStarts[Column]; Entry < Matrix.ColumnStarts[Column + 1]; ++Entry)
+		{
+			const int32 Item = Matrix.Items[Entry];
+			if (ItemRows[Item] == INDEX_NONE)
+			{
+				ItemRows[Item] = Balances.Num();
+				Balances.Add({Item, 0.0f, 0.0f});
+			}
+
+			const float Flow = Matrix.Rates[Entry] * Matrix.Multipliers[Column];
+			if (Flow > 0.0f) Balances[ItemRows[Item]].Produced += Flow;
+			else Balances[ItemRows[Item]].Consumed -= Flow;
+		}
+	}
+
+	// The target's output leaves the plan, as if consumed (a missing target is a deficit too)
+	if (TargetItem >= 0 && TargetItem < Index.NumItems())
+	{
+		if (ItemRows[TargetItem] == INDEX_NONE)
+		{
+			ItemRows[TargetItem] = Balances.Num();
+			Balances.Add({TargetItem, 0.0f, 0.0f});
+		}
+		Balances[ItemRows[TargetItem]].Consumed += TargetRate;
+	}
+
+	// PART 2: Classify (tolerance relative to the item's throughput, rates are summed floats)
+	for (const FFicsitPlannerItemBalance& Balance : Balances)
+	{
+		const float Net = Balance.GetNet();
+		if (FMath::Abs(Net) <= BALANCE_TOLERANCE * FMath::Max3(1.0f, Balance.Produced, Balance.Consumed)) continue;
+
+		if (Net > 0.0f) OutReport.Surpluses.Add(Balance);
+		else if (Index.IsRawItem(Balance.Item) || Index.IsItemExcluded(Balance.Item)) OutReport.RawInputs.Add(Balance);
+		else OutReport.Deficits.Add(Balance);
+	}
+	OutReport.NumItems = Balances.Num();
+}
+
+void FFicsitPlannerCore::ComputeDemands(const TConstArrayView<FFicsitPlannerItemRate> Targets, TArray<float>& OutDemands) const
+{
+	OutDemands.Init(0.0f, Index.NumItems());
+	const FFicsitPlannerRecipeGraph& Graph = Index.GetGraph(false);
+	for (const FFicsitPlannerItemRate& Target : Targets)
+	{
+		if (Target.Item >= 0 && Target.Item < Index.NumItems()) OutDemands[Target.Item] += Target.Rate;
+	}
+
+	// Consumers first (components are numbered ingredients first), each item pushing its demand to the inputs of its least-power
+	// recipe or loop. Inputs in the same component are left out, like the table does, so every demand is pushed once
+	TArray<int32> SortedItems;
+	SortedItems.Reserve(Index.NumItems());
+	for (int32 Item = 0; Item < Index.NumItems(); ++Item) SortedItems.Add(Item);
+	Algo::StableSortBy(SortedItems, [&](const int32 Item) { return Graph.ItemComponents[Item]; }, TGreater<>());
+
+	for (const int32 Item : SortedItems)
+	{
+		const float Demand = OutDemands[Item];
+		const FFicsitPlannerUnitCost& Cost = Graph.UnitCosts[Item];
+		if (Demand <= 0.0f || Cost.PowerRecipe == INDEX_NONE) continue;
+
+		const bool bLoop = Cost.PowerLoop != INDEX_NONE;
+		const TArray<FFicsitPlannerItemRate>& Inputs = bLoop ? Graph.Loops[Item][Cost.PowerLoop].Inputs : Index.GetRecipe(Cost.PowerRecipe).Ingredients;
+		const float Scale = bLoop ? Demand : Demand / Index.GetProductRate(Cost.PowerRecipe, Item);
+		for (const FFicsitPlannerItemRate& Input : Inputs)
+		{
+			if (Graph.ItemComponents[Input.Item] != Graph.ItemComponents[Item]) OutDemands[Input.Item] += Input.Rate * Scale;
+		}
+	}
+}
+
+void FFicsitPlannerCore::ComputeDemands(const FFicsitPlannerFlowMatrix& Matrix, const int32 TargetItem, const float TargetRate, TArray<float>& OutDemands) const
+{
+	// Everything the plan consumes, and its target
+	OutDemands.Init(0.0f, Index.NumItems());
+	for (int32 Column = 0; Column < Matrix.Recipes.Num(); ++Column)
+	{
+		for (int32 Entry = Matrix.ColumnStarts[Column]; Entry < Matrix.ColumnStarts[Column + 1]; ++Entry)
+		{
+			if (Matrix.Rates[Entry] < 0.0f) OutDemands[Matrix.Items[Entry]] -= Matrix.Rates[Entry] * Matrix.Multipliers[Column];
+		}
+	}
+	if (TargetItem >= 0 && TargetItem < Index.NumItems()) OutDemands[TargetItem] += TargetRate;
+}
+
+void FFicsitPlannerCore::RankLockedRecipes(const TArray<float>& Demands, const EFactoryResearchMetric Metric, TArray<FFicsitPlannerRecipeValue>& OutValues) const
+{
+	OutValues.Reset();
+	if (Demands.Num() != Index.NumItems()) return;
+
+	// Optimal cost of 1 / min of an item with the unlocked recipes (for the metric)
+	const FFicsitPlannerRecipeGraph& Graph = Index.GetGraph(false);
+	const auto UnitCost = [&](const int32 Item)
+	{
+		const FFicsitPlannerUnitCost& Cost = Graph.UnitCosts[Item];
+		return Metric == EFactoryResearchMetric::EFRM_Power ? Cost.Power : Metric == EFactoryResearchMetric::EFRM_Complexity ? Cost.Buildings : Cost.RawInputs;
+	};
+
+	for (int32 Recipe = 0; Recipe < Index.NumRecipes(); ++Recipe)
+	{
+		if (Index.IsRecipeUnlocked(Recipe) || Index.IsRecipeExcluded(Recipe)) continue;
+
+		// PART 1: Cost of running the recipe at 1x, from optimal ingredients (skipped if one needs other locked recipes)
+		const FFicsitPlannerRecipeData& RecipeData = Index.GetRecipe(Recipe);
+		float RecipeCost = Metric == EFactoryResearchMetric::EFRM_Power ? RecipeData.Power : Metric == EFactoryResearchMetric::EFRM_Complexity ? 1.0f : 0.0f;
+		bool bObtainable = true;
+		bool bExact = true;
+		for (const FFicsitPlannerItemRate& Ingredient : RecipeData.Ingredients)
+		{
+			bObtainable &= Index.IsObtainable(false, Ingredient.Item);
+			bExact &= Graph.UnitCosts[Ingredient.Item].bExact;
+			RecipeCost += UnitCost(Ingredient.Item) * Ingredient.Rate;
+		}
+		if (!bObtainable) continue;
+
+		// PART 2: Best product to make with it (the whole recipe charged to it, other products not credited)
+		FFicsitPlannerRecipeValue Best;
+		for (const FFicsitPlannerItemRate& Product : RecipeData.Products)
+		{
+			if (Demands[Product.Item] <= 0.0f || Product.Rate <= 0.0f) continue;
+
+			const float UnitSaving = UnitCost(Product.Item) - RecipeCost / Product.Rate;
+			const float Saving = UnitSaving * Demands[Product.Item];
+			if (Saving <= Best.Saving) continue;
+
+			const bool bConsumesProduct = RecipeData.Ingredients.ContainsByPredicate([&](const FFicsitPlannerItemRate& Ingredient) { return Graph.ItemComponents[Ingredient.Item] == Graph.ItemComponents[Product.Item]; });
+			Best = {Recipe, Product.Item, Demands[Product.Item], Saving, UnitSaving, bExact && Graph.UnitCosts[Product.Item].bExact && !bConsumesProduct};
+		}
+		if (Best.Saving > BALANCE_TOLERANCE) OutValues.Add(Best);
+	}
+
+	OutValues.Sort([](const FFicsitPlannerRecipeValue& A, const FFicsitPlannerRecipeValue& B) { return A.Saving > B.Saving; });
+}
+
+void FFicsitPlannerCore::CollectMachines(const FFicsitPlannerPlan& Plan, FFicsitPlannerClockPlan& OutClockPlan) const
+{
+	OutClockPlan = FFicsitPlannerClockPlan();
+	if (Plan.Nodes.Num() == 0) return;
+
+	const auto AddGroup = [&](const int32 Recipe, const float Multiplier)
+	{
+		OutClockPlan.Groups.Add({Recipe, Multiplier, Index.GetRecipe(Recipe).Power});
+	};
+
+	// Walk the selected tree iteratively
+	TArray<int32> NodeStack;
+	NodeStack.Add(0);
+	while (NodeStack.Num() > 0)
+	{
+		const FFicsitPlannerPlanNode& Node = Plan.Nodes[NodeStack.Pop()];
+
+		if (Node.IsGroup())
+		{
+			if (Node.Alternatives.IsValidIndex(Node.Selected)) NodeStack.Add(Node.Alternatives[Node.Selected]);
+			continue;
+		}
+		if (Node.IsInput()) continue;
+
+		if (Node.IsLoop())
+		{
+			const FFicsitPlannerLoopSolution& Solution = Index.GetGraph(Plan.bAllowLockedRecipes).Loops[Node.Item][Node.Loop];
+			for (int32 i = 0; i < Solution.Recipes.Num(); ++i) AddGroup(Solution.Recipes[i], Solution.Multipliers[i] * Node.Rate);
+		}
+		else
+		{
+			AddGroup(Node.Recipe, Node.Multiplier);
+		}
+
+		NodeStack.Append(Node.Children);
+	}
+}
+
+FFicsitPlannerTransport FFicsitPlannerCore::SizeEdge(const FFicsitPlannerPlanNode& Node) const
+{
+	return Logistics.Size(Node.Rate, Index.GetItem(Node.Item).bFluid);
+}
+
+int32 FFicsitPlannerCore::CountEdgesOverCapacity(const FFicsitPlannerPlan& Plan) const
+{
+	if (Plan.Nodes.Num() == 0) return 0;
+
+	// Every recipe node of the selected tree has one output edge (same nodes as PlanToString & WritePlan)
+	int32 EdgesOverCapacity = 0;
+	TArray<int32> NodeStack;
+	NodeStack.Add(0);
+	while (NodeStack.Num() > 0)
+	{
+		const FFicsitPlannerPlanNode& GroupNode = Plan.Nodes[NodeStack.Pop()];
+		if (GroupNode.IsInput()) continue;
+
+		// Groups with an invalid selection have no edge to size (PlanToString & WritePlan report them)
+		const FFicsitPlannerPlanNode* SelectedNode = Plan.GetSelectedNode(GroupNode);
+		if (!SelectedNode) continue;
+		const FFicsitPlannerPlanNode& Node = *SelectedNode;
+		if (SizeEdge(Node).bOverCapacity) EdgesOverCapacity++;
+		NodeStack.Append(Node.Children);
+	}
+	return EdgesOverCapacity;
+}
+
+FString FFicsitPlannerCore::PlanToString(const FFicsitPlannerPlan& Plan) const
+{
+	if (Plan.Nodes.Num() == 0) return TEXT("Empty plan!\n");
+
+	// Add basic plan info
+	const FFicsitPlannerPlanNode& Root = Plan.Nodes[0];
+	FString PlanString;
+	PlanString += FString::Printf(TEXT("Producing: %.2fx %s / min\n"), Root.Rate, *Index.GetItem(Root.Item).Name);
+	PlanString += FString::Printf(TEXT("Power Consumption: %.2f MW\n"), Root.TotalPower);
+	PlanString += FString::Printf(TEXT("Complexity: %d\n"), Root.TotalComplexity);
+	PlanString += FString::Printf(TEXT("Edges Over Capacity: %d\n"), CountEdgesOverCapacity(Plan));
+
+	// Add nodes depth-first, following selected alternatives (same numbering as AFicsitPlannerEngine::FactoryPlanToString)
+	TArray<TPair<int32, int32>> NodeStack;
+	NodeStack.Add({0, 0});
+	int32 CurrentNodeIndex = 1;
+	while (NodeStack.Num() > 0)
+	{
+		const TPair<int32, int32> Entry = NodeStack.Pop();
+		const FFicsitPlannerPlanNode& GroupNode = Plan.Nodes[Entry.Key];
+		if (GroupNode.IsInput()) continue;
+
+		const FString Indentation = FString::ChrN(Entry.Value * 2, TEXT(' ')) + TEXT("- ");
+		const FFicsitPlannerPlanNode* SelectedNode = Plan.GetSelectedNode(GroupNode);
+		if (!SelectedNode)
+		{
+			PlanString += Indentation + FString::Printf(TEXT("%d: Product: %s, invalid option %d of %d!\n"),
+				CurrentNodeIndex++, *Index.GetItem(GroupNode.Item).Name, GroupNode.Selected + 1, GroupNode.Alternatives.Num());
+			continue;
+		}
+		const FFicsitPlannerPlanNode& Node = *SelectedNode;
+		PlanString += Indentation + FString::Printf(TEXT("%d: Product: %s, Recipe: %s, Multiplier: %.2f, Transport: %s\n"),
+			CurrentNodeIndex, *Index.GetItem(Node.Item).Name, *Index.GetRecipe(Node.Recipe).Name, Node.Multiplier,
+			*FFicsitPlannerLogistics::TransportToString(SizeEdge(Node)));
+
+		if (GroupNode.IsGroup())
+		{
+			PlanString += FString::Printf(TEXT("(Option %d of %d)\n"), GroupNode.Selected + 1, GroupNode.Alternatives.Num());
+		}
+		if (Node.IsLoop())
+		{
+			const FFicsitPlannerLoopSolution& Solution = Index.GetGraph(Plan.bAllowLockedRecipes).Loops[Node.Item][Node.Loop];
+			FString LoopString = TEXT("(Loop:");
+			for (int32 i = 0; i < Solution.Recipes.Num(); ++i)
+			{
+				LoopString += FString::Printf(TEXT(" %s x%.2f"), *Index.GetRecipe(Solution.Recipes[i]).Name, Solution.Multipliers[i] * Node.Rate);
+			}
+			PlanString += LoopString + TEXT(")\n");
+		}
+
+		for (const int32 Child : Node.Children) NodeStack.Add({Child, Entry.Value + 1});
+		CurrentNodeIndex++;
+	}
+
+	return PlanString;
+}
+
+FString FFicsitPlannerCore::BillToString(const FFicsitPlannerBillOfMaterials& Bill) const
+{
+	FString BillString = FString::Printf(TEXT("Bill of Materials (Power Consumption: %.2f MW | Complexity: %d)\n"), Bill.TotalPower, Bill.TotalComplexity);
+
+	BillString += TEXT("Recipes:\n");
+	for (const FFicsitPlannerRecipeUse& Use : Bill.Recipes)
+	{
+		BillString += FString::Printf(TEXT("- %s x%.2f (%.2f MW)\n"), *Index.GetRecipe(Use.Recipe).Name, Use.Multiplier, Use.Power);
+	}
+
+	BillString += TEXT("Inputs:\n");
+	for (const FFicsitPlannerItemRate& Input : Bill.Inputs)
+	{
+		BillString += FString::Printf(TEXT("- %.2fx %s / min\n"), Input.Rate, *Index.GetItem(Input.Item).Name);
+	}
+
+	BillString += TEXT("Byproducts:\n");
+	for (const FFicsitPlannerItemRate& Byproduct : Bill.Byproducts)
+	{
+		BillString += FString::Printf(TEXT("- %.2fx %s / min\n"), Byproduct.Rate, *Index.GetItem(Byproduct.Item).Name);
+	}
+
+	return BillString;
+}
+
+FString FFicsitPlannerCore::BalanceToString(const FFicsitPlannerBalanceReport& Report) const
+{
+	FString BalanceString = FString::Printf(TEXT("Balance (%d items): %s\n"), Report.NumItems,
+		Report.IsBalanced() ? TEXT("balanced") : *FString::Printf(TEXT("%d deficits"), Report.Deficits.Num()));
+
+	const auto BalancesToString = [&](const TCHAR* Title, const TArray<FFicsitPlannerItemBalance>& Balances)
+	{
+		if (Balances.Num() == 0) return;
+		BalanceString += Title;
+		for (const FFicsitPlannerItemBalance& Balance : Balances)
+		{
+			BalanceString += FString::Printf(TEXT("- %.2fx %s / min (produced %.2f, consumed %.2f)\n"), FMath::Abs(Balance.GetNet()),
+				*Index.GetItem(Balance.Item).Name, Balance.Produced, Balance.Consumed);
+		}
+	};
+	BalancesToString(TEXT("Deficits:\n"), Report.Deficits);
+	BalancesToString(TEXT("Surpluses:\n"), Report.Surpluses);
+	BalancesToString(TEXT("Raw inputs:\n"), Report.RawInputs);
+	return BalanceString;
+}
+
+FString FFicsitPlannerCore::RecipeValuesToString(const TArray<FFicsitPlannerRecipeValue>& Values, const EFactoryResearchMetric Metric, const int32 MaxValues) const
+{
+	const TCHAR* Unit = Metric == EFactoryResearchMetric::EFRM_Power ? TEXT("MW") : Metric == EFactoryResearchMetric::EFRM_Complexity ? TEXT("buildings") : TEXT("raw items / min");
+	if (Values.Num() == 0) return TEXT("No locked recipe would improve this plan.\n");
+
+	FString ValuesString = FString::Printf(TEXT("%d locked recipes would improve this plan (saving %s):\n"), Values.Num(), Unit);
+	for (int32 i = 0; i < FMath::Min(Values.Num(), MaxValues); ++i)
+	{
+		const FFicsitPlannerRecipeValue& Value = Values[i];
+		ValuesString += FString::Printf(TEXT("%d. %s: -%.2f %s (%.2fx %s / min, -%.3f each)%s\n"), i + 1, *Index.GetRecipe(Value.Recipe).Name, Value.Saving, Unit,
+			Value.Demand, *Index.GetItem(Value.Item).Name, Value.UnitSaving, Value.bExact ? TEXT("") : TEXT(" (estimate)"));
+	}
+	return ValuesString;
+}
+
+void FFicsitPlannerCore::WritePlan(const FFicsitPlannerPlan& Plan, IFicsitPlannerPlanWriter& Writer) const
+{
+	if (Plan.Nodes.Num() == 0) return;
+	Writer.BeginPlan(MakeHeader(Plan));
+
+	// Depth-first, same numbering as PlanToString (exit entries close nodes once their inputs are written)
+	struct FEntry
+	{
+		int32 Node;
+		int32 Depth;
+		int32 ParentId;
+		bool bExit;
+	};
+	TArray<FEntry> NodeStack;
+	NodeStack.Add({0, 0, 0, false});
+	int32 CurrentNodeIndex = 1;
+	while (NodeStack.Num() > 0)
+	{
+		const FEntry Entry = NodeStack.Pop();
+		if (Entry.bExit)
+		{
+			Writer.EndNode();
+			continue;
+		}
+
+		const FFicsitPlannerPlanNode& GroupNode = Plan.Nodes[Entry.Node];
+		if (GroupNode.IsInput()) continue;
+		const FFicsitPlannerPlanNode* SelectedNode = Plan.GetSelectedNode(GroupNode);
+		if (!SelectedNode)
+		{
+			UE_LOG(LogFicsitPlannerCore, Warning, TEXT("Skipping %s: option %d of %d is out of bounds!"),
+				*Index.GetItem(GroupNode.Item).Name, GroupNode.Selected + 1, GroupNode.Alternatives.Num());
+			continue;
+		}
+		const FFicsitPlannerPlanNode& Node = *SelectedNode;
+
+		FFicsitPlannerPlanRow Row;
+		Row.NodeId = CurrentNodeIndex++;
+		Row.ParentId = Entry.ParentId;
+		Row.Depth = Entry.Depth;
+		Row.Item = Index.GetItem(Node.Item).Name;
+		Row.Rate = Node.Rate;
+		Row.Recipe = Index.GetRecipe(Node.Recipe).Name;
+		Row.Multiplier = Node.Multiplier;
+		Row.Power = Node.Power;
+		Row.Complexity = Node.Complexity;
+		const FFicsitPlannerTransport Transport = SizeEdge(Node);
+		Row.Transport = FFicsitPlannerLogistics::TransportToString(Transport);
+		Row.Lines = Transport.Lines;
+		Row.bOverCapacity = Transport.bOverCapacity;
+		if (GroupNode.IsGroup())
+		{
+			Row.Option = GroupNode.Selected + 1;
+			Row.NumOptions = GroupNode.Alternatives.Num();
+		}
+		if (Node.IsLoop())
+		{
+			const FFicsitPlannerLoopSolution& Solution = Index.GetGraph(Plan.bAllowLockedRecipes).Loops[Node.Item][Node.Loop];
+			for (int32 i = 0; i < Solution.Recipes.Num(); ++i)
+			{
+				Row.LoopRecipes.Add({Index.GetRecipe(Solution.Recipes[i]).Name, Solution.Multipliers[i] * Node.Rate});
+			}
+		}
+		Writer.BeginNode(Row);
+
+		NodeStack.Add({Entry.Node, Entry.Depth, Entry.ParentId, true});
+		for (const int32 Child : Node.Children) NodeStack.Add({Child, Entry.Depth + 1, Row.NodeId, false});
+	}
+
+	Writer.EndPlan();
+}
+
+void FFicsitPlannerCore::WriteBill(const FFicsitPlannerPlan& Plan, IFicsitPlannerPlanWriter& Writer) const
+{
+	if (Plan.Nodes.Num() == 0) return;
+
+	FFicsitPlannerBillOfMaterials Bill;
+	FlattenPlan(Plan, Bill);
+	Writer.WriteBill(MakeHeader(Plan), Bill, Index);
+}
+
+FFicsitPlannerPlanHeader FFicsitPlannerCore::MakeHeader(const FFicsitPlannerPlan& Plan) const
+{
+	const FFicsitPlannerPlanNode& Root = Plan.Nodes[0];
+	return {Index.GetItem(Root.Item).Name, Root.Rate, Root.TotalPower, Root.TotalComplexity, CountEdgesOverCapacity(Plan)};
+}
+
+int32 FFicsitPlannerCore::CreateNode(FFicsitPlannerPlan& Plan, const int32 Item, const float Rate, TArray<int32>& VisitedRecipes, FFicsitPlannerPlanCache* Cache) const
+{
+	// Items without recipes are leaf inputs, not worth caching
+	if (!Cache || Index.GetGraph(Plan.bAllowLockedRecipes).Producers[Item].Num() == 0)
+	{
+		return ExpandNode(Plan, Item, Rate, VisitedRecipes, Cache);
+	}
+
+	// Cached sub-plans are made for 1 / min, and scaled to the rate when copied in
+	TSharedPtr<const FFicsitPlannerPlan> Fragment = Cache->Find(Item, VisitedRecipes);
+	if (!Fragment)
+	{
+		FFicsitPlannerPlan NewFragment;
+		NewFragment.bAllowLockedRecipes = Plan.bAllowLockedRecipes;
+		ExpandNode(NewFragment, Item, 1.0f, VisitedRecipes, Cache);
+		Fragment = Cache->Add(Item, VisitedRecipes, MakeShared<const FFicsitPlannerPlan>(MoveTemp(NewFragment)));
+	}
+
+	return AppendFragment(Plan, *Fragment, Rate);
+}
+
+int32 FFicsitPlannerCore::AppendFragment(FFicsitPlannerPlan& Plan, const FFicsitPlannerPlan& Fragment, const float Rate) const
+{
+	const int32 Offset = Plan.Nodes.Num();
+	Plan.Nodes.Reserve(Offset + Fragment.Nodes.Num());
+	for (const FFicsitPlannerPlanNode& FragmentNode : Fragment.Nodes)
+	{
+		FFicsitPlannerPlanNode& Node = Plan.Nodes.Add_GetRef(FragmentNode);
+		for (int32& Child : Node.Children) Child += Offset;
+		for (int32& Alternative : Node.Alternatives) Alternative += Offset;
+
+		// Rates, multipliers & power are linear in the rate, complexity is recomputed (whole buildings)
+		Node.Rate *= Rate;
+		if (Node.IsGroup() || Node.IsInput()) continue;
+		Node.Multiplier *= Rate;
+		Node.Power *= Rate;
+		Node.Complexity = ComputeComplexity(Plan, Node);
+	}
+	return Offset;
+}
+
+int32 FFicsitPlannerCore::ComputeComplexity(const FFicsitPlannerPlan& Plan, const FFicsitPlannerPlanNode& Node) const
+{
+	if (!Node.IsLoop()) return RECIPE_COMPLEXITY + BUILDING_COMPLEXITY * FMath::CeilToInt(Node.Multiplier);
+
+	// Loops count every recipe they run
+	int32 Complexity = 0;
+	for (const float LoopMultiplier : Index.GetGraph(Plan.bAllowLockedRecipes).Loops[Node.Item][Node.Loop].Multipliers)
+	{
+		Complexity += RECIPE_COMPLEXITY + BUILDING_COMPLEXITY * FMath::CeilToInt(LoopMultiplier * Node.Rate);
+	}
+	return Complexity;
+}
+
+void FFicsitPlannerCore::GetAlternatives(const bool bAllowLockedRecipes, const int32 Item, const TArray<int32>& VisitedRecipes, TArray<int32>& OutRecipes, TArray<int32>& OutLoops) const
+{
+	const FFicsitPlannerRecipeGraph& Graph = Index.GetGraph(bAllowLockedRecipes);
+
+	// PART 1: Usable recipes (pruned recipes are already left out of the graph), minus visited ones
+	OutRecipes = Graph.Producers[Item];
+	OutRecipes.RemoveAll([&](const int32 Recipe) { return VisitedRecipes.Contains(Recipe); });
+
+	// PART 2: Items inside a recipe loop are planned through the loop's steady-state solutions
+	OutLoops.Reset();
+	if (Index.IsLoopItem(bAllowLockedRecipes, Item))
+	{
+		OutRecipes.RemoveAll([&](const int32 Recipe) { return Index.ConsumesFromComponent(bAllowLockedRecipes, Recipe, Item); });
+		for (int32 Loop = 0; Loop < Graph.Loops[Item].Num(); ++Loop)
+		{
+			const bool bVisited = Graph.Loops[Item][Loop].Recipes.ContainsByPredicate([&](const int32 LoopRecipe) { return VisitedRecipes.Contains(LoopRecipe); });
+			if (!bVisited) OutLoops.Add(Loop);
+		}
+	}
+}
+
+FFicsitPlannerPlanEstimate FFicsitPlannerCore::EstimateNode(const bool bAllowLockedRecipes, const int32 Item, TArray<int32>& VisitedRecipes, TMap<FFicsitPlannerSubPlanKey, FFicsitPlannerPlanEstimate>& SubPlans, const int32 MaxSubPlans, bool& bComplete) const
+{
+	const FFicsitPlannerRecipeGraph& Graph = Index.GetGraph(bAllowLockedRecipes);
+
+	// Sub-plans with the same key expand the same way, so each one is counted once
+	FFicsitPlannerSubPlanKey Key = FFicsitPlannerSubPlanKey::Make(Graph, Item, VisitedRecipes);
+	if (const FFicsitPlannerPlanEstimate* SubPlan = SubPlans.Find(Key)) return *SubPlan;
+
+	FFicsitPlannerPlanEstimate Count;
+	Count.Nodes = 1.0;
+
+	// Out of budget, the node is counted alone
+	if (SubPlans.Num() >= MaxSubPlans)
+	{
+		bComplete = false;
+		return Count;
+	}
+
+	// Same alternatives as ExpandNode
+	TArray<int32> Recipes;
+	TArray<int32> Loops;
+	GetAlternatives(bAllowLockedRecipes, Item, VisitedRecipes, Recipes, Loops);
+
+	const auto AddInputs = [&](const TArray<int32>& AddedRecipes, const auto& Inputs)
+	{
+		VisitedRecipes.Append(AddedRecipes);
+		for (const FFicsitPlannerItemRate& Input : Inputs)
+		{
+			const FFicsitPlannerPlanEstimate InputCount = EstimateNode(bAllowLockedRecipes, Input.Item, VisitedRecipes, SubPlans, MaxSubPlans, bComplete);
+			Count.Nodes += InputCount.Nodes;
+			Count.Inputs += InputCount.Inputs;
+			Count.Groups += InputCount.Groups;
+		}
+		VisitedRecipes.SetNum(VisitedRecipes.Num() - AddedRecipes.Num());
+	};
+
+	const int32 NumAlternatives = Recipes.Num() + Loops.Num();
+	if (NumAlternatives == 0)
+	{
+		// OPTION 1: Leaf input
+		Count.Inputs = 1.0;
+	}
+	else
+	{
+		// OPTION 2 & 3: Every alternative (one node each, plus the group node if there are several)
+		if (NumAlternatives > 1)
+		{
+			Count.Nodes += NumAlternatives;
+			Count.Groups = 1.0;
+		}
+		for (const int32 Recipe : Recipes) AddInputs({Recipe}, Index.GetRecipe(Recipe).Ingredients);
+		for (const int32 Loop : Loops) AddInputs(Graph.Loops[Item][Loop].Recipes, Graph.Loops[Item][Loop].Inputs);
+	}
+
+	SubPlans.Add(MoveTemp(Key), Count);
+	return Count;
+}
+
+int32 FFicsitPlannerCore::ExpandNode(FFicsitPlannerPlan& Plan, const int32 Item, const float Rate, TArray<int32>& VisitedRecipes, FFicsitPlannerPlanCache* Cache) const
+{
+	// Usable recipes & loops, minus visited ones
+	TArray<int32> Recipes;
+	TArray<int32> Loops;
+	GetAlternatives(Plan.bAllowLockedRecipes, Item, VisitedRecipes, Recipes, Loops);
+
+	// OPTION 1: Leaf input (raw resource, or nothing left to produce it with)
+	if (Recipes.Num() + Loops.Num() == 0)
+	{
+		FFicsitPlannerPlanNode& Node = Plan.Nodes.AddDefaulted_GetRef();
+		Node.Item = Item;
+		Node.Rate = Rate;
+		return Plan.Nodes.Num() - 1;
+	}
+
+	// OPTION 2: Single recipe or loop
+	if (Recipes.Num() + Loops.Num() == 1)
+	{
+		return Recipes.Num() == 1 ?
+			CreateRecipeNode(Plan, Item, Rate, Recipes[0], VisitedRecipes, Cache) :
+			CreateLoopNode(Plan, Item, Rate, Loops[0], VisitedRecipes, Cache);
+	}
+
+	// OPTION 3: Multiple alternatives
+	const int32 GroupNode = Plan.Nodes.Num();
+	FFicsitPlannerPlanNode& Group = Plan.Nodes.AddDefaulted_GetRef();
+	Group.Item = Item;
+	Group.Rate = Rate;
+
+	TArray<int32> Alternatives;
+	Alternatives.Reserve(Recipes.Num() + Loops.Num());
+	for (const int32 Recipe : Recipes) Alternatives.Add(CreateRecipeNode(Plan, Item, Rate, Recipe, VisitedRecipes, Cache));
+	for (const int32 Loop : Loops) Alternatives.Add(CreateLoopNode(Plan, Item, Rate, Loop, VisitedRecipes, Cache));
+
+	Plan.Nodes[GroupNode].Alternatives = MoveTemp(Alternatives);
+	Plan.Nodes[GroupNode].Selected = 0;
+	return GroupNode;
+}
+
+int32 FFicsitPlannerCore::CreateRecipeNode(FFicsitPlannerPlan& Plan, const int32 Item, const float Rate, const int32 Recipe, TArray<int32>& VisitedRecipes, FFicsitPlannerPlanCache* Cache) const
+{
+	// PART 1: Node metrics
+	const int32 NodeIndex = AddRecipeNode(Plan, Item, Rate, Recipe);
+	const float Multiplier = Plan.Nodes[NodeIndex].Multiplier;
+
+	// PART 2: Inputs (the node array may grow, so children are added by index)
+	VisitedRecipes.Push(Recipe);
+	for (const FFicsitPlannerItemRate& Ingredient : Index.GetRecipe(Recipe).Ingredients)
+	{
+		const int32 Child = CreateNode(Plan, Ingredient.Item, Ingredient.Rate * Multiplier, VisitedRecipes, Cache);
+		Plan.Nodes[NodeIndex].Children.Add(Child);
+	}
+	VisitedRecipes.Pop();
+
+	return NodeIndex;
+}
+
+int32 FFicsitPlannerCore::CreateLoopNode(FFicsitPlannerPlan& Plan, const int32 Item, const float Rate, const int32 Loop, TArray<int32>& VisitedRecipes, FFicsitPlannerPlanCache* Cache) const
+{
+	const FFicsitPlannerLoopSolution& Solution = Index.GetGraph(Plan.bAllowLockedRecipes).Loops[Item][Loop];
+
+	// PART 1: Node metrics, summed over every recipe of the loop
+	const int32 NodeIndex = AddLoopNode(Plan, Item, Rate, Loop);
+
+	// PART 2: Inputs entering the loop
+	VisitedRecipes.Append(Solution.Recipes);
+	for (const FFicsitPlannerItemRate& Input : Solution.Inputs)
+	{
+		const int32 Child = CreateNode(Plan, Input.Item, Input.Rate * Rate, VisitedRecipes, Cache);
+		Plan.Nodes[NodeIndex].Children.Add(Child);
+	}
+	VisitedRecipes.SetNum(VisitedRecipes.Num() - Solution.Recipes.Num());
+
+	return NodeIndex;
+}
+
+int32 FFicsitPlannerCore::CreateOptimalNode(FFicsitPlannerPlan& Plan, const int32 Item, const float Rate) const
+{
+	const FFicsitPlannerUnitCost& Cost = Index.GetUnitCost(Plan.bAllowLockedRecipes, Item);
+
+	// OPTION 1: Leaf input
+	if (Cost.PowerRecipe == INDEX_NONE)
+	{
+		FFicsitPlannerPlanNode& Node = Plan.Nodes.AddDefaulted_GetRef();
+		Node.Item = Item;
+		Node.Rate = Rate;
+		return Plan.Nodes.Num() - 1;
+	}
+
+	// OPTION 2: Loop (inputs are per 1 / min of the target)
+	if (Cost.PowerLoop != INDEX_NONE)
+	{
+		const int32 NodeIndex = AddLoopNode(Plan, Item, Rate, Cost.PowerLoop);
+		for (const FFicsitPlannerItemRate& Input : Index.GetGraph(Plan.bAllowLockedRecipes).Loops[Item][Cost.PowerLoop].Inputs)
+		{
+			const int32 Child = CreateOptimalNode(Plan, Input.Item, Input.Rate * Rate);
+			Plan.Nodes[NodeIndex].Children.Add(Child);
+		}
+		return NodeIndex;
+	}
+
+	// OPTION 3: Recipe
+	const int32 NodeIndex = AddRecipeNode(Plan, Item, Rate, Cost.PowerRecipe);
+	const float Multiplier = Plan.Nodes[NodeIndex].Multiplier;
+	for (const FFicsitPlannerItemRate& Ingredient : Index.GetRecipe(Cost.PowerRecipe).Ingredients)
+	{
+		const int32 Child = CreateOptimalNode(Plan, Ingredient.Item, Ingredient.Rate * Multiplier);
+		Plan.Nodes[NodeIndex].Children.Add(Child);
+	}
+	return NodeIndex;
+}
+
+int32 FFicsitPlannerCore::AddRecipeNode(FFicsitPlannerPlan& Plan, const int32 Item, const float Rate, const int32 Recipe) const
+{
+	const float ProductRate = Index.GetProductRate(Recipe, Item);
+	const float Multiplier = ProductRate > 0.0f ? Rate / ProductRate : 1.0f;
+
+	FFicsitPlannerPlanNode& Node = Plan.Nodes.AddDefaulted_GetRef();
+	Node.Item = Item;
+	Node.Rate = Rate;
+	Node.Recipe = Recipe;
+	Node.Multiplier = Multiplier;
+	Node.Power = Index.GetRecipe(Recipe).Power * Multiplier;
+	Node.Complexity = ComputeComplexity(Plan, Node);
+	return Plan.Nodes.Num() - 1;
+}
+
+int32 FFicsitPlannerCore::AddLoopNode(FFicsitPlannerPlan& Plan, const int32 Item, const float Rate, const int32 Loop) const
+{
+	const FFicsitPlannerLoopSolution& Solution = Index.GetGraph(Plan.bAllowLockedRecipes).Loops[Item][Loop];
+
+	FFicsitPlannerPlanNode& Node = Plan.Nodes.AddDefaulted_GetRef();
+	Node.Item = Item;
+	Node.Rate = Rate;
+	Node.Recipe = Solution.Recipes[0];
+	Node.Loop = Loop;
+	Node.Multiplier = Solution.Multipliers[0] * Rate;
+	for (int32 i = 0; i < Solution.Recipes.Num(); ++i)
+	{
+		Node.Power += Index.GetRecipe(Solution.Recipes[i]).Power * Solution.Multipliers[i] * Rate;
+	}
+	Node.Complexity = ComputeComplexity(Plan, Node);
+	return Plan.Nodes.Num() - 1;
+}
+
+void FFicsitPlannerCore::RefreshNode(FFicsitPlannerPlan& Plan, const int32 NodeIndex, const float PowerWeight, const float ComplexityWeight, const bool bReselect) const
+{
+	// Children first (every alternative, so reselecting a group later doesn't need a refresh)
+	for (const int32 Child : Plan.Nodes[NodeIndex].Children) RefreshNode(Plan, Child, PowerWeight, ComplexityWeight, bReselect);
+	for (const int32 Alternative : Plan.Nodes[NodeIndex].Alternatives) RefreshNode(Plan, Alternative, PowerWeight, ComplexityWeight, bReselect);
+
+	FFicsitPlannerPlanNode& Node = Plan.Nodes[NodeIndex];
+
+	// Groups take the metrics of their selected alternative
+	if (Node.IsGroup())
+	{
+		if (bReselect)
+		{
+			float BestScore = TNumericLimits<float>::Max();
+			for (int32 i = 0; i < Node.Alternatives.Num(); ++i)
+			{
+				const FFicsitPlannerPlanNode& Alternative = Plan.Nodes[Node.Alternatives[i]];
+				const float Score = PowerWeight * Alternative.TotalPower + ComplexityWeight * Alternative.TotalComplexity;
+				if (Score < BestScore)
+				{
+					BestScore = Score;
+					Node.Selected = i;
+				}
+			}
+		}
+
+		// Every score may be inf or NaN (or the group never had a selection), fall back to the first alternative
+		if (!Node.Alternatives.IsValidIndex(Node.Selected)) Node.Selected = 0;
+		const FFicsitPlannerPlanNode& Selected = Plan.Nodes[Node.Alternatives[Node.Selected]];
+		Node.Recipe = Selected.Recipe;
+		Node.Multiplier = Selected.Multiplier;
+		Node.Power = Selected.Power;
+		Node.Complexity = Selected.Complexity;
+		Node.TotalPower = Selected.TotalPower;
+		Node.TotalComplexity = Selected.TotalComplexity;
+		return;
+	}
+
+	// Other nodes sum up their inputs
+	Node.TotalPower = Node.Power;
+	Node.TotalComplexity = Node.Complexity;
+	for (const int32 Child : Node.Children)
+	{
+		Node.TotalPower += Plan.Nodes[Child].TotalPower;
+		Node.TotalComplexity += Plan.Nodes[Child].TotalComplexity;
+	}
+}
+
+FFicsitPlannerSubPlanKey FFicsitPlannerSubPlanKey::Make(const FFicsitPlannerRecipeGraph& Graph, const int32 Item, const TArray<int32>& VisitedRecipes)
+{
+	// Only visited recipes the item's sub-plan could run change how it expands
+	const TBitArray<>& Reach = Graph.ComponentRecipes[Graph.ItemComponents[Item]];
+	FFicsitPlannerSubPlanKey Key;
+	Key.Item = Item;
+	for (const int32 Recipe : VisitedRecipes)
+	{
+		if (Reach[Recipe]) Key.VisitedRecipes.Add(Recipe);
+	}
+	Key.VisitedRecipes.Sort();
+	return Key;
+}
+
+FFicsitPlannerPlanCache::FFicsitPlannerPlanCache(const FFicsitPlannerRecipeIndex& Index, const bool bInAllowLockedRecipes)
+	: bAllowLockedRecipes(bInAllowLockedRecipes), Graph(Index.GetGraph(bInAllowLockedRecipes))
+{
+}
+
+TSharedPtr<const FFicsitPlannerPlan> FFicsitPlannerPlanCache::Find(const int32 Item, const TArray<int32>& VisitedRecipes) const
+{
+	const FFicsitPlannerSubPlanKey Key = FFicsitPlannerSubPlanKey::Make(Graph, Item, VisitedRecipes);
+
+	FReadScopeLock ReadLock(Lock);
+	const TSharedPtr<const FFicsitPlannerPlan>* Fragment = Fragments.Find(Key);
+	(Fragment ? Hits : Misses).fetch_add(1, std::memory_order_relaxed);
+	return Fragment ? *Fragment : nullptr;
+}
+
+TSharedPtr<const FFicsitPlannerPlan> FFicsitPlannerPlanCache::Add(const int32 Item, const TArray<int32>& VisitedRecipes, TSharedPtr<const FFicsitPlannerPlan> Fragment)
+{
+	FFicsitPlannerSubPlanKey Key = FFicsitPlannerSubPlanKey::Make(Graph, Item, VisitedRecipes);
+
+	FWriteScopeLock WriteLock(Lock);
+
+	// Another planner may have added the same sub-plan in the meantime, keep the first one
+	if (const TSharedPtr<const FFicsitPlannerPlan>* Existing = Fragments.Find(Key)) return *Existing;
+
+	// Past the budget, sub-plans are still returned but no longer kept
+	if (CachedNodes + Fragment->Nodes.Num() > MAX_CACHED_NODES) return Fragment;
+
+	CachedNodes += Fragment->Nodes.Num();
+	Fragments.Add(MoveTemp(Key), Fragment);
+	return Fragment;
+}
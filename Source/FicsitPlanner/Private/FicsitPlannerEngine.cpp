@@ -1,10 +1,30 @@
 #include "FicsitPlannerEngine.h"
 
 #include "FGBuildableManufacturer.h"
+#include "FicsitPlannerChatCommand.h"
 #include "FGPlayerController.h"
 #include "FGRecipeManager.h"
 #include "FicsitPlannerFactory.h"
 #include "FicsitPlannerFactoryGroup.h"
+#include "FicsitPlannerFactoryLoop.h"
+#include "FicsitPlannerJobQueue.h"
+#include "FicsitPlannerClockSpeed.h"
+#include "FicsitPlannerCore.h"
+#include "FicsitPlannerPlanWriter.h"
+#include "FicsitPlannerRecipeSource.h"
+#include "Algo/Reverse.h"
+#include "Async/ParallelFor.h"
+#include "Command/ChatCommandLibrary.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	// Display names (empty for groups whose selected factory is out of range, which have no product or recipe)
+	FString GetItemDisplayName(const TSubclassOf<UFGItemDescriptor> Item) { return Item ? Item->GetDefaultObject<UFGItemDescriptor>()->mDisplayName.ToString() : FString(); }
+	FString GetRecipeDisplayName(const TSubclassOf<UFGRecipe> Recipe) { return Recipe ? Recipe->GetDefaultObject<UFGRecipe>()->GetDisplayName().ToString() : FString(); }
+}
 
 AFicsitPlannerEngine::AFicsitPlannerEngine()
 {
@@ -13,6 +33,9 @@ AFicsitPlannerEngine::AFicsitPlannerEngine()
  // Change replication policy to client-only
  ReplicationPolicy = ESubsystemReplicationPolicy::SpawnOnClient;
 
+ // Tick to finish queued jobs
+ PrimaryActorTick.bCanEverTick = true;
+
  UE_LOG(LogFicsitPlannerEngine, Display, TEXT("FicsitPlannerEngine created!"));
 }
 
@@ -20,11 +43,8 @@ AFicsitPlannerEngine::~AFicsitPlannerEngine()
 {
  UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Destroying FicsitPlannerEngine..."));
 
- // Clear all items and recipes
- AllItems.Empty();
- UnlockedItems.Empty();
- AllRecipesMap.Empty();
- UnlockedRecipesMap.Empty();
+ // Wait for running jobs (their callbacks use the engine), recipe data goes with its last reference
+ JobQueue.Wait();
 
  UE_LOG(LogFicsitPlannerEngine, Display, TEXT("FicsitPlannerEngine destroyed!"));
 }
@@ -32,8 +52,19 @@ AFicsitPlannerEngine::~AFicsitPlannerEngine()
 void AFicsitPlannerEngine::Initialize()
 {
  UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Initializing FicsitPlannerEngine..."));
+ SharedPlans.SetMaxNodes(MaxPlanNodes);
  ReloadGameData();
 
+ // Register chat commands (once per world)
+ if (!bRegisteredChatCommands)
+ {
+  if (AChatCommandSubsystem* ChatCommandSubsystem = AChatCommandSubsystem::Get(this))
+  {
+   ChatCommandSubsystem->RegisterCommand(TEXT("FicsitPlanner"), AFicsitPlannerChatCommand::StaticClass());
+   bRegisteredChatCommands = true;
+  }
+ }
+
  UE_LOG(LogFicsitPlannerEngine, Display, TEXT("FicsitPlannerEngine initialized!"));
 }
 
@@ -41,6 +72,14 @@ void AFicsitPlannerEngine::ReloadGameData()
 {
  UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Loading RecipeData..."));
 
+ // Build a new version of the recipe data aside (running jobs & shared plans keep theirs), published once complete
+ const TSharedRef<FFicsitPlannerRecipeDataset, ESPMode::ThreadSafe> NewDataset = MakeShared<FFicsitPlannerRecipeDataset, ESPMode::ThreadSafe>();
+ NewDataset->Version = Dataset->Version + 1;
+ FFicsitPlannerRecipeIndex& RecipeIndex = NewDataset->Index;
+
+ // Exclusion rules (kept by the index, compiled into masks once the recipes are loaded)
+ RecipeIndex.SetExclusionRules(GetExclusionRules());
+
  // Get Recipe Manager
  AFGRecipeManager * RecipeManager = AFGRecipeManager::Get(this);
 
@@ -57,67 +96,63 @@ void AFicsitPlannerEngine::ReloadGameData()
 
  TArray<TSubclassOf<UFGRecipe>> AllRecipes = RecipeManager->GetAllRecipes();
 
- // Register recipes
- for (const TSubclassOf<UFGRecipe>& Recipe : UnlockedRecipes) {
- 	// Get recipe
- 	const UFGRecipe* RecipeObj = Recipe->GetDefaultObject<UFGRecipe>();
-
- 	// Get ingredients
- 	TArray<FItemAmount> Ingredients = RecipeObj->GetIngredients();
-
- 	// Check if the recipe contains SAM as an ingredient
- 	bool bContainsSAM = false;
- 	for (const FItemAmount& Ingredient : Ingredients)
+ // Reuse the recipe tables another world (or the last reload) compiled, or load them from their snapshot, if the loaded recipes & mods didn't change
+ const uint64 SnapshotHash = FFicsitPlannerRecipeIndex::ComputeSnapshotHash(AllRecipes);
+ const FString SnapshotPath = GetRecipeSnapshotPath();
+ if (RecipeIndex.LoadSharedTables(SnapshotHash))
+ {
+ 	UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Reusing recipe tables shared by this process."));
+ }
+ else if (RecipeIndex.LoadSnapshot(SnapshotPath, SnapshotHash))
+ {
+ 	UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Loaded recipe index from snapshot %s."), *SnapshotPath);
+ 	RecipeIndex.ShareTables(SnapshotHash);
+ }
+ else
+ {
+ 	// Compile the index from the recipe CDOs (excluded items, recipes & buildings are masked by the index, not filtered here)
+ 	TArray<TSubclassOf<UFGRecipe>> PlannerRecipes;
+ 	for (const TSubclassOf<UFGRecipe>& Recipe : AllRecipes)
  	{
- 		if (Ingredient.ItemClass->GetName() == "Desc_SAM_C" || Ingredient.ItemClass->GetName() == "Desc_SAMIngot_C")
- 		{
- 			bContainsSAM = true;
- 			break;
- 		}
+ 		// Ensure the recipe is produced in a building
+ 		if (!RecipeProducedInBuilding(Recipe)) continue;
+
+ 		PlannerRecipes.Add(Recipe);
  	}
 
- 	// If the recipe contains SAM, skip it
- 	if (bContainsSAM)
+ 	// Only a complete index is shared & saved (a failed compile would otherwise be loaded again on the next start)
+ 	if (!RecipeIndex.Compile(FFicsitPlannerGameRecipeSource(PlannerRecipes, UnlockedRecipes)))
  	{
- 		UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Skipping recipe %s because it contains SAM!"), *Recipe->GetName());
- 		continue;
+ 		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to compile the recipe index!"));
  	}
-
- 	RegisterUnlockedRecipe(Recipe);
- }
-	
- 	// RegisterUnlockedRecipe(Recipe);
- for (const TSubclassOf<UFGRecipe>& Recipe : AllRecipes)
- {
- 	// Get recipe
- 	const UFGRecipe* RecipeObj = Recipe->GetDefaultObject<UFGRecipe>();
-
- 	// Get ingredients
- 	TArray<FItemAmount> Ingredients = RecipeObj->GetIngredients();
-
- 	// Check if the recipe contains SAM as an ingredient
- 	bool bContainsSAM = false;
- 	for (const FItemAmount& Ingredient : Ingredients)
+ 	else
  	{
- 		if (Ingredient.ItemClass->GetName() == "Desc_SAM_C" || Ingredient.ItemClass->GetName() == "Desc_SAMIngot_C")
+ 		RecipeIndex.ShareTables(SnapshotHash);
+ 		if (!RecipeIndex.SaveSnapshot(SnapshotPath, SnapshotHash))
  		{
- 			bContainsSAM = true;
- 			break;
+ 			UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Failed to write recipe snapshot %s!"), *SnapshotPath);
  		}
  	}
+ }
 
- 	// If the recipe contains SAM, skip it
- 	if (bContainsSAM)
- 	{
- 		UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Skipping recipe %s because it contains SAM!"), *Recipe->GetName());
- 		continue;
- 	}
+ // Apply unlocked recipes (prunes recipes, and solves recipe loops for both lock modes)
+ RecipeIndex.SetUnlockedRecipes(UnlockedRecipes);
+ Logistics.SetUnlockedRecipes(UnlockedRecipes);
 
- 	RegisterRecipe(Recipe);
- }
+ // Register recipes, and publish
+ NewDataset->RegisterRecipes();
+ PublishDataset(NewDataset);
 
  // Log the number of items and recipes loaded
- UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Loaded %d items and %d recipes (%d items unlocked, %d recipes unlocked)."), AllItems.Num(), AllRecipes.Num(), UnlockedItems.Num(), UnlockedRecipes.Num());
+ UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Loaded %d items and %d recipes (%d items unlocked, %d recipes unlocked)."), Dataset->AllItems.Num(), AllRecipes.Num(), Dataset->UnlockedItems.Num(), UnlockedRecipes.Num());
+ UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Solved %d recipe loops (%d unlocked)."), RecipeIndex.NumLoopSolutions(true), RecipeIndex.NumLoopSolutions(false));
+ UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Pruned %d recipe alternatives (%d unlocked)."), RecipeIndex.GetGraph(true).PrunedRecipes.Num(), RecipeIndex.GetGraph(false).PrunedRecipes.Num());
+ UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Excluded %d recipes."), RecipeIndex.NumExcludedRecipes());
+}
+
+FString AFicsitPlannerEngine::GetRecipeSnapshotPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("FicsitPlanner") / TEXT("RecipeIndex.bin");
 }
 
 float AFicsitPlannerEngine::GetFactoryMultiplier(const TSubclassOf<UFGRecipe> Recipe, const FItemAmount Target)
@@ -148,23 +183,8 @@ float AFicsitPlannerEngine::GetFactoryMultiplier(const TSubclassOf<UFGRecipe> Re
 
 float AFicsitPlannerEngine::GetFactoryPowerConsumption(const TSubclassOf<UFGRecipe> Recipe, const float Multiplier)
 {
-	// Get the default values of the recipe
-	const UFGRecipe* RecipeObj = Recipe->GetDefaultObject<UFGRecipe>();
-
-	// Get producers
-	TArray<TSubclassOf<UObject>> ProducedIn;
-	RecipeObj->GetProducedIn(ProducedIn);
-
 	// Get the first producer that is a building
-	TSubclassOf<UObject> Producer;
-	for (const TSubclassOf<UObject>& Building : ProducedIn)
-	{
-		if (Building->GetName().StartsWith("Build_"))
-		{
-			Producer = Building;
-			break;
-		}
-	}
+	const TSubclassOf<UObject> Producer = GetRecipeBuilding(Recipe);
 
 	// Get the power consumption of the producer, or return 0 if not selected
 	if (!Producer)
@@ -183,7 +203,72 @@ float AFicsitPlannerEngine::GetFactoryPowerConsumption(const TSubclassOf<UFGReci
 	return ProducerBuild->GetDefaultProducingPowerConsumption() * Multiplier;
 }
 
-UFicsitPlannerFactory* AFicsitPlannerEngine::CreateFactoryPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization)
+TSubclassOf<UObject> AFicsitPlannerEngine::GetRecipeBuilding(const TSubclassOf<UFGRecipe> Recipe)
+{
+	// Get producers
+	TArray<TSubclassOf<UObject>> ProducedIn;
+	Recipe->GetDefaultObject<UFGRecipe>()->GetProducedIn(ProducedIn);
+
+	// Get the first producer that is a building
+	for (const TSubclassOf<UObject>& Building : ProducedIn)
+	{
+		if (Building && Building->GetName().StartsWith("Build_")) return Building;
+	}
+	return nullptr;
+}
+
+UFicsitPlannerFactory* AFicsitPlannerEngine::CreateFactoryPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, bool bConfirmLargePlan)
+{
+	// Count the plan first, so huge requests don't freeze the game
+	const FFicsitPlannerPlanSizeEstimate Estimate = EstimateFactoryPlan(TargetProduct, bAllowLockedRecipes, Optimization);
+	if (Estimate.bNeedsConfirmation && !bConfirmLargePlan)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Large factory plan needs confirmation: %s"), *PlanEstimateToString(Estimate));
+		return nullptr;
+	}
+	if (Estimate.Strategy != EFactoryPlanStrategy::EFPS_Full)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Large factory plan: %s"), *PlanEstimateToString(Estimate));
+	}
+	return CreateFactoryPlanWithStrategy(TargetProduct, bAllowLockedRecipes, Optimization, Estimate.Strategy);
+}
+
+FFicsitPlannerPlanSizeEstimate AFicsitPlannerEngine::EstimateFactoryPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization)
+{
+	FFicsitPlannerPlanSizeEstimate Estimate;
+	const int32 Item = TargetProduct.ItemClass ? Dataset->Index.FindItem(TargetProduct.ItemClass) : INDEX_NONE;
+	if (Item == INDEX_NONE) return Estimate;
+
+	// Count on the core (leaf inputs get no factory object)
+	const FFicsitPlannerCore Core(Dataset->Index);
+	const FFicsitPlannerPlanEstimate PlanEstimate = Core.EstimatePlan(Item, bAllowLockedRecipes);
+	const auto ToInt64 = [](const double Value) { return static_cast<int64>(FMath::Min(Value, static_cast<double>(MAX_int64))); };
+
+	Estimate.Nodes = ToInt64(PlanEstimate.Nodes);
+	Estimate.Factories = ToInt64(PlanEstimate.Nodes - PlanEstimate.Inputs);
+	Estimate.Groups = ToInt64(PlanEstimate.Groups);
+	Estimate.FactoryBytes = ToInt64((PlanEstimate.Nodes - PlanEstimate.Inputs) * (sizeof(UFicsitPlannerFactory) + sizeof(UFicsitPlannerFactory*) + sizeof(FItemAmount)));
+	Estimate.bComplete = PlanEstimate.bComplete;
+	Estimate.Strategy = Core.ChooseStrategy(PlanEstimate, Item, bAllowLockedRecipes, Optimization, MaxFullPlanNodes, MaxPlanNodes);
+	Estimate.bNeedsConfirmation = FFicsitPlannerCore::NeedsConfirmation(Estimate.Strategy);
+	if (Estimate.Strategy == EFactoryPlanStrategy::EFPS_Memoized) Estimate.PlanBytes = ToInt64(PlanEstimate.Bytes);
+	return Estimate;
+}
+
+FString AFicsitPlannerEngine::PlanEstimateToString(const FFicsitPlannerPlanSizeEstimate& Estimate) const
+{
+	static const TCHAR* StrategyNames[] = {TEXT("full"), TEXT("memoized"), TEXT("optimal (best recipes only)"), TEXT("too large")};
+	FString EstimateString = FString::Printf(TEXT("%s%lld nodes (%lld factories, %lld groups), ~%lld KiB, strategy: %s"),
+		Estimate.bComplete ? TEXT("") : TEXT("over "), Estimate.Nodes, Estimate.Factories, Estimate.Groups,
+		(Estimate.FactoryBytes + Estimate.PlanBytes) / 1024, StrategyNames[Estimate.Strategy]);
+
+	if (Estimate.Strategy == EFactoryPlanStrategy::EFPS_Optimal) EstimateString += TEXT(" (too large to expand every alternative)");
+	if (Estimate.Strategy == EFactoryPlanStrategy::EFPS_TooLarge) EstimateString += TEXT(" (refused, pick a lower tier target, allow fewer recipes or plan for power)");
+	if (Estimate.bNeedsConfirmation) EstimateString += TEXT(", needs confirmation");
+	return EstimateString;
+}
+
+UFicsitPlannerFactory* AFicsitPlannerEngine::CreateFactoryPlanWithStrategy(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, EFactoryPlanStrategy Strategy)
 {
 	// Check if the target product is valid
 	if (!TargetProduct.ItemClass)
@@ -192,31 +277,228 @@ UFicsitPlannerFactory* AFicsitPlannerEngine::CreateFactoryPlan(FItemAmount Targe
 		return nullptr;
 	}
 
-	// Check if there are recipes for the target product
-	TArray<TSubclassOf<UFGRecipe>> Recipes = bAllowLockedRecipes ?
-		AllRecipesMap[TargetProduct.ItemClass] :
-		UnlockedRecipesMap[TargetProduct.ItemClass];
+	// OPTION 1: Too large to plan
+	if (Strategy == EFactoryPlanStrategy::EFPS_TooLarge)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Factory plan for %s is too large to create!"), *TargetProduct.ItemClass->GetName());
+		return nullptr;
+	}
+
+	// OPTION 2: Unit cost table (only for the objectives it's exact for, it would fall back to a full plan otherwise)
+	if (Strategy == EFactoryPlanStrategy::EFPS_Optimal)
+	{
+		const FFicsitPlannerCore Core(Dataset->Index);
+		if (!Core.SupportsOptimalPlan(Dataset->Index.FindItem(TargetProduct.ItemClass), bAllowLockedRecipes, Optimization))
+		{
+			UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Factory plan for %s can't be made from the unit cost table for this objective!"), *TargetProduct.ItemClass->GetName());
+			return nullptr;
+		}
+		return CreateOptimalFactoryPlan(TargetProduct, bAllowLockedRecipes, Optimization);
+	}
+
+	// OPTION 3: Planner core, sharing identical sub-plans
+	if (Strategy == EFactoryPlanStrategy::EFPS_Memoized)
+	{
+		const int32 Item = Dataset->Index.FindItem(TargetProduct.ItemClass);
+		const FFicsitPlannerCore Core(Dataset->Index);
+		FFicsitPlannerPlanCache Cache(Dataset->Index, bAllowLockedRecipes);
+		FFicsitPlannerPlan Plan;
+		if (!Core.CreatePlan(Item, TargetProduct.Amount, bAllowLockedRecipes, Optimization, Plan, &Cache)) return nullptr;
+		return CreateFactoryFromPlan(Plan, 0);
+	}
 
-	if (Recipes.Num() == 0)
+	// OPTION 4: Full, node by node
+	UFicsitPlannerFactory* Factory = CreateFactoryNode(TargetProduct, TArray<TSubclassOf<UFGRecipe>>(), bAllowLockedRecipes, Optimization);
+	if (!Factory)
 	{
 		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("No recipes found for target product %s!"), *TargetProduct.ItemClass->GetName());
 		return nullptr;
 	}
 
+	return Factory;
+}
+
+UFicsitPlannerFactory* AFicsitPlannerEngine::CreateFactoryNode(const FItemAmount Target, const TArray<TSubclassOf<UFGRecipe>>& VisitedRecipes, const bool bAllowLockedRecipes, const EFactoryOptimizationType Optimization)
+{
+	// PART 1: Check if there are recipes for the item
+	const TArray<TSubclassOf<UFGRecipe>>* ItemRecipes = bAllowLockedRecipes ?
+		Dataset->AllRecipesMap.Find(Target.ItemClass) :
+		Dataset->UnlockedRecipesMap.Find(Target.ItemClass);
+
+	if (!ItemRecipes)
+	{
+		if (bAllowLockedRecipes) UE_LOG(LogTemp, Warning, TEXT("No recipes found for input item %s!"), *Target.ItemClass->GetName());
+		else UE_LOG(LogTemp, Warning, TEXT("No unlocked recipes found for input item %s!"), *Target.ItemClass->GetName());
+		return nullptr;
+	}
+
+	// PART 2: Remove any visited or pruned (dead end / dominated) recipes from the list
+	const int32 ItemId = Dataset->Index.FindItem(Target.ItemClass);
+	TArray<TSubclassOf<UFGRecipe>> Recipes = *ItemRecipes;
+	for (const TSubclassOf<UFGRecipe>& VisitedRecipe : VisitedRecipes)
+	{
+		Recipes.Remove(VisitedRecipe);
+	}
+	Recipes.RemoveAll([&](const TSubclassOf<UFGRecipe>& Recipe)
+	{
+		return !Dataset->Index.IsUsableRecipe(bAllowLockedRecipes, ItemId, Dataset->Index.FindRecipe(Recipe));
+	});
+
+	// PART 3: Items inside a recipe loop are planned through the loop's steady-state solutions
+	// Recipes feeding back into the loop are only used there, instead of unrolling the loop along every path
+	TArray<const FFicsitPlannerLoopSolution*> Loops;
+	if (Dataset->Index.IsLoopItem(bAllowLockedRecipes, ItemId))
+	{
+		Recipes.RemoveAll([&](const TSubclassOf<UFGRecipe>& Recipe)
+		{
+			return Dataset->Index.ConsumesFromComponent(bAllowLockedRecipes, Dataset->Index.FindRecipe(Recipe), ItemId);
+		});
+
+		for (const FFicsitPlannerLoopSolution& Loop : Dataset->Index.GetGraph(bAllowLockedRecipes).Loops[ItemId])
+		{
+			// Skip loops reusing a recipe from further up this branch
+			const bool bVisited = Loop.Recipes.ContainsByPredicate([&](const int32 LoopRecipe)
+			{
+				return VisitedRecipes.Contains(Dataset->Index.GetRecipe(LoopRecipe).Class);
+			});
+			if (!bVisited) Loops.Add(&Loop);
+		}
+	}
+
 	// OPTION 1: Single recipe case
-	if (Recipes.Num() == 1)
+	if (Recipes.Num() == 1 && Loops.Num() == 0)
 	{
-		// Create a new factory
 		UFicsitPlannerFactory* Factory = NewObject<UFicsitPlannerFactory>();
-		Factory->Init(TargetProduct, Recipes[0], TArray<TSubclassOf<UFGRecipe>>(), bAllowLockedRecipes, Optimization, this);
+		Factory->Init(Target, Recipes[0], VisitedRecipes, bAllowLockedRecipes, Optimization, this);
 		return Factory;
 	}
 
-	// OPTION 2: Multiple recipes case
-	// Create a new factory group
-	UFicsitPlannerFactoryGroup* FactoryGroup = NewObject<UFicsitPlannerFactoryGroup>();
-	FactoryGroup->Init(TargetProduct, Recipes, TArray<TSubclassOf<UFGRecipe>>(), bAllowLockedRecipes, Optimization, this);
-	return FactoryGroup;
+	// OPTION 2: Single loop case
+	if (Recipes.Num() == 0 && Loops.Num() == 1)
+	{
+		UFicsitPlannerFactoryLoop* FactoryLoop = NewObject<UFicsitPlannerFactoryLoop>();
+		FactoryLoop->Init(Target, *Loops[0], VisitedRecipes, bAllowLockedRecipes, Optimization, this);
+		return FactoryLoop;
+	}
+
+	// OPTION 3: Multiple alternatives case
+	if (Recipes.Num() + Loops.Num() > 1)
+	{
+		UFicsitPlannerFactoryGroup* FactoryGroup = NewObject<UFicsitPlannerFactoryGroup>();
+		FactoryGroup->Init(Target, Recipes, Loops, VisitedRecipes, bAllowLockedRecipes, Optimization, this);
+
+		// Optimization: Select the best alternative
+		FactoryGroup->SelectBestFactory(Optimization);
+		return FactoryGroup;
+	}
+
+	// No recipes left (all visited)
+	return nullptr;
+}
+
+UFicsitPlannerFactory* AFicsitPlannerEngine::CreateOptimalFactoryPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization)
+{
+	// Check if the target product is valid
+	const int32 Item = TargetProduct.ItemClass ? Dataset->Index.FindItem(TargetProduct.ItemClass) : INDEX_NONE;
+	if (Item == INDEX_NONE)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid target product!"));
+		return nullptr;
+	}
+
+	// Plan on the core, then create the factory
+	const FFicsitPlannerCore Core(Dataset->Index);
+	FFicsitPlannerPlan Plan;
+	if (!Core.CreateOptimalPlan(Item, TargetProduct.Amount, bAllowLockedRecipes, Optimization, Plan)) return nullptr;
+	return CreateFactoryFromPlan(Plan, 0);
+}
+
+TArray<int> AFicsitPlannerEngine::CreateFactoryPlans(const TArray<FFicsitPlannerBatchRequest>& Requests, const bool bAllowLockedRecipes)
+{
+	TArray<int> FactoryIDs;
+	FactoryIDs.Init(INDEX_NONE, Requests.Num());
+
+	// PART 1: Resolve target items
+	TArray<int32> Items;
+	Items.SetNum(Requests.Num());
+	for (int i = 0; i < Requests.Num(); ++i)
+	{
+		Items[i] = Requests[i].Item ? Dataset->Index.FindItem(Requests[i].Item) : INDEX_NONE;
+		if (Items[i] == INDEX_NONE) UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid target product for batch request %d!"), i);
+	}
+
+	// PART 2: Plan every request on the core, in parallel, sharing sub-plans
+	// Each one is counted first (same strategy as CreateFactoryPlan & the job queue), refusing what's too large or unconfirmed
+	const FFicsitPlannerCore Core(Dataset->Index);
+	FFicsitPlannerPlanCache Cache(Dataset->Index, bAllowLockedRecipes);
+	TArray<FFicsitPlannerPlan> Plans;
+	TArray<EFactoryPlanStrategy> Strategies;
+	TArray<bool> Planned;
+	Plans.SetNum(Requests.Num());
+	Strategies.Init(EFactoryPlanStrategy::EFPS_Full, Requests.Num());
+	Planned.Init(false, Requests.Num());
+
+	ParallelFor(Requests.Num(), [&](const int32 i)
+	{
+		if (Items[i] == INDEX_NONE) return;
+
+		const FFicsitPlannerPlanEstimate Estimate = Core.EstimatePlan(Items[i], bAllowLockedRecipes);
+		Strategies[i] = Core.ChooseStrategy(Estimate, Items[i], bAllowLockedRecipes, Requests[i].Optimization, MaxFullPlanNodes, MaxPlanNodes);
+		if (Strategies[i] == EFactoryPlanStrategy::EFPS_TooLarge) return;
+		if (FFicsitPlannerCore::NeedsConfirmation(Strategies[i]) && !Requests[i].bConfirmLargePlan) return;
+
+		if (Strategies[i] == EFactoryPlanStrategy::EFPS_Optimal)
+		{
+			Planned[i] = Core.CreateOptimalPlan(Items[i], Requests[i].Rate, bAllowLockedRecipes, Requests[i].Optimization, Plans[i]);
+		}
+		else
+		{
+			Planned[i] = Core.CreatePlan(Items[i], Requests[i].Rate, bAllowLockedRecipes, Requests[i].Optimization, Plans[i], &Cache);
+		}
+	});
+
+	UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Planned %d requests (sub-plan cache: %d hits, %d misses, %d nodes)"),
+		Requests.Num(), Cache.GetHits(), Cache.GetMisses(), Cache.GetCachedNodes());
+
+	// PART 3: Create & save the factories (UObjects, so on this thread)
+	for (int i = 0; i < Requests.Num(); ++i)
+	{
+		if (Items[i] == INDEX_NONE) continue;
+		if (Strategies[i] == EFactoryPlanStrategy::EFPS_TooLarge)
+		{
+			UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Factory plan for batch request %d is too large to create!"), i);
+			continue;
+		}
+		if (FFicsitPlannerCore::NeedsConfirmation(Strategies[i]) && !Requests[i].bConfirmLargePlan)
+		{
+			UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Large factory plan for batch request %d needs confirmation!"), i);
+			continue;
+		}
+		if (!Planned[i]) continue;
+		if (UFicsitPlannerFactory* Factory = CreateFactoryFromPlan(Plans[i], 0))
+		{
+			FactoryIDs[i] = SaveFactory(Factory);
+		}
+	}
+
+	return FactoryIDs;
+}
+
+UFicsitPlannerFactory* AFicsitPlannerEngine::CreateFactoryFromPlan(const FFicsitPlannerPlan& Plan, const int32 Node)
+{
+	const FFicsitPlannerPlanNode& PlanNode = Plan.Nodes[Node];
+
+	// OPTION 1: Leaf input (no factory, same as CreateFactoryNode)
+	if (PlanNode.IsInput()) return nullptr;
+
+	// OPTION 2: Multiple alternatives, loop or single recipe
+	UFicsitPlannerFactory* Factory;
+	if (PlanNode.IsGroup()) Factory = NewObject<UFicsitPlannerFactoryGroup>();
+	else if (PlanNode.IsLoop()) Factory = NewObject<UFicsitPlannerFactoryLoop>();
+	else Factory = NewObject<UFicsitPlannerFactory>();
+
+	Factory->InitFromPlan(Plan, Node, this);
+	return Factory;
 }
 
 void AFicsitPlannerEngine::LogFactoryPlan(UFicsitPlannerFactory* Factory)
@@ -239,9 +521,10 @@ FString AFicsitPlannerEngine::FactoryPlanToString(UFicsitPlannerFactory* Factory
 	FString FactoryPlanString;
 
 	// Add basic factory info
-	FactoryPlanString += FString::Printf(TEXT("Producing: %dx %s / min\n"), Factory->GetPrimaryProduct().Amount, *Factory->GetPrimaryProduct().ItemClass->GetDefaultObject<UFGItemDescriptor>()->mDisplayName.ToString());
+	FactoryPlanString += FString::Printf(TEXT("Producing: %dx %s / min\n"), Factory->GetPrimaryProduct().Amount, *GetItemDisplayName(Factory->GetPrimaryProduct().ItemClass));
 	FactoryPlanString += FString::Printf(TEXT("Power Consumption: %.2f MW\n"), Factory->GetTotalPowerConsumption());
 	FactoryPlanString += FString::Printf(TEXT("Complexity: %d\n"), Factory->GetTotalComplexity());
+	FactoryPlanString += FString::Printf(TEXT("Edges Over Capacity: %d\n"), CountFactoryEdgesOverCapacity(Factory));
 
 	// Log factory plan iteratively (w/ deque)
 	TArray<UFicsitPlannerFactory*> FactoryDeque;
@@ -269,12 +552,13 @@ FString AFicsitPlannerEngine::FactoryPlanToString(UFicsitPlannerFactory* Factory
 		}
 		IndentationString += TEXT("- ");
 
-		// Add factory info to the string (recipe, building, multiplier)
-		FactoryPlanString += IndentationString + FString::Printf(TEXT("%d: Product: %s, Recipe: %s, Multiplier: %.2f\n"),
+		// Add factory info to the string (recipe, building, multiplier, transport)
+		FactoryPlanString += IndentationString + FString::Printf(TEXT("%d: Product: %s, Recipe: %s, Multiplier: %.2f, Transport: %s\n"),
 			CurrentNodeIndex,
-			*CurrentFactory->GetPrimaryProduct().ItemClass->GetDefaultObject<UFGItemDescriptor>()->mDisplayName.ToString(),
-			*CurrentFactory->GetRecipe()->GetDefaultObject<UFGRecipe>()->GetDisplayName().ToString(),
-			CurrentFactory->GetMultiplier());
+			*GetItemDisplayName(CurrentFactory->GetPrimaryProduct().ItemClass),
+			*GetRecipeDisplayName(CurrentFactory->GetRecipe()),
+			CurrentFactory->GetMultiplier(),
+			*FFicsitPlannerLogistics::TransportToString(SizeFactoryEdge(CurrentFactory)));
 
 		// Check if the factory is a factory group
 		if (UFicsitPlannerFactoryGroup* FactoryGroup = Cast<UFicsitPlannerFactoryGroup>(CurrentFactory))
@@ -282,13 +566,27 @@ FString AFicsitPlannerEngine::FactoryPlanToString(UFicsitPlannerFactory* Factory
 			FactoryPlanString += FString::Printf(TEXT("(Option %d of %d)\n"), FactoryGroup->GetSelectedFactoryIndex() + 1, FactoryGroup->GetAllMultipliers().Num());
 		}
 
+		// Check if the factory is a recipe loop
+		if (const UFicsitPlannerFactoryLoop* FactoryLoop = Cast<UFicsitPlannerFactoryLoop>(CurrentFactory))
+		{
+			FString LoopString = TEXT("(Loop:");
+			for (int i = 0; i < FactoryLoop->GetLoopRecipes().Num(); i++)
+			{
+				LoopString += FString::Printf(TEXT(" %s x%.2f"), *GetRecipeDisplayName(FactoryLoop->GetLoopRecipes()[i]), FactoryLoop->GetLoopMultipliers()[i]);
+			}
+			FactoryPlanString += LoopString + TEXT(")\n");
+		}
+
 		// Add subfactories to the deque
-		for (UFicsitPlannerFactory* Subfactory : *CurrentFactory->GetSubfactories())
+		if (TArray<UFicsitPlannerFactory*>* Subfactories = CurrentFactory->GetSubfactories())
 		{
-			if (Subfactory)
+			for (UFicsitPlannerFactory* Subfactory : *Subfactories)
 			{
-				FactoryDeque.Add(Subfactory);
-				IndentationLevels.Add(IndentationLevel + 1);
+				if (Subfactory)
+				{
+					FactoryDeque.Add(Subfactory);
+					IndentationLevels.Add(IndentationLevel + 1);
+				}
 			}
 		}
 		CurrentNodeIndex++;
@@ -303,260 +601,1278 @@ FString AFicsitPlannerEngine::FactoryPlanToHeaderString(UFicsitPlannerFactory* F
 	FString FactoryPlanString;
 
 	// Add basic factory info
-	FactoryPlanString += FString::Printf(TEXT("Producing: %dx %s / min (Power Consumption: %.2f MW | Complexity: %d)\n"), Factory->GetPrimaryProduct().Amount, *Factory->GetPrimaryProduct().ItemClass->GetDefaultObject<UFGItemDescriptor>()->mDisplayName.ToString(), Factory->GetTotalPowerConsumption(), Factory->GetTotalComplexity());
+	FactoryPlanString += FString::Printf(TEXT("Producing: %dx %s / min (Power Consumption: %.2f MW | Complexity: %d)\n"), Factory->GetPrimaryProduct().Amount, *GetItemDisplayName(Factory->GetPrimaryProduct().ItemClass), Factory->GetTotalPowerConsumption(), Factory->GetTotalComplexity());
 
 	// Return the factory plan string
 	return FactoryPlanString;
 }
 
-int AFicsitPlannerEngine::SaveFactory(UFicsitPlannerFactory* Factory)
+FString AFicsitPlannerEngine::FactoryClockSpeedsToString(int FactoryID, int MaxBuildings, int MaxShards)
 {
-	// Add the factory to the list of factories, and return its ID
-	int FactoryID = Factories.Num();
-	Factories.Add(Factory);
-	return FactoryID;
-}
+	UFicsitPlannerFactory* Factory = GetFactory(FactoryID);
+	if (!Factory) return FString::Printf(TEXT("Invalid factory ID: %d\n"), FactoryID);
 
-UFicsitPlannerFactory* AFicsitPlannerEngine::GetFactory(int FactoryID)
-{
-	// Check if the factory ID is valid
-	if (Factories.Num() > FactoryID)
-	{
-		return Factories[FactoryID];
-	}
-	else
-	{
-		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid factory ID: %d"), FactoryID);
-		return nullptr;
-	}
+	FFicsitPlannerClockLimits Limits;
+	Limits.MaxBuildings = MaxBuildings;
+	Limits.MaxShards = MaxShards;
+
+	FFicsitPlannerClockPlan ClockPlan;
+	CollectFactoryMachines(Factory, ClockPlan);
+	FFicsitPlannerClockSpeed::Solve(ClockPlan, Limits);
+	return FFicsitPlannerClockSpeed::ToString(ClockPlan, Dataset->Index);
 }
 
-bool AFicsitPlannerEngine::DeleteFactory(int FactoryID)
+bool AFicsitPlannerEngine::CheckFactoryBalance(int FactoryID, FString& Report)
 {
-	// Check if the factory ID is valid
-	if (Factories.Num() > FactoryID)
-	{
-		// Remove the factory from the list
-		Factories.RemoveAt(FactoryID);
-		return true;
-	}
-	else
+	UFicsitPlannerFactory* Factory = GetFactory(FactoryID);
+	if (!Factory)
 	{
-		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid factory ID: %d"), FactoryID);
+		Report = FString::Printf(TEXT("Invalid factory ID: %d\n"), FactoryID);
 		return false;
 	}
+
+	// Flow matrix of the flattened recipes (groups follow their selection), against the factory's target
+	const FFicsitPlannerCore Core(Dataset->Index);
+	FFicsitPlannerBillOfMaterials Bill;
+	FlattenFactory(Factory, Bill);
+	FFicsitPlannerFlowMatrix Matrix;
+	Core.BuildFlowMatrix(Bill, Matrix);
+
+	FFicsitPlannerBalanceReport Balance;
+	const FItemAmount Product = Factory->GetPrimaryProduct();
+	Core.CheckBalance(Matrix, Dataset->Index.FindItem(Product.ItemClass), Product.Amount, Balance);
+	Report = Core.BalanceToString(Balance);
+	return Balance.IsBalanced();
 }
 
-TArray<UFicsitPlannerFactory*> AFicsitPlannerEngine::GetAllFactories()
+FString AFicsitPlannerEngine::FactoryResearchToString(int FactoryID, EFactoryResearchMetric Metric, int MaxRecipes)
 {
-	// Return all factories
-	TArray<UFicsitPlannerFactory*> AllFactories;
-	for (const auto& Factory : Factories)
-	{
-		if (Factory)
-		{
-			AllFactories.Add(Factory);
-		}
-	}
-	return AllFactories;
+	UFicsitPlannerFactory* Factory = GetFactory(FactoryID);
+	if (!Factory) return FString::Printf(TEXT("Invalid factory ID: %d\n"), FactoryID);
+
+	// Demands are what the factory consumes (as edited), and its target
+	const FFicsitPlannerCore Core(Dataset->Index);
+	FFicsitPlannerBillOfMaterials Bill;
+	FlattenFactory(Factory, Bill);
+	FFicsitPlannerFlowMatrix Matrix;
+	Core.BuildFlowMatrix(Bill, Matrix);
+
+	const FItemAmount Product = Factory->GetPrimaryProduct();
+	TArray<float> Demands;
+	Core.ComputeDemands(Matrix, Dataset->Index.FindItem(Product.ItemClass), Product.Amount, Demands);
+
+	TArray<FFicsitPlannerRecipeValue> Values;
+	Core.RankLockedRecipes(Demands, Metric, Values);
+	return Core.RecipeValuesToString(Values, Metric, MaxRecipes);
 }
 
-bool AFicsitPlannerEngine::ReplaceFactory(int FactoryID, UFicsitPlannerFactory* Factory)
+FString AFicsitPlannerEngine::ResearchToString(const TArray<FFicsitPlannerBatchRequest>& Targets, EFactoryResearchMetric Metric, int MaxRecipes)
 {
-	// Check if index is valid
-	if (Factories.Num() > FactoryID)
+	// Demands follow the targets' least-power plans (from the unit cost table, nothing is planned)
+	TArray<FFicsitPlannerItemRate> TargetRates;
+	for (const FFicsitPlannerBatchRequest& Target : Targets)
 	{
-		// Replace the factory at the given index
-		Factories[FactoryID] = Factory;
-		return true;
-	}
-	else
-	{
-		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid factory ID: %d"), FactoryID);
-		return false;
+		const int32 Item = Target.Item ? Dataset->Index.FindItem(Target.Item) : INDEX_NONE;
+		if (Item != INDEX_NONE && Target.Rate > 0.0f) TargetRates.Add({Item, Target.Rate});
 	}
+
+	const FFicsitPlannerCore Core(Dataset->Index);
+	TArray<float> Demands;
+	Core.ComputeDemands(TargetRates, Demands);
+
+	TArray<FFicsitPlannerRecipeValue> Values;
+	Core.RankLockedRecipes(Demands, Metric, Values);
+	return Core.RecipeValuesToString(Values, Metric, MaxRecipes);
 }
 
-bool AFicsitPlannerEngine::UpdateFactoryGroup(int FactoryID, int nodeID, int newIndex)
+void AFicsitPlannerEngine::CollectFactoryMachines(UFicsitPlannerFactory* Factory, FFicsitPlannerClockPlan& OutClockPlan) const
 {
-	// Check if the factory ID is valid
-	if (Factories.Num() <= FactoryID)
-	{
-		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid factory ID: %d"), FactoryID);
-		return false;
-	}
+	OutClockPlan = FFicsitPlannerClockPlan();
 
-	// Get the factory
-	UFicsitPlannerFactory* Factory = Factories[FactoryID];
+	const auto AddGroup = [&](const TSubclassOf<UFGRecipe> RecipeClass, const float Multiplier)
+	{
+		const int32 Recipe = Dataset->Index.FindRecipe(RecipeClass);
+		if (Recipe != INDEX_NONE) OutClockPlan.Groups.Add({Recipe, Multiplier, Dataset->Index.GetRecipe(Recipe).Power});
+	};
 
-	// Get all nodes, as deque, until index is reached
+	// One machine group per node (per loop recipe for loops), following selected alternatives
 	TArray<UFicsitPlannerFactory*> FactoryDeque;
 	FactoryDeque.Add(Factory);
-
-	int CurrentNodeIndex = 1;
-
 	while (FactoryDeque.Num() > 0)
 	{
-		// Get the next factory in the deque
-		int LastElement = FactoryDeque.Num() - 1;
-
-		UFicsitPlannerFactory* CurrentFactory = FactoryDeque[LastElement];
-		FactoryDeque.RemoveAt(LastElement);
+		UFicsitPlannerFactory* CurrentFactory = ResolveFactory(FactoryDeque.Pop());
+		if (!CurrentFactory) continue;
 
-		// Check if the current node is the one we want to update
-		if (CurrentNodeIndex == nodeID)
+		if (const UFicsitPlannerFactoryLoop* FactoryLoop = Cast<UFicsitPlannerFactoryLoop>(CurrentFactory))
 		{
-			// Update the selected factory index
-			if (UFicsitPlannerFactoryGroup* FactoryGroup = Cast<UFicsitPlannerFactoryGroup>(CurrentFactory))
-			{
-				FactoryGroup->SetSelectedFactoryIndex(newIndex - 1);
-				return true;
-			}
-			else
-			{
-				UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Current node is not a factory group!"));
-				return false;
-			}
+			for (int i = 0; i < FactoryLoop->GetLoopRecipes().Num(); i++) AddGroup(FactoryLoop->GetLoopRecipes()[i], FactoryLoop->GetLoopMultipliers()[i]);
+		}
+		else
+		{
+			AddGroup(CurrentFactory->GetRecipe(), CurrentFactory->GetMultiplier());
 		}
 
-		// Add subfactories to the deque
-		for (UFicsitPlannerFactory* Subfactory : *CurrentFactory->GetSubfactories())
+		if (TArray<UFicsitPlannerFactory*>* Subfactories = CurrentFactory->GetSubfactories())
 		{
-			if (Subfactory)
+			for (UFicsitPlannerFactory* Subfactory : *Subfactories)
 			{
-				FactoryDeque.Add(Subfactory);
+				if (Subfactory) FactoryDeque.Add(Subfactory);
 			}
 		}
-		
-		CurrentNodeIndex++;
 	}
-
-	UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Node ID %d not found in factory group!"), nodeID);
-	return false;
 }
 
-bool AFicsitPlannerEngine::OptimizeFactory(int Factory, EFactoryOptimizationType Optimization)
+FString AFicsitPlannerEngine::PrunedRecipesToString(bool bAllowLockedRecipes)
 {
-	// Check if the factory ID is valid
-	if (Factories.Num() <= Factory)
+	const FFicsitPlannerRecipeGraph& Graph = Dataset->Index.GetGraph(bAllowLockedRecipes);
+	const auto ItemName = [&](const int32 Item) { return Dataset->Index.GetItem(Item).Name; };
+	const auto RecipeName = [&](const int32 Recipe) { return Dataset->Index.GetRecipe(Recipe).Name; };
+
+	// Count unreachable items first, for the header
+	int UnreachableItems = 0;
+	for (int32 Item = 0; Item < Dataset->Index.NumItems(); Item++)
 	{
-		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid factory ID: %d"), Factory);
-		return false;
+		if (!Graph.ObtainableItems[Item]) UnreachableItems++;
 	}
 
-	// Get the factory
-	UFicsitPlannerFactory* FactoryObj = Factories[Factory];
+	FString PrunedString = FString::Printf(TEXT("Pruned (%s recipes): %d unreachable items, %d recipe alternatives\n"),
+		bAllowLockedRecipes ? TEXT("all") : TEXT("unlocked"), UnreachableItems, Graph.PrunedRecipes.Num());
 
-	// Check if optimization is valid
-	if (Optimization == EFactoryOptimizationType::EFOT_None)
+	// Unreachable items
+	for (int32 Item = 0; Item < Dataset->Index.NumItems(); Item++)
 	{
-		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid optimization type!"));
-		return false;
+		if (!Graph.ObtainableItems[Item])
+		{
+			PrunedString += FString::Printf(TEXT("- Unreachable: %s\n"), *ItemName(Item));
+		}
 	}
 
-	// Optimize the factory
-	UFicsitPlannerFactory* NewFactory = AFicsitPlannerEngine::CreateFactoryPlan(FactoryObj->GetPrimaryProduct(), FactoryObj->UsesLockedRecipes, Optimization);
-
-	// Replace the factory
-	if (ReplaceFactory(Factory, NewFactory))
+	// Pruned recipes, with their reason
+	for (const FFicsitPlannerPrunedRecipe& Pruned : Graph.PrunedRecipes)
 	{
-		UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Factory %d optimized successfully!"), Factory);
-		return true;
+		if (Pruned.Reason == EFicsitPlannerPruneReason::DeadEnd)
+		{
+			PrunedString += FString::Printf(TEXT("- Dead end: %s for %s (needs %s)\n"), *RecipeName(Pruned.Recipe), *ItemName(Pruned.Item),
+				Pruned.Cause != INDEX_NONE ? *ItemName(Pruned.Cause) : TEXT("unknown item"));
+		}
+		else
+		{
+			PrunedString += FString::Printf(TEXT("- Dominated: %s for %s (by %s)\n"), *RecipeName(Pruned.Recipe), *ItemName(Pruned.Item), *RecipeName(Pruned.Cause));
+		}
 	}
-	else
+
+	return PrunedString;
+}
+
+bool AFicsitPlannerEngine::ExportGameData(const FString& Path)
+{
+	// Export the compiled recipe index, so plans can be made outside the game (see UFicsitPlannerCommandlet)
+	const FString ExportPath = Path.IsEmpty() ? GetGameDataExportPath() : Path;
+	if (!FFicsitPlannerJsonRecipeSource::SaveIndex(Dataset->Index, ExportPath))
 	{
-		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to optimize factory %d!"), Factory);
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to export game data to %s!"), *ExportPath);
 		return false;
 	}
+
+	UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Exported %d items and %d recipes to %s."), Dataset->Index.NumItems(), Dataset->Index.NumRecipes(), *ExportPath);
+	return true;
 }
 
-TSubclassOf<UFGItemDescriptor> AFicsitPlannerEngine::FindItem(const FString& ItemName)
+FString AFicsitPlannerEngine::GetGameDataExportPath()
 {
-	// Search for the item in the unlocked items
-	for (const TSubclassOf<UFGItemDescriptor>& Item : UnlockedItems)
+	return FPaths::ProjectSavedDir() / TEXT("FicsitPlanner") / TEXT("GameData.json");
+}
+
+bool AFicsitPlannerEngine::ExportFactory(int FactoryID, const FString& Path, EFactoryExportFormat Format, bool bBillOfMaterials)
+{
+	// Check if the factory ID is valid
+	UFicsitPlannerFactory* Factory = GetFactory(FactoryID);
+	if (!Factory) return false;
+
+	// Open the file, the plan is streamed into it node by node
+	const FString ExportPath = Path.IsEmpty() ? GetFactoryExportPath(FactoryID, Format, bBillOfMaterials) : Path;
+	const TUniquePtr<FArchive> Archive(IFileManager::Get().CreateFileWriter(*ExportPath));
+	if (!Archive)
 	{
-		if (Item->GetDefaultObject<UFGItemDescriptor>()->mDisplayName.ToString().Equals(ItemName, ESearchCase::IgnoreCase))
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to open %s for writing!"), *ExportPath);
+		return false;
+	}
+
+	const TUniquePtr<IFicsitPlannerPlanWriter> Writer = IFicsitPlannerPlanWriter::Create(Format, *Archive);
+	Writer->BeginDocument(bBillOfMaterials);
+	if (bBillOfMaterials)
+	{
+		FFicsitPlannerBillOfMaterials Bill;
+		FlattenFactory(Factory, Bill);
+		const FItemAmount Product = Factory->GetPrimaryProduct();
+		Writer->WriteBill({GetItemDisplayName(Product.ItemClass), static_cast<float>(Product.Amount), Bill.TotalPower, Bill.TotalComplexity}, Bill, Dataset->Index);
+	}
+	else
+	{
+		WriteFactory(Factory, *Writer);
+	}
+	Writer->EndDocument();
+
+	if (!Archive->Close())
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to write %s!"), *ExportPath);
+		return false;
+	}
+
+	UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Exported factory %d to %s."), FactoryID, *ExportPath);
+	return true;
+}
+
+FString AFicsitPlannerEngine::GetFactoryExportPath(int FactoryID, EFactoryExportFormat Format, bool bBillOfMaterials)
+{
+	const FString FileName = FString::Printf(TEXT("Factory_%d%s.%s"), FactoryID, bBillOfMaterials ? TEXT("_BOM") : TEXT(""), IFicsitPlannerPlanWriter::GetFileExtension(Format));
+	return FPaths::ProjectSavedDir() / TEXT("FicsitPlanner") / FileName;
+}
+
+void AFicsitPlannerEngine::WriteFactory(UFicsitPlannerFactory* Factory, IFicsitPlannerPlanWriter& Writer) const
+{
+	const FItemAmount Product = Factory->GetPrimaryProduct();
+	Writer.BeginPlan({GetItemDisplayName(Product.ItemClass), static_cast<float>(Product.Amount), Factory->GetTotalPowerConsumption(), Factory->GetTotalComplexity(), CountFactoryEdgesOverCapacity(Factory)});
+
+	// Depth-first, same numbering as FactoryPlanToString (exit entries close nodes once their inputs are written)
+	struct FEntry
+	{
+		UFicsitPlannerFactory* Factory;
+		int32 Depth;
+		int32 ParentId;
+	};
+	TArray<FEntry> FactoryDeque;
+	FactoryDeque.Add({Factory, 0, 0});
+	int CurrentNodeIndex = 1;
+	while (FactoryDeque.Num() > 0)
+	{
+		const FEntry Entry = FactoryDeque.Pop();
+		if (!Entry.Factory)
 		{
-			return Item;
+			Writer.EndNode();
+			continue;
+		}
+
+		// Factory info (groups report their selected factory)
+		UFicsitPlannerFactory* CurrentFactory = Entry.Factory;
+		FFicsitPlannerPlanRow Row;
+		Row.NodeId = CurrentNodeIndex++;
+		Row.ParentId = Entry.ParentId;
+		Row.Depth = Entry.Depth;
+		Row.Item = GetItemDisplayName(CurrentFactory->GetPrimaryProduct().ItemClass);
+		Row.Rate = CurrentFactory->GetPrimaryProduct().Amount;
+		Row.Recipe = GetRecipeDisplayName(CurrentFactory->GetRecipe());
+		Row.Multiplier = CurrentFactory->GetMultiplier();
+		Row.Power = CurrentFactory->GetPowerConsumption();
+		Row.Complexity = CurrentFactory->GetComplexity();
+		const FFicsitPlannerTransport Transport = SizeFactoryEdge(CurrentFactory);
+		Row.Transport = FFicsitPlannerLogistics::TransportToString(Transport);
+		Row.Lines = Transport.Lines;
+		Row.bOverCapacity = Transport.bOverCapacity;
+		if (const UFicsitPlannerFactoryGroup* FactoryGroup = Cast<UFicsitPlannerFactoryGroup>(CurrentFactory))
+		{
+			Row.Option = FactoryGroup->GetSelectedFactoryIndex() + 1;
+			Row.NumOptions = FactoryGroup->GetAllMultipliers().Num();
+		}
+		if (const UFicsitPlannerFactoryLoop* FactoryLoop = Cast<UFicsitPlannerFactoryLoop>(ResolveFactory(CurrentFactory)))
+		{
+			for (int i = 0; i < FactoryLoop->GetLoopRecipes().Num(); i++)
+			{
+				Row.LoopRecipes.Add({GetRecipeDisplayName(FactoryLoop->GetLoopRecipes()[i]), FactoryLoop->GetLoopMultipliers()[i]});
+			}
+		}
+		Writer.BeginNode(Row);
+
+		// Exit entry (null factory), then subfactories
+		FactoryDeque.Add({nullptr, 0, 0});
+		if (TArray<UFicsitPlannerFactory*>* Subfactories = CurrentFactory->GetSubfactories())
+		{
+			for (UFicsitPlannerFactory* Subfactory : *Subfactories)
+			{
+				if (Subfactory) FactoryDeque.Add({Subfactory, Entry.Depth + 1, Row.NodeId});
+			}
 		}
 	}
-	return nullptr;
+
+	Writer.EndPlan();
 }
 
-bool AFicsitPlannerEngine::RecipeProducedInBuilding(const TSubclassOf<UFGRecipe> Recipe)
+FFicsitPlannerTransport AFicsitPlannerEngine::SizeFactoryEdge(UFicsitPlannerFactory* Factory) const
 {
-	// Get the default values of the recipe
-	const UFGRecipe* RecipeObj = Recipe->GetDefaultObject<UFGRecipe>();
+	const FItemAmount Product = Factory->GetPrimaryProduct();
+	const int32 Item = Dataset->Index.FindItem(Product.ItemClass);
+	return Logistics.Size(Product.Amount, Item != INDEX_NONE && Dataset->Index.GetItem(Item).bFluid);
+}
 
-	// Get "Produced In" property
-	TArray<TSubclassOf<UObject>> ProducedIn;
-	RecipeObj->GetProducedIn(ProducedIn);
+int32 AFicsitPlannerEngine::CountFactoryEdgesOverCapacity(UFicsitPlannerFactory* Factory) const
+{
+	// One output edge per factory, same factories as FactoryPlanToString
+	int32 EdgesOverCapacity = 0;
+	TArray<UFicsitPlannerFactory*> FactoryDeque;
+	FactoryDeque.Add(Factory);
+	while (FactoryDeque.Num() > 0)
+	{
+		UFicsitPlannerFactory* CurrentFactory = FactoryDeque.Pop();
+		if (SizeFactoryEdge(CurrentFactory).bOverCapacity) EdgesOverCapacity++;
+		if (TArray<UFicsitPlannerFactory*>* Subfactories = CurrentFactory->GetSubfactories())
+		{
+			for (UFicsitPlannerFactory* Subfactory : *Subfactories)
+			{
+				if (Subfactory) FactoryDeque.Add(Subfactory);
+			}
+		}
+	}
+	return EdgesOverCapacity;
+}
 
-	// Check if any of the producers is a building
-	for (const TSubclassOf<UObject>& Producer : ProducedIn)
+void AFicsitPlannerEngine::FlattenFactory(UFicsitPlannerFactory* Factory, FFicsitPlannerBillOfMaterials& OutBill) const
+{
+	OutBill = FFicsitPlannerBillOfMaterials();
+	TMap<int32, int32> RecipeRows;
+	TMap<int32, float> Inputs;
+	TMap<int32, float> Byproducts;
+
+	TArray<UFicsitPlannerFactory*> FactoryDeque;
+	FactoryDeque.Add(Factory);
+	while (FactoryDeque.Num() > 0)
 	{
-		if (Producer->GetName().StartsWith("Build_"))
+		UFicsitPlannerFactory* CurrentFactory = ResolveFactory(FactoryDeque.Pop());
+		if (!CurrentFactory) continue;
+
+		// PART 1: Recipes run by this node (every recipe of a loop)
+		TArray<TPair<TSubclassOf<UFGRecipe>, float>> NodeRecipes;
+		if (const UFicsitPlannerFactoryLoop* FactoryLoop = Cast<UFicsitPlannerFactoryLoop>(CurrentFactory))
 		{
-			// If produced in a building, return true
+			for (int i = 0; i < FactoryLoop->GetLoopRecipes().Num(); i++) NodeRecipes.Add({FactoryLoop->GetLoopRecipes()[i], FactoryLoop->GetLoopMultipliers()[i]});
+		}
+		else
+		{
+			NodeRecipes.Add({CurrentFactory->GetRecipe(), CurrentFactory->GetMultiplier()});
+		}
+
+		// PART 2: Net item flow of the node
+		TMap<int32, float> NetFlows;
+		for (const TPair<TSubclassOf<UFGRecipe>, float>& NodeRecipe : NodeRecipes)
+		{
+			const int32 Recipe = Dataset->Index.FindRecipe(NodeRecipe.Key);
+			if (Recipe == INDEX_NONE) continue;
+
+			const FFicsitPlannerRecipeData& RecipeData = Dataset->Index.GetRecipe(Recipe);
+			const int32 Row = RecipeRows.FindOrAdd(Recipe, OutBill.Recipes.Num());
+			if (Row == OutBill.Recipes.Num()) OutBill.Recipes.Add({Recipe, 0.0f, 0.0f});
+			OutBill.Recipes[Row].Multiplier += NodeRecipe.Value;
+			OutBill.Recipes[Row].Power += RecipeData.Power * NodeRecipe.Value;
+
+			for (const FFicsitPlannerItemRate& Product : RecipeData.Products) NetFlows.FindOrAdd(Product.Item) += Product.Rate * NodeRecipe.Value;
+			for (const FFicsitPlannerItemRate& Ingredient : RecipeData.Ingredients) NetFlows.FindOrAdd(Ingredient.Item) -= Ingredient.Rate * NodeRecipe.Value;
+		}
+		NetFlows.Remove(Dataset->Index.FindItem(CurrentFactory->GetPrimaryProduct().ItemClass));
+
+		// PART 3: Consumed items without a subfactory are inputs, other surpluses are byproducts
+		TSet<int32> ProducedItems;
+		if (TArray<UFicsitPlannerFactory*>* Subfactories = CurrentFactory->GetSubfactories())
+		{
+			for (UFicsitPlannerFactory* Subfactory : *Subfactories)
+			{
+				if (!Subfactory) continue;
+				ProducedItems.Add(Dataset->Index.FindItem(Subfactory->GetPrimaryProduct().ItemClass));
+				FactoryDeque.Add(Subfactory);
+			}
+		}
+		for (const TPair<int32, float>& NetFlow : NetFlows)
+		{
+			if (NetFlow.Value < -FLOW_TOLERANCE && !ProducedItems.Contains(NetFlow.Key)) Inputs.FindOrAdd(NetFlow.Key) -= NetFlow.Value;
+			else if (NetFlow.Value > FLOW_TOLERANCE) Byproducts.FindOrAdd(NetFlow.Key) += NetFlow.Value;
+		}
+
+		OutBill.TotalComplexity += CurrentFactory->GetComplexity();
+	}
+
+	for (const FFicsitPlannerRecipeUse& Use : OutBill.Recipes) OutBill.TotalPower += Use.Power;
+	for (const TPair<int32, float>& Input : Inputs) OutBill.Inputs.Add({Input.Key, Input.Value});
+	for (const TPair<int32, float>& Byproduct : Byproducts) OutBill.Byproducts.Add({Byproduct.Key, Byproduct.Value});
+}
+
+UFicsitPlannerFactory* AFicsitPlannerEngine::ResolveFactory(UFicsitPlannerFactory* Factory)
+{
+	// Groups stand for their selected factory
+	while (const UFicsitPlannerFactoryGroup* FactoryGroup = Cast<UFicsitPlannerFactoryGroup>(Factory))
+	{
+		Factory = FactoryGroup->GetSelectedFactory();
+	}
+	return Factory;
+}
+
+int32 AFicsitPlannerEngine::FindFactoryEntry(const int FactoryID) const
+{
+	// The slot must be in use, by the same generation (IDs of deleted factories are stale)
+	const int32 Slot = FactoryID & FACTORY_SLOT_MASK;
+	const int32 Generation = FactoryID >> FACTORY_SLOT_BITS;
+	if (FactoryID < 0 || !FactorySlotEntries.IsValidIndex(Slot) || FactorySlotEntries[Slot] == INDEX_NONE || FactorySlotGenerations[Slot] != Generation)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid factory ID: %d"), FactoryID);
+		return INDEX_NONE;
+	}
+	return FactorySlotEntries[Slot];
+}
+
+int AFicsitPlannerEngine::SaveFactory(UFicsitPlannerFactory* Factory)
+{
+	// Stay within the memory budget (refuses the factory, or evicts the least recently used ones)
+	TMap<UFicsitPlannerFactory*, int32> NodeRefs;
+	const int64 Bytes = AddNodeRefs(NodeRefs, Factory);
+	if (!ReserveFactoryMemory(Bytes))
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Factory needs %lld bytes, over the factory memory budget (%lld of %lld bytes used)!"), Bytes, GetUsedFactoryMemory(), MaxFactoryMemory);
+		return INDEX_NONE;
+	}
+
+	// Reuse a free slot, or add a new one
+	int32 Slot;
+	if (FreeFactorySlots.Num() > 0)
+	{
+		Slot = FreeFactorySlots.Pop();
+	}
+	else
+	{
+		if (FactorySlotEntries.Num() > FACTORY_SLOT_MASK)
+		{
+			UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Too many saved factories!"));
+			return INDEX_NONE;
+		}
+		Slot = FactorySlotEntries.Add(INDEX_NONE);
+		FactorySlotGenerations.Add(0);
+	}
+
+	// Add the factory to the list of factories, and return its ID
+	const int FactoryID = (FactorySlotGenerations[Slot] << FACTORY_SLOT_BITS) | Slot;
+	FactorySlotEntries[Slot] = Factories.Add(Factory);
+	FactoryIDs.Add(FactoryID);
+	FactoryHistories.AddDefaulted();
+	FactoryNodeRefs.Add(MoveTemp(NodeRefs));
+	FactoryMemory.Add(Bytes);
+	UsedFactoryMemory += Bytes;
+	FactoryLastUsed.Add(++FactoryUseCounter);
+	OnFactoryCreated.Broadcast(FactoryID);
+	return FactoryID;
+}
+
+UFicsitPlannerFactory* AFicsitPlannerEngine::GetFactory(int FactoryID)
+{
+	// Check if the factory ID is valid
+	const int32 Entry = FindFactoryEntry(FactoryID);
+	if (Entry == INDEX_NONE) return nullptr;
+
+	FactoryLastUsed[Entry] = ++FactoryUseCounter;
+	return Factories[Entry];
+}
+
+bool AFicsitPlannerEngine::DeleteFactory(int FactoryID)
+{
+	// Check if the factory ID is valid
+	const int32 Entry = FindFactoryEntry(FactoryID);
+	if (Entry == INDEX_NONE) return false;
+
+	// Move the last factory into the deleted entry (keeps the list dense without shifting IDs)
+	const int32 Slot = FactoryID & FACTORY_SLOT_MASK;
+	const int LastFactoryID = FactoryIDs.Last();
+	Factories.RemoveAtSwap(Entry);
+	FactoryIDs.RemoveAtSwap(Entry);
+	UsedFactoryMemory -= FactoryMemory[Entry];
+	FactoryHistories.RemoveAtSwap(Entry);
+	FactoryNodeRefs.RemoveAtSwap(Entry);
+	FactoryMemory.RemoveAtSwap(Entry);
+	FactoryLastUsed.RemoveAtSwap(Entry);
+	if (LastFactoryID != FactoryID) FactorySlotEntries[LastFactoryID & FACTORY_SLOT_MASK] = Entry;
+
+	// Free the slot, and invalidate its ID
+	FactorySlotEntries[Slot] = INDEX_NONE;
+	FactorySlotGenerations[Slot] = (FactorySlotGenerations[Slot] + 1) & FACTORY_GENERATION_MASK;
+	FreeFactorySlots.Add(Slot);
+	FactoryTrees.Remove(FactoryID);
+	OnFactoryDeleted.Broadcast(FactoryID);
+	return true;
+}
+
+TArray<UFicsitPlannerFactory*> AFicsitPlannerEngine::GetAllFactories()
+{
+	// Return all factories (stored without holes, see GetAllFactoryIDs for their IDs)
+	return Factories;
+}
+
+TArray<FFicsitPlannerFactoryRow> AFicsitPlannerEngine::GetFactoryRows(int FactoryID, const TSet<int32>& ExpandedNodeIDs, int MaxDepth, int FirstRow, int NumRows, int& TotalRows)
+{
+	TArray<FFicsitPlannerFactoryRow> Rows;
+	TotalRows = 0;
+	UFicsitPlannerFactory* Factory = GetFactory(FactoryID);
+	if (!Factory) return Rows;
+
+	// Index the current version once (edits make a new version)
+	FFicsitPlannerFactoryTree& Tree = FactoryTrees.FindOrAdd(FactoryID);
+	if (!Tree.IsBuiltFor(Factory)) Tree.Build(Factory);
+	Tree.SetExpansion(ExpandedNodeIDs, MaxDepth);
+	TotalRows = Tree.NumVisibleRows();
+
+	TArray<int32> Nodes;
+	Tree.GetVisibleRows(FirstRow, NumRows, Nodes);
+	Rows.Reserve(Nodes.Num());
+	for (const int32 Node : Nodes)
+	{
+		FFicsitPlannerFactoryRow& Row = Rows.AddDefaulted_GetRef();
+		Row.NodeID = Node + 1;
+		Row.ParentID = Tree.GetParent(Node) + 1;
+		Row.Depth = Tree.GetDepth(Node);
+		Row.NumChildren = Tree.GetNumChildren(Node);
+		Row.bExpanded = Row.NumChildren > 0 && Tree.IsExpanded(Node);
+		Row.Factory = Tree.GetFactory(Node);
+	}
+	return Rows;
+}
+
+bool AFicsitPlannerEngine::ReplaceFactory(int FactoryID, UFicsitPlannerFactory* Factory)
+{
+	if (!CommitFactoryVersion(FactoryID, Factory)) return false;
+
+	OnFactoryReplaced.Broadcast(FactoryID);
+	return true;
+}
+
+bool AFicsitPlannerEngine::CommitFactoryVersion(const int32 FactoryID, UFicsitPlannerFactory* Factory)
+{
+	// Saved factories are never null (every later call on the ID relies on it)
+	if (!Factory)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Can't replace factory %d with an invalid factory!"), FactoryID);
+		return false;
+	}
+
+	// Check if the factory ID is valid
+	const int32 Entry = FindFactoryEntry(FactoryID);
+	if (Entry == INDEX_NONE) return false;
+
+	// Replace the factory, keeping its ID (its new nodes are counted before dropping versions, so shared ones are never released & re-added)
+	AddFactoryVersion(Entry, Factory);
+	FFicsitPlannerFactoryHistory& History = FactoryHistories[Entry];
+	History.UndoVersions.Add(Factories[Entry]);
+	Factories[Entry] = Factory;
+	FactoryLastUsed[Entry] = ++FactoryUseCounter;
+
+	// Keep the previous version for undo (a new edit drops the versions that were undone)
+	if (History.UndoVersions.Num() > MAX_FACTORY_HISTORY)
+	{
+		ReleaseFactoryVersion(Entry, History.UndoVersions[0]);
+		History.UndoVersions.RemoveAt(0);
+	}
+	for (UFicsitPlannerFactory* Version : History.RedoVersions) ReleaseFactoryVersion(Entry, Version);
+	History.RedoVersions.Reset();
+
+	// Over the memory budget, drop the oldest versions first
+	while (MaxFactoryMemory > 0 && UsedFactoryMemory > MaxFactoryMemory && History.UndoVersions.Num() > 0)
+	{
+		ReleaseFactoryVersion(Entry, History.UndoVersions[0]);
+		History.UndoVersions.RemoveAt(0);
+	}
+	return true;
+}
+
+bool AFicsitPlannerEngine::UpdateFactoryGroup(int FactoryID, int nodeID, int newIndex)
+{
+	// Get the factory
+	UFicsitPlannerFactory* Factory = GetFactory(FactoryID);
+	if (!Factory) return false;
+
+	// Get all nodes, as deque, until index is reached (nodes keep their parent & child index, to find their path later)
+	struct FNodeEntry
+	{
+		UFicsitPlannerFactory* Factory;
+		int32 Parent;
+		int32 Child;
+		int32 NodeID;
+	};
+	TArray<FNodeEntry> Entries;
+	TArray<int32> FactoryDeque;
+	Entries.Add({Factory, INDEX_NONE, INDEX_NONE, INDEX_NONE});
+	FactoryDeque.Add(0);
+
+	int CurrentNodeIndex = 1;
+
+	while (FactoryDeque.Num() > 0)
+	{
+		// Get the next factory in the deque
+		const int32 EntryIndex = FactoryDeque.Pop();
+		UFicsitPlannerFactory* CurrentFactory = Entries[EntryIndex].Factory;
+		Entries[EntryIndex].NodeID = CurrentNodeIndex;
+
+		// Check if the current node is the one we want to update
+		if (CurrentNodeIndex == nodeID)
+		{
+			const UFicsitPlannerFactoryGroup* Group = Cast<UFicsitPlannerFactoryGroup>(CurrentFactory);
+			if (!Group)
+			{
+				UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Current node is not a factory group!"));
+				return false;
+			}
+
+			// Check the index before copying anything (no version is committed for an invalid selection)
+			if (newIndex < 1 || newIndex > Group->NumFactories())
+			{
+				UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Recipe index %d out of bounds (1 - %d)!"), newIndex, Group->NumFactories());
+				return false;
+			}
+
+			// Copy the nodes from the root to the group (everything else is shared with the previous version, kept for undo)
+			TArray<int32> Path;
+			TArray<int32> PathNodeIDs;
+			for (int32 Entry = EntryIndex; Entry != INDEX_NONE; Entry = Entries[Entry].Parent)
+			{
+				PathNodeIDs.Add(Entries[Entry].NodeID);
+				if (Entries[Entry].Parent != INDEX_NONE) Path.Add(Entries[Entry].Child);
+			}
+			Algo::Reverse(Path);
+			Algo::Reverse(PathNodeIDs);
+
+			UFicsitPlannerFactory* NewGroup = nullptr;
+			UFicsitPlannerFactory* NewFactory = CopyFactoryPath(Factory, Path, NewGroup);
+
+			// Update the selected factory index
+			CastChecked<UFicsitPlannerFactoryGroup>(NewGroup)->SetSelectedFactoryIndex(newIndex - 1);
+			if (!CommitFactoryVersion(FactoryID, NewFactory)) return false;
+
+			// Only the group's rows, and the totals of its ancestors, changed
+			OnFactorySelectionChanged.Broadcast(FactoryID, nodeID, newIndex);
+			OnFactoryTotalsChanged.Broadcast(FactoryID, PathNodeIDs);
 			return true;
 		}
+
+		// Add subfactories to the deque
+		if (TArray<UFicsitPlannerFactory*>* Subfactories = CurrentFactory->GetSubfactories())
+		{
+			for (int32 Child = 0; Child < Subfactories->Num(); ++Child)
+			{
+				if ((*Subfactories)[Child])
+				{
+					FactoryDeque.Add(Entries.Add({(*Subfactories)[Child], EntryIndex, Child}));
+				}
+			}
+		}
+		
+		CurrentNodeIndex++;
 	}
 
-	// If not produced in a building, return false
+	UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Node ID %d not found in factory group!"), nodeID);
 	return false;
 }
 
-void AFicsitPlannerEngine::RegisterUnlockedRecipe(const TSubclassOf<UFGRecipe> Recipe)
+bool AFicsitPlannerEngine::UndoFactory(int FactoryID)
 {
-	// Ensure the recipe is produced in a building
-	if (!RecipeProducedInBuilding(Recipe)) return;
+	// Check if the factory ID is valid
+	const int32 Entry = FindFactoryEntry(FactoryID);
+	if (Entry == INDEX_NONE) return false;
 
-	// Get the recipe's products
-	const UFGRecipe* RecipeObj = Recipe->GetDefaultObject<UFGRecipe>();
+	FFicsitPlannerFactoryHistory& History = FactoryHistories[Entry];
+	if (History.UndoVersions.Num() == 0)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Nothing to undo for factory %d!"), FactoryID);
+		return false;
+	}
+
+	// Switch to the previous version
+	History.RedoVersions.Add(Factories[Entry]);
+	Factories[Entry] = History.UndoVersions.Pop();
+	FactoryLastUsed[Entry] = ++FactoryUseCounter;
+	OnFactoryReplaced.Broadcast(FactoryID);
+	return true;
+}
+
+bool AFicsitPlannerEngine::RedoFactory(int FactoryID)
+{
+	// Check if the factory ID is valid
+	const int32 Entry = FindFactoryEntry(FactoryID);
+	if (Entry == INDEX_NONE) return false;
+
+	FFicsitPlannerFactoryHistory& History = FactoryHistories[Entry];
+	if (History.RedoVersions.Num() == 0)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Nothing to redo for factory %d!"), FactoryID);
+		return false;
+	}
+
+	// Switch to the next version
+	History.UndoVersions.Add(Factories[Entry]);
+	Factories[Entry] = History.RedoVersions.Pop();
+	FactoryLastUsed[Entry] = ++FactoryUseCounter;
+	OnFactoryReplaced.Broadcast(FactoryID);
+	return true;
+}
 
-	// Add products to unlocked items list
-	for (TArray<FItemAmount> Products = RecipeObj->GetProducts(); const FItemAmount& Product : Products)
+FFicsitPlannerMemoryStats AFicsitPlannerEngine::GetMemoryStats() const
+{
+	// PART 1: Factories (nodes shared between factories are counted once too)
+	FFicsitPlannerMemoryStats Stats;
+	TSet<UFicsitPlannerFactory*> VisitedNodes;
+	TArray<UFicsitPlannerFactory*> Versions;
+	for (int32 Entry = 0; Entry < Factories.Num(); ++Entry)
 	{
-		TSubclassOf<UFGItemDescriptor> Item = Product.ItemClass;
+		Versions.Reset();
+		GetFactoryVersions(Entry, Versions);
+		CollectFactoryMemory(Versions, VisitedNodes, Stats);
+		Stats.HistoryBytes += FactoryHistories[Entry].UndoVersions.GetAllocatedSize() + FactoryHistories[Entry].RedoVersions.GetAllocatedSize();
+		Stats.FactoryBytes += FactoryNodeRefs[Entry].GetAllocatedSize();
+	}
+	Stats.FactoryBytes += FactoryNodeRefs.GetAllocatedSize() + Factories.GetAllocatedSize() + FactoryIDs.GetAllocatedSize() + FactorySlotEntries.GetAllocatedSize() + FactorySlotGenerations.GetAllocatedSize()
+		+ FreeFactorySlots.GetAllocatedSize() + FactoryHistories.GetAllocatedSize() + FactoryMemory.GetAllocatedSize() + FactoryLastUsed.GetAllocatedSize();
+
+	// PART 2: Shared plans (explored plans counted once)
+	Stats.SharedPlans = SharedPlans.Num();
+	Stats.SharedPlanBytes = SharedPlans.GetAllocatedSize(Stats.ExploredPlans);
+
+	// PART 3: Recipe data
+	Stats.RecipeIndexBytes = Dataset->Index.GetAllocatedSize(false);
+	Stats.RecipeTableBytes = Dataset->Index.GetSharedAllocatedSize();
+	Stats.RecipeMapBytes = Dataset->GetRecipeMapsAllocatedSize();
+	return Stats;
+}
 
-		// Add item to all items list
-		if (!UnlockedItems.Contains(Item)) UnlockedItems.Add(Item);
+FFicsitPlannerMemoryStats AFicsitPlannerEngine::GetFactoryMemoryStats(int FactoryID) const
+{
+	FFicsitPlannerMemoryStats Stats;
+	const int32 Entry = FindFactoryEntry(FactoryID);
+	if (Entry == INDEX_NONE) return Stats;
+
+	TSet<UFicsitPlannerFactory*> VisitedNodes;
+	TArray<UFicsitPlannerFactory*> Versions;
+	GetFactoryVersions(Entry, Versions);
+	CollectFactoryMemory(Versions, VisitedNodes, Stats);
+	Stats.HistoryBytes += FactoryHistories[Entry].UndoVersions.GetAllocatedSize() + FactoryHistories[Entry].RedoVersions.GetAllocatedSize();
+	return Stats;
+}
 
-		// If the item doesn't exist in the map, create a new entry
-		if (!UnlockedRecipesMap.Contains(Item)) UnlockedRecipesMap.Add(Item, TArray<TSubclassOf<UFGRecipe>>());
+FString AFicsitPlannerEngine::MemoryStatsToString(const FFicsitPlannerMemoryStats& Stats) const
+{
+	const auto KiB = [](const int64 Bytes) { return Bytes / 1024.0; };
+	FString MemoryString = FString::Printf(TEXT("Memory: %.1f KiB (%d factories, %d versions, %d nodes, %d shared subtrees)\n"),
+		KiB(Stats.GetTotalBytes()), Stats.Factories, Stats.Versions, Stats.Nodes, Stats.SharedSubtrees);
+	MemoryString += FString::Printf(TEXT("- Factories: %.1f KiB\n- History: %.1f KiB\n"), KiB(Stats.FactoryBytes), KiB(Stats.HistoryBytes));
+	if (Stats.RecipeIndexBytes > 0 || Stats.RecipeMapBytes > 0)
+	{
+		MemoryString += FString::Printf(TEXT("- Recipe index: %.1f KiB (+ %.1f KiB of tables & all-recipes graph shared by every world)\n- Recipe maps: %.1f KiB\n"),
+			KiB(Stats.RecipeIndexBytes), KiB(Stats.RecipeTableBytes), KiB(Stats.RecipeMapBytes));
+	}
+	if (Stats.SharedPlans > 0)
+	{
+		MemoryString += FString::Printf(TEXT("- Shared plans: %.1f KiB (%d plans, %d explored)\n"), KiB(Stats.SharedPlanBytes), Stats.SharedPlans, Stats.ExploredPlans);
+	}
+	if (MaxFactoryMemory > 0)
+	{
+		MemoryString += FString::Printf(TEXT("Budget: %.1f of %.1f KiB used (%s)\n"), KiB(GetUsedFactoryMemory()), KiB(MaxFactoryMemory), bEvictFactories ? TEXT("evicts") : TEXT("refuses"));
+	}
+	return MemoryString;
+}
 
-		// Add the recipe to the item's list of recipes
-		if (TArray<TSubclassOf<UFGRecipe>>& Recipes = UnlockedRecipesMap[Item]; !Recipes.Contains(Recipe))
+void AFicsitPlannerEngine::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	// Factory nodes are separate objects, only counted for the whole tree (so are the recipe tables, shared by every world)
+	const FFicsitPlannerMemoryStats Stats = GetMemoryStats();
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Stats.RecipeIndexBytes + Stats.RecipeMapBytes);
+	if (CumulativeResourceSize.GetResourceSizeMode() == EResourceSizeMode::EstimatedTotal)
+	{
+		CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Stats.FactoryBytes + Stats.HistoryBytes + Stats.RecipeTableBytes);
+	}
+}
+
+void AFicsitPlannerEngine::SetFactoryMemoryBudget(const int64 MaxBytes, const bool bEvict)
+{
+	MaxFactoryMemory = FMath::Max<int64>(MaxBytes, 0);
+	bEvictFactories = bEvict;
+	if (GetUsedFactoryMemory() > MaxFactoryMemory && MaxFactoryMemory > 0)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Saved factories already use %lld bytes, over the new budget of %lld bytes (applies to new factories)."), GetUsedFactoryMemory(), MaxFactoryMemory);
+	}
+}
+
+void AFicsitPlannerEngine::GetFactoryVersions(const int32 Entry, TArray<UFicsitPlannerFactory*>& OutVersions) const
+{
+	// Current version first (its nodes count as factory memory, nodes only reached from the others as history)
+	OutVersions.Add(Factories[Entry]);
+	OutVersions.Append(FactoryHistories[Entry].UndoVersions);
+	OutVersions.Append(FactoryHistories[Entry].RedoVersions);
+}
+
+void AFicsitPlannerEngine::CollectFactoryMemory(const TConstArrayView<UFicsitPlannerFactory*> Versions, TSet<UFicsitPlannerFactory*>& VisitedNodes, FFicsitPlannerMemoryStats& Stats)
+{
+	Stats.Factories++;
+	TArray<UFicsitPlannerFactory*> NodeStack;
+	for (int32 Version = 0; Version < Versions.Num(); ++Version)
+	{
+		Stats.Versions++;
+		NodeStack.Add(Versions[Version]);
+		while (NodeStack.Num() > 0)
 		{
-			Recipes.Add(Recipe);
+			UFicsitPlannerFactory* Node = NodeStack.Pop();
+			if (!Node) continue;
+
+			// A node reached again is shared with its whole subtree (edits copy paths, never subtrees), so it's only counted once
+			bool bAlreadyVisited;
+			VisitedNodes.Add(Node, &bAlreadyVisited);
+			if (bAlreadyVisited)
+			{
+				Stats.SharedSubtrees++;
+				continue;
+			}
+
+			const int64 NodeBytes = GetNodeMemory(Node);
+			(Version == 0 ? Stats.FactoryBytes : Stats.HistoryBytes) += NodeBytes;
+			Stats.Nodes++;
+			Node->GetChildNodes(NodeStack);
 		}
 	}
 }
 
-void AFicsitPlannerEngine::RegisterRecipe(const TSubclassOf<UFGRecipe> Recipe)
+int64 AFicsitPlannerEngine::GetNodeMemory(UFicsitPlannerFactory* Node)
 {
-	// Ensure the recipe is produced in a building
-	if (!RecipeProducedInBuilding(Recipe)) return;
+	return Node->GetClass()->GetStructureSize() + Node->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+}
 
-	// Get the recipe's products
-	const UFGRecipe* RecipeObj = Recipe->GetDefaultObject<UFGRecipe>();
+int64 AFicsitPlannerEngine::AddNodeRefs(TMap<UFicsitPlannerFactory*, int32>& NodeRefs, UFicsitPlannerFactory* Version)
+{
+	// Only nodes seen for the first time are counted & walked into (shared subtrees just gain a reference)
+	int64 Bytes = 0;
+	TArray<UFicsitPlannerFactory*> NodeStack;
+	NodeStack.Add(Version);
+	while (NodeStack.Num() > 0)
+	{
+		UFicsitPlannerFactory* Node = NodeStack.Pop();
+		if (!Node || ++NodeRefs.FindOrAdd(Node) > 1) continue;
+
+		Bytes += GetNodeMemory(Node);
+		Node->GetChildNodes(NodeStack);
+	}
+	return Bytes;
+}
+
+int64 AFicsitPlannerEngine::ReleaseNodeRefs(TMap<UFicsitPlannerFactory*, int32>& NodeRefs, UFicsitPlannerFactory* Version)
+{
+	// Only nodes losing their last reference are freed & walked into (nodes are never edited once committed, so their children match)
+	int64 Bytes = 0;
+	TArray<UFicsitPlannerFactory*> NodeStack;
+	NodeStack.Add(Version);
+	while (NodeStack.Num() > 0)
+	{
+		UFicsitPlannerFactory* Node = NodeStack.Pop();
+		if (!Node) continue;
+		int32* Refs = NodeRefs.Find(Node);
+		if (!Refs || --*Refs > 0) continue;
+
+		NodeRefs.Remove(Node);
+		Bytes += GetNodeMemory(Node);
+		Node->GetChildNodes(NodeStack);
+	}
+	return Bytes;
+}
+
+void AFicsitPlannerEngine::AddFactoryVersion(const int32 Entry, UFicsitPlannerFactory* Version)
+{
+	const int64 Bytes = AddNodeRefs(FactoryNodeRefs[Entry], Version);
+	FactoryMemory[Entry] += Bytes;
+	UsedFactoryMemory += Bytes;
+}
+
+void AFicsitPlannerEngine::ReleaseFactoryVersion(const int32 Entry, UFicsitPlannerFactory* Version)
+{
+	const int64 Bytes = ReleaseNodeRefs(FactoryNodeRefs[Entry], Version);
+	FactoryMemory[Entry] -= Bytes;
+	UsedFactoryMemory -= Bytes;
+}
 
-	// Add products to recipe map
-	for (TArray<FItemAmount> Products = RecipeObj->GetProducts(); const FItemAmount& Product : Products)
+bool AFicsitPlannerEngine::ReserveFactoryMemory(const int64 Bytes)
+{
+	if (MaxFactoryMemory <= 0) return true;
+	if (Bytes > MaxFactoryMemory) return false;
+
+	// Deleting a factory releases its bytes from the running total
+	while (UsedFactoryMemory + Bytes > MaxFactoryMemory)
 	{
-		TSubclassOf<UFGItemDescriptor> Item = Product.ItemClass;
+		if (!bEvictFactories || Factories.Num() == 0) return false;
 
-		// Add item to all items list
-		if (!AllItems.Contains(Item)) AllItems.Add(Item);
+		// Evict the least recently used factory (saved, fetched or edited the longest ago)
+		int32 Oldest = 0;
+		for (int32 Entry = 1; Entry < Factories.Num(); ++Entry)
+		{
+			if (FactoryLastUsed[Entry] < FactoryLastUsed[Oldest]) Oldest = Entry;
+		}
 
-		// If the item doesn't exist in the map, create a new entry
-		if (!AllRecipesMap.Contains(Item)) AllRecipesMap.Add(Item, TArray<TSubclassOf<UFGRecipe>>());
+		const int FactoryID = FactoryIDs[Oldest];
+		UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Evicted factory %d (%lld bytes) to stay within the factory memory budget."), FactoryID, FactoryMemory[Oldest]);
+		DeleteFactory(FactoryID);
+	}
+	return true;
+}
 
-		// Add the recipe to the item's list of recipes
+UFicsitPlannerFactory* AFicsitPlannerEngine::CopyFactoryPath(UFicsitPlannerFactory* Root, const TArray<int32>& Path, UFicsitPlannerFactory*& OutNode)
+{
+	// Shallow copies (subfactories aren't outered to their parent, so they stay shared)
+	const auto CopyNode = [](UFicsitPlannerFactory* Node) { return DuplicateObject<UFicsitPlannerFactory>(Node, GetTransientPackage()); };
 
-		if (TArray<TSubclassOf<UFGRecipe>>& Recipes = AllRecipesMap[Item]; !Recipes.Contains(Recipe))
+	UFicsitPlannerFactory* NewRoot = CopyNode(Root);
+	UFicsitPlannerFactory* Node = NewRoot;
+	for (const int32 Child : Path)
+	{
+		// Groups take their subfactories from their selected factory, which is copied too
+		UFicsitPlannerFactory* Parent = Node;
+		if (UFicsitPlannerFactoryGroup* FactoryGroup = Cast<UFicsitPlannerFactoryGroup>(Node))
 		{
-			Recipes.Add(Recipe);
+			Parent = CopyNode(FactoryGroup->GetSelectedFactory());
+			FactoryGroup->SetFactory(FactoryGroup->GetSelectedFactoryIndex(), Parent);
 		}
+
+		TArray<UFicsitPlannerFactory*>& Subfactories = *Parent->GetSubfactories();
+		Subfactories[Child] = CopyNode(Subfactories[Child]);
+		Node = Subfactories[Child];
 	}
-}
\ No newline at end of file
+
+	OutNode = Node;
+	return NewRoot;
+}
+
+bool AFicsitPlannerEngine::OptimizeFactory(int Factory, EFactoryOptimizationType Optimization)
+{
+	// Get the factory
+	UFicsitPlannerFactory* FactoryObj = GetFactory(Factory);
+	if (!FactoryObj) return false;
+
+	// Check if optimization is valid
+	if (Optimization == EFactoryOptimizationType::EFOT_None)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid optimization type!"));
+		return false;
+	}
+
+	// Optimize the factory
+	// The factory was already created (confirmed if it was large), so its optimized version is too
+	UFicsitPlannerFactory* NewFactory = AFicsitPlannerEngine::CreateFactoryPlan(FactoryObj->GetPrimaryProduct(), FactoryObj->UsesLockedRecipes, Optimization, true);
+	if (!NewFactory)
+	{
+		// Too large, or no plan for this objective (the saved factory is kept)
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to optimize factory %d!"), Factory);
+		return false;
+	}
+
+	// Replace the factory
+	if (ReplaceFactory(Factory, NewFactory))
+	{
+		UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Factory %d optimized successfully!"), Factory);
+		return true;
+	}
+	else
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to optimize factory %d!"), Factory);
+		return false;
+	}
+}
+
+bool AFicsitPlannerEngine::ScaleFactory(int FactoryID, float Rate)
+{
+	// Get the factory
+	UFicsitPlannerFactory* Factory = GetFactory(FactoryID);
+	if (!Factory) return false;
+
+	// Check if the rates are valid (everything is linear in the target rate)
+	const int CurrentRate = Factory->GetPrimaryProduct().Amount;
+	if (Rate <= 0.0f || CurrentRate <= 0)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Can't scale factory %d from %d to %.2f / min!"), FactoryID, CurrentRate, Rate);
+		return false;
+	}
+
+	// Scale a copy (the current version is kept for undo)
+	return ReplaceFactory(FactoryID, Factory->CreateScaledCopy(Rate / CurrentRate));
+}
+
+int AFicsitPlannerEngine::SaveSharedPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization)
+{
+	// Check if the target product is valid
+	const int32 Item = TargetProduct.ItemClass ? Dataset->Index.FindItem(TargetProduct.ItemClass) : INDEX_NONE;
+	if (Item == INDEX_NONE)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid target product!"));
+		return INDEX_NONE;
+	}
+
+	return SharedPlans.Save(Item, TargetProduct.Amount, bAllowLockedRecipes, Optimization);
+}
+
+TArray<int> AFicsitPlannerEngine::SaveTopSharedPlans(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, int K, FString& Ranking)
+{
+	TArray<int32> PlanIDs;
+	Ranking.Empty();
+
+	// Check if the target product is valid
+	const int32 Item = TargetProduct.ItemClass ? Dataset->Index.FindItem(TargetProduct.ItemClass) : INDEX_NONE;
+	if (Item == INDEX_NONE)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid target product!"));
+		return PlanIDs;
+	}
+
+	TArray<FFicsitPlannerRankedPlan> RankedPlans;
+	SharedPlans.SaveTop(Item, TargetProduct.Amount, bAllowLockedRecipes, Optimization, K, PlanIDs, RankedPlans);
+	for (int32 i = 0; i < PlanIDs.Num(); ++i)
+	{
+		Ranking += FString::Printf(TEXT("#%d: shared plan %d, %.2f MW, complexity %lld\n"), i + 1, PlanIDs[i], RankedPlans[i].TotalPower, RankedPlans[i].TotalComplexity);
+	}
+	return PlanIDs;
+}
+
+UFicsitPlannerFactory* AFicsitPlannerEngine::CreateFactoryFromSharedPlan(int PlanID)
+{
+	FFicsitPlannerPlan Plan;
+	if (!SharedPlans.Instantiate(PlanID, Plan)) return nullptr;
+	return CreateFactoryFromPlan(Plan, 0);
+}
+
+FString AFicsitPlannerEngine::SharedPlanToString(int PlanID) const
+{
+	FFicsitPlannerPlan Plan;
+	if (!SharedPlans.Instantiate(PlanID, Plan)) return FString::Printf(TEXT("Invalid shared plan ID %d!"), PlanID);
+
+	// Printed with the recipe data it was explored with
+	FFicsitPlannerCore Core(*Plan.Index);
+	Core.SetLogistics(Logistics);
+	return Core.PlanToString(Plan);
+}
+
+TArray<int> AFicsitPlannerEngine::GetAllSharedPlanIDs() const
+{
+	TArray<int32> PlanIDs;
+	SharedPlans.GetPlanIDs(PlanIDs);
+	PlanIDs.Sort();
+	return PlanIDs;
+}
+
+void AFicsitPlannerEngine::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+	ProcessJobs();
+}
+
+void AFicsitPlannerEngine::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	JobQueue.Wait();
+	Super::EndPlay(EndPlayReason);
+}
+
+int AFicsitPlannerEngine::EnqueueCreateFactory(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, int Priority, bool bConfirmLargePlan)
+{
+	// Check if the target product is valid
+	const int32 Item = TargetProduct.ItemClass ? Dataset->Index.FindItem(TargetProduct.ItemClass) : INDEX_NONE;
+	if (Item == INDEX_NONE || TargetProduct.Amount <= 0)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid target product!"));
+		return INDEX_NONE;
+	}
+
+	FFicsitPlannerJobRequest Request;
+	Request.Type = EFicsitPlannerJobType::Create;
+	Request.Item = Item;
+	Request.Rate = TargetProduct.Amount;
+	Request.bAllowLockedRecipes = bAllowLockedRecipes;
+	Request.Optimization = Optimization;
+	Request.bConfirmLargePlan = bConfirmLargePlan;
+	return EnqueueJob(Request, Priority, nullptr);
+}
+
+int AFicsitPlannerEngine::EnqueueOptimizeFactory(int FactoryID, EFactoryOptimizationType Optimization, int Priority)
+{
+	// Get the factory
+	UFicsitPlannerFactory* Factory = GetFactory(FactoryID);
+	if (!Factory) return INDEX_NONE;
+
+	// Check if optimization is valid
+	const FItemAmount Product = Factory->GetPrimaryProduct();
+	const int32 Item = Product.ItemClass ? Dataset->Index.FindItem(Product.ItemClass) : INDEX_NONE;
+	if (Optimization == EFactoryOptimizationType::EFOT_None || Item == INDEX_NONE)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Invalid optimization type!"));
+		return INDEX_NONE;
+	}
+
+	FFicsitPlannerJobRequest Request;
+	Request.Type = EFicsitPlannerJobType::Optimize;
+	Request.Item = Item;
+	Request.Rate = Product.Amount;
+	Request.bAllowLockedRecipes = Factory->UsesLockedRecipes;
+	Request.Optimization = Optimization;
+	Request.FactoryID = FactoryID;
+	Request.bConfirmLargePlan = true;
+	return EnqueueJob(Request, Priority, nullptr);
+}
+
+int32 AFicsitPlannerEngine::EnqueueJob(const FFicsitPlannerJobRequest& Request, const int32 Priority, FFicsitPlannerJobCallback&& OnCompleted)
+{
+	const int32 JobID = JobQueue.Enqueue(Request, Dataset, Priority, MoveTemp(OnCompleted));
+	UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Queued planner job %d (position %d)."), JobID, JobQueue.GetPosition(JobID));
+
+	// Start it right away if a worker is free
+	JobQueue.StartJobs(MaxRunningJobs, MaxFullPlanNodes, MaxPlanNodes);
+	return JobID;
+}
+
+void AFicsitPlannerEngine::ProcessJobs()
+{
+	if (JobQueue.NumQueued() == 0 && JobQueue.NumRunning() == 0) return;
+
+	// Finish planned jobs until the budget is spent (at least one, so the queue always drains)
+	const double Deadline = FPlatformTime::Seconds() + JobFrameBudgetMs / 1000.0;
+	do
+	{
+		TUniquePtr<FFicsitPlannerJob> Job = JobQueue.TakeFinishedJob();
+		if (!Job) break;
+
+		const int32 FactoryID = FinishJob(*Job);
+		for (const FFicsitPlannerJobCallback& Callback : Job->Callbacks)
+		{
+			if (Callback) Callback(Job->JobID, FactoryID);
+		}
+		OnJobCompleted.Broadcast(Job->JobID, FactoryID);
+
+		// Refill the workers freed by this job
+		JobQueue.StartJobs(MaxRunningJobs, MaxFullPlanNodes, MaxPlanNodes);
+	}
+	while (FPlatformTime::Seconds() < Deadline);
+
+	JobQueue.StartJobs(MaxRunningJobs, MaxFullPlanNodes, MaxPlanNodes);
+}
+
+int32 AFicsitPlannerEngine::FinishJob(const FFicsitPlannerJob& Job)
+{
+	const FFicsitPlannerJobRequest& Request = Job.Request;
+	if (Job.Strategy == EFactoryPlanStrategy::EFPS_TooLarge)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Planner job %d failed: the plan for item %d is too large to create!"), Job.JobID, Request.Item);
+		return INDEX_NONE;
+	}
+	if (FFicsitPlannerCore::NeedsConfirmation(Job.Strategy) && !Request.bConfirmLargePlan)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Planner job %d failed: the plan for item %d is large and needs confirmation!"), Job.JobID, Request.Item);
+		return INDEX_NONE;
+	}
+	if (!Job.bPlanned)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Planner job %d failed: no recipes found for item %d!"), Job.JobID, Request.Item);
+		return INDEX_NONE;
+	}
+
+	// Create the factory (UObjects, so on the game thread)
+	UFicsitPlannerFactory* Factory = CreateFactoryFromPlan(Job.Plan, 0);
+	if (!Factory) return INDEX_NONE;
+
+	// OPTION 1: New factory
+	if (Request.Type == EFicsitPlannerJobType::Create) return SaveFactory(Factory);
+
+	// OPTION 2: Replace the factory (if it wasn't deleted meanwhile)
+	if (!ReplaceFactory(Request.FactoryID, Factory))
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to optimize factory %d!"), Request.FactoryID);
+		return INDEX_NONE;
+	}
+	return Request.FactoryID;
+}
+
+bool AFicsitPlannerEngine::AddExclusionRule(EFactoryExclusionType Type, const FString& Rule)
+{
+	const FString TrimmedRule = Rule.TrimStartAndEnd();
+	TArray<FString>& Rules = GetExclusionList(Type);
+	if (TrimmedRule.IsEmpty() || Rules.Contains(TrimmedRule)) return false;
+
+	Rules.Add(TrimmedRule);
+	ApplyExclusionRules();
+	return true;
+}
+
+bool AFicsitPlannerEngine::RemoveExclusionRule(EFactoryExclusionType Type, const FString& Rule)
+{
+	if (GetExclusionList(Type).Remove(Rule.TrimStartAndEnd()) == 0) return false;
+
+	ApplyExclusionRules();
+	return true;
+}
+
+FString AFicsitPlannerEngine::ExclusionRulesToString() const
+{
+	const auto RulesToString = [](const TArray<FString>& Rules)
+	{
+		return Rules.Num() > 0 ? FString::Join(Rules, TEXT(", ")) : FString(TEXT("-"));
+	};
+	return FString::Printf(TEXT("Excluded items: %s\nExcluded recipes: %s\nExcluded buildings: %s\n%d recipes excluded"),
+		*RulesToString(ExcludedItems), *RulesToString(ExcludedRecipes), *RulesToString(ExcludedBuildings), Dataset->Index.NumExcludedRecipes());
+}
+
+void AFicsitPlannerEngine::ApplyExclusionRules()
+{
+	SaveConfig();
+
+	// New version from a copy of the current one: only the masks are compiled again (no recipe CDOs), and it's only published if they changed
+	const TSharedRef<FFicsitPlannerRecipeDataset, ESPMode::ThreadSafe> NewDataset = MakeShared<FFicsitPlannerRecipeDataset, ESPMode::ThreadSafe>(*Dataset);
+	NewDataset->Version = Dataset->Version + 1;
+	if (!NewDataset->Index.SetExclusionRules(GetExclusionRules())) return;
+
+	NewDataset->RegisterRecipes();
+	PublishDataset(NewDataset);
+	UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Exclusion rules changed, %d recipes excluded."), Dataset->Index.NumExcludedRecipes());
+}
+
+void AFicsitPlannerEngine::PublishDataset(const FFicsitPlannerRecipeDatasetRef& NewDataset)
+{
+	// Swapped on the game thread only: jobs & shared plans took their own reference, so they never see a partial version
+	Dataset = NewDataset;
+	SharedPlans.SetDataset(Dataset);
+	UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Published recipe data version %u."), Dataset->Version);
+}
+
+TArray<FString>& AFicsitPlannerEngine::GetExclusionList(EFactoryExclusionType Type)
+{
+	switch (Type)
+	{
+	case EFactoryExclusionType::EFET_Recipe: return ExcludedRecipes;
+	case EFactoryExclusionType::EFET_Building: return ExcludedBuildings;
+	default: return ExcludedItems;
+	}
+}
+
+TSubclassOf<UFGItemDescriptor> AFicsitPlannerEngine::FindItem(const FString& ItemName)
+{
+	// Search for the item in the unlocked items
+	for (const TSubclassOf<UFGItemDescriptor>& Item : Dataset->UnlockedItems)
+	{
+		if (Item->GetDefaultObject<UFGItemDescriptor>()->mDisplayName.ToString().Equals(ItemName, ESearchCase::IgnoreCase))
+		{
+			return Item;
+		}
+	}
+	return nullptr;
+}
+
+bool AFicsitPlannerEngine::RecipeProducedInBuilding(const TSubclassOf<UFGRecipe> Recipe)
+{
+	// Get the default values of the recipe
+	const UFGRecipe* RecipeObj = Recipe->GetDefaultObject<UFGRecipe>();
+
+	// Get "Produced In" property
+	TArray<TSubclassOf<UObject>> ProducedIn;
+	RecipeObj->GetProducedIn(ProducedIn);
+
+	// Check if any of the producers is a building
+	for (const TSubclassOf<UObject>& Producer : ProducedIn)
+	{
+		if (Producer->GetName().StartsWith("Build_"))
+		{
+			// If produced in a building, return true
+			return true;
+		}
+	}
+
+	// If not produced in a building, return false
+	return false;
+}
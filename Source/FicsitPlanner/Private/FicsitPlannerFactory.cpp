@@ -3,6 +3,7 @@
 
 #include "FicsitPlannerFactory.h"
 
+#include "FicsitPlannerCore.h"
 #include "FicsitPlannerEngine.h"
 #include "FicsitPlannerFactoryGroup.h"
 
@@ -25,10 +26,15 @@ UFicsitPlannerFactory::~UFicsitPlannerFactory()
 
 void UFicsitPlannerFactory::Init(const FItemAmount Target, const TSubclassOf<UFGRecipe> InRecipe, const TArray<TSubclassOf<UFGRecipe>>& VisitedRecipes, const bool AllowLockedRecipes, EFactoryOptimizationType Optimization, AFicsitPlannerEngine* Engine)
 {
-	// PART 0: Calculate basic recipe info
+	// PART 0: Calculate basic recipe info (from the compiled recipe index)
+	const FFicsitPlannerRecipeIndex& Index = Engine->GetRecipeIndex();
+	const FFicsitPlannerRecipeData& RecipeData = Index.GetRecipe(Index.FindRecipe(InRecipe));
+	const int32 TargetItem = Index.FindItem(Target.ItemClass);
+	const float TargetRate = Index.GetProductRate(Index.FindRecipe(InRecipe), TargetItem);
+
 	Recipe = InRecipe;
-	Multiplier = AFicsitPlannerEngine::GetFactoryMultiplier(Recipe, Target);
-	PowerConsumption = AFicsitPlannerEngine::GetFactoryPowerConsumption(Recipe, Multiplier);
+	Multiplier = TargetRate > 0.0f ? Target.Amount / TargetRate : 1.0f;
+	PowerConsumption = RecipeData.Power * Multiplier;
 	PrimaryProduct = Target;
 	UsesLockedRecipes = AllowLockedRecipes;
 	
@@ -40,111 +46,82 @@ void UFicsitPlannerFactory::Init(const FItemAmount Target, const TSubclassOf<UFG
 	int BuildingCount = ceil(Multiplier);
 	Complexity = RECIPE_COMPLEXITY + (BUILDING_COMPLEXITY * BuildingCount);
 
-	// PART 3: Save byproducts
-	for (const FItemAmount& Product : Recipe->GetDefaultObject<UFGRecipe>()->GetProducts())
+	// PART 3: Save byproducts (per minute, at this factory's multiplier)
+	for (const FFicsitPlannerItemRate& Product : RecipeData.Products)
 	{
-		if (Product.ItemClass != Target.ItemClass)
+		if (Product.Item != TargetItem)
 		{
-			Byproducts.Add(Product);
+			Byproducts.Add(FItemAmount(Index.GetItemClass(Product.Item), static_cast<int32>(Product.Rate * Multiplier)));
 		}
 	}
 
 	// PART 4: Generate subfactories
-	for (const FItemAmount& Input : Recipe->GetDefaultObject<UFGRecipe>()->GetIngredients())
+	for (const FFicsitPlannerItemRate& Input : RecipeData.Ingredients)
 	{
 		// PART 4.0: Calculate target amount
-		FItemAmount TargetInput = Input;
-		float CraftDuration = Recipe->GetDefaultObject<UFGRecipe>()->GetManufacturingDuration();
-		TargetInput.Amount *= Multiplier * (60.0f / CraftDuration);
+		const FItemAmount TargetInput(Index.GetItemClass(Input.Item), static_cast<int32>(Input.Rate * Multiplier));
 
-		// PART 4.1: Check if there are recipes for the input item
-		if (AllowLockedRecipes && Engine->GetAllRecipesMap().Contains(Input.ItemClass) == false)
-		{
-			UE_LOG(LogTemp, Warning, TEXT("No recipes found for input item %s!"), *Input.ItemClass->GetName());
-			continue;
-		}
-		if (!AllowLockedRecipes && Engine->GetUnlockedRecipesMap().Contains(Input.ItemClass) == false)
+		// PART 4.1: Create the subfactory (single recipe, recipe group or loop, see AFicsitPlannerEngine::CreateFactoryNode)
+		if (UFicsitPlannerFactory* Subfactory = Engine->CreateFactoryNode(TargetInput, NewVisitedRecipes, AllowLockedRecipes, Optimization))
 		{
-			UE_LOG(LogTemp, Warning, TEXT("No unlocked recipes found for input item %s!"), *Input.ItemClass->GetName());
-			continue;
+			Subfactories.Add(Subfactory);
 		}
-		
-		// PART 4.2: Get recipes for input item
-		TArray<TSubclassOf<UFGRecipe>> Recipes = AllowLockedRecipes ?
-			Engine->GetAllRecipesMap()[Input.ItemClass] :
-			Engine->GetUnlockedRecipesMap()[Input.ItemClass];
-
-		// PART 4.3: Remove any visited recipes from the list
-		for (const TSubclassOf<UFGRecipe>& VisitedRecipe : NewVisitedRecipes)
+	}
+}
+
+void UFicsitPlannerFactory::InitFromPlan(const FFicsitPlannerPlan& Plan, const int32 Node, AFicsitPlannerEngine* Engine)
+{
+	const FFicsitPlannerRecipeIndex& Index = Plan.Index ? *Plan.Index : Engine->GetRecipeIndex();
+	const FFicsitPlannerPlanNode& PlanNode = Plan.Nodes[Node];
+
+	// PART 1: Copy the node's metrics (already computed by the planner core)
+	Recipe = Index.GetRecipe(PlanNode.Recipe).Class;
+	Multiplier = PlanNode.Multiplier;
+	PowerConsumption = PlanNode.Power;
+	Complexity = PlanNode.Complexity;
+	PrimaryProduct = FItemAmount(Index.GetItemClass(PlanNode.Item), static_cast<int32>(PlanNode.Rate));
+	UsesLockedRecipes = Plan.bAllowLockedRecipes;
+
+	// PART 2: Save byproducts (per minute, at this factory's multiplier)
+	for (const FFicsitPlannerItemRate& Product : Index.GetRecipe(PlanNode.Recipe).Products)
+	{
+		if (Product.Item != PlanNode.Item)
 		{
-			Recipes.Remove(VisitedRecipe);
+			Byproducts.Add(FItemAmount(Index.GetItemClass(Product.Item), static_cast<int32>(Product.Rate * Multiplier)));
 		}
+	}
 
-		// DEBUG: LOG RECIPES
-		UE_LOG(LogTemp, Warning, TEXT("Recipes for %s: "), *Input.ItemClass->GetName());
-		for (const TSubclassOf<UFGRecipe>& Recipe : Recipes)
+	// PART 3: Create subfactories (leaf inputs have none)
+	for (const int32 Child : PlanNode.Children)
+	{
+		if (UFicsitPlannerFactory* Subfactory = Engine->CreateFactoryFromPlan(Plan, Child))
 		{
-			UE_LOG(LogTemp, Warning, TEXT(" - %s"), *Recipe->GetName());
-		}
-		
-
-		// PART 4.4: Single recipe case
-		if (Recipes.Num() == 1) {
-		
-			// Create a new subfactory
-			UFicsitPlannerFactory* Subfactory = NewObject<UFicsitPlannerFactory>();
-			Subfactory->Init(TargetInput, Recipes[0], NewVisitedRecipes, AllowLockedRecipes, Optimization, Engine);
 			Subfactories.Add(Subfactory);
 		}
-		// PART 4.5: Multiple recipes case
-		else if (Recipes.Num() > 1)
-		{
-			// Create a new subfactory group
-			UFicsitPlannerFactoryGroup* SubfactoryGroup = NewObject<UFicsitPlannerFactoryGroup>();
-			SubfactoryGroup->Init(TargetInput, Recipes, NewVisitedRecipes, AllowLockedRecipes, Optimization, Engine);
-			Subfactories.Add(SubfactoryGroup);
-			
-			// Optimization: Select the best subfactory
-			if (Optimization == EFactoryOptimizationType::EFOT_PowerConsumption)
-			{
-				// Get power consumption of all subfactories
-				TArray<float> PowerConsumptions = SubfactoryGroup->GetAllPowerConsumptions();
-				
-				// Find the index of the subfactory with the lowest power consumption
-				int MinIndex = 0;
-				float MinPowerConsumption = PowerConsumptions[0];
-				for (int i = 1; i < PowerConsumptions.Num(); ++i)
-				{
-					if (PowerConsumptions[i] < MinPowerConsumption)
-					{
-						MinPowerConsumption = PowerConsumptions[i];
-						MinIndex = i;
-					}
-				}
-				
-				// Select the subfactory with the lowest power consumption
-				SubfactoryGroup->SetSelectedFactoryIndex(MinIndex);
-			} else if (Optimization == EFactoryOptimizationType::EFOT_Complexity)
-			{
-				// Get complexity of all subfactories
-				TArray<int> Complexities = SubfactoryGroup->GetAllComplexities();
-				
-				// Find the index of the subfactory with the lowest complexity
-				int MinIndex = 0;
-				int MinComplexity = Complexities[0];
-				for (int i = 1; i < Complexities.Num(); ++i)
-				{
-					if (Complexities[i] < MinComplexity)
-					{
-						MinComplexity = Complexities[i];
-						MinIndex = i;
-					}
-				}
-				
-				// Select the subfactory with the lowest complexity
-				SubfactoryGroup->SetSelectedFactoryIndex(MinIndex);
-			}
-		}
+	}
+}
+
+UFicsitPlannerFactory* UFicsitPlannerFactory::CreateScaledCopy(const float Factor) const
+{
+	// Shallow copy (subfactories aren't outered to this node), then every subfactory is replaced with its own scaled copy
+	UFicsitPlannerFactory* Copy = DuplicateObject<UFicsitPlannerFactory>(this, GetTransientPackage());
+	Copy->ScaleMetrics(Factor);
+	for (UFicsitPlannerFactory*& Subfactory : Copy->Subfactories)
+	{
+		if (Subfactory) Subfactory = Subfactory->CreateScaledCopy(Factor);
+	}
+	return Copy;
+}
+
+void UFicsitPlannerFactory::ScaleMetrics(const float Factor)
+{
+	Multiplier *= Factor;
+	PowerConsumption *= Factor;
+	Complexity = RECIPE_COMPLEXITY + (BUILDING_COMPLEXITY * static_cast<int>(ceil(Multiplier)));
+	PrimaryProduct.Amount = FMath::RoundToInt(PrimaryProduct.Amount * Factor);
+	for (FItemAmount& Byproduct : Byproducts)
+	{
+		Byproduct.Amount = FMath::RoundToInt(Byproduct.Amount * Factor);
 	}
 }
 
@@ -217,3 +194,17 @@ TArray<UFicsitPlannerFactory*>* UFicsitPlannerFactory::GetSubfactories()
 	// Will be helpful when updating the subfactories, and we want to recalculate everything from the top!
 	return &Subfactories;
 }
+
+void UFicsitPlannerFactory::GetChildNodes(TArray<UFicsitPlannerFactory*>& OutNodes) const
+{
+	for (UFicsitPlannerFactory* Subfactory : Subfactories)
+	{
+		if (Subfactory) OutNodes.Add(Subfactory);
+	}
+}
+
+void UFicsitPlannerFactory::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Byproducts.GetAllocatedSize() + Subfactories.GetAllocatedSize());
+}
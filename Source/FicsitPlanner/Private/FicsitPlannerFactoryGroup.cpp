@@ -1,5 +1,74 @@
 #include "FicsitPlannerFactoryGroup.h"
 
+#include "FicsitPlannerCore.h"
+#include "FicsitPlannerEngine.h"
+#include "FicsitPlannerFactoryLoop.h"
+
+int UFicsitPlannerFactoryGroup::FindMinWeightedIndex(TConstArrayView<float> Power, TConstArrayView<int> Complexity, const float PowerWeight, const float ComplexityWeight)
+{
+	const int Num = FMath::Min(Power.Num(), Complexity.Num());
+	if (Num == 0) return INDEX_NONE;
+
+	// Start from the first alternative, so a non-empty list always has a best index (even if every score is inf or NaN)
+	const float FirstScore = Power[0] * PowerWeight + static_cast<float>(Complexity[0]) * ComplexityWeight;
+	float BestScore = FMath::IsNaN(FirstScore) ? MAX_flt : FirstScore;
+	int BestIndex = 0;
+	int i = 0;
+
+	// Vectorized body
+	if (Num >= 4)
+	{
+		const VectorRegister4Float PowerWeights = VectorSetFloat1(PowerWeight);
+		const VectorRegister4Float ComplexityWeights = VectorSetFloat1(ComplexityWeight);
+		const VectorRegister4Float LaneStep = VectorSetFloat1(4.0f);
+		VectorRegister4Float LaneIndices = MakeVectorRegisterFloat(0.0f, 1.0f, 2.0f, 3.0f);
+		VectorRegister4Float BestScores = VectorSetFloat1(MAX_flt);
+		VectorRegister4Float BestIndices = VectorSetFloat1(-1.0f);
+
+		for (; i + 4 <= Num; i += 4)
+		{
+			const VectorRegister4Float Powers = VectorLoad(&Power[i]);
+			const VectorRegister4Float Complexities = VectorIntToFloat(VectorIntLoad(&Complexity[i]));
+			const VectorRegister4Float Scores = VectorMultiplyAdd(Powers, PowerWeights, VectorMultiply(Complexities, ComplexityWeights));
+
+			// Strictly lower scores replace the lane's best, so earlier indices win ties
+			const VectorRegister4Float Better = VectorCompareLT(Scores, BestScores);
+			BestScores = VectorSelect(Better, Scores, BestScores);
+			BestIndices = VectorSelect(Better, LaneIndices, BestIndices);
+			LaneIndices = VectorAdd(LaneIndices, LaneStep);
+		}
+
+		// Reduce lanes
+		alignas(16) float LaneScores[4];
+		alignas(16) float LaneBestIndices[4];
+		VectorStoreAligned(BestScores, LaneScores);
+		VectorStoreAligned(BestIndices, LaneBestIndices);
+		for (int Lane = 0; Lane < 4; ++Lane)
+		{
+			const int LaneIndex = static_cast<int>(LaneBestIndices[Lane]);
+			if (LaneIndex < 0) continue;
+			if (LaneScores[Lane] < BestScore || (LaneScores[Lane] == BestScore && LaneIndex < BestIndex))
+			{
+				BestScore = LaneScores[Lane];
+				BestIndex = LaneIndex;
+			}
+		}
+	}
+
+	// Scalar tail
+	for (; i < Num; ++i)
+	{
+		const float Score = Power[i] * PowerWeight + static_cast<float>(Complexity[i]) * ComplexityWeight;
+		if (Score < BestScore)
+		{
+			BestScore = Score;
+			BestIndex = i;
+		}
+	}
+
+	return BestIndex;
+}
+
 UFicsitPlannerFactoryGroup::UFicsitPlannerFactoryGroup()
 {
 	// Initialize default values
@@ -12,17 +81,98 @@ UFicsitPlannerFactoryGroup::~UFicsitPlannerFactoryGroup()
 	// No cleanup needed, should be handled fine by the GC
 }
 
-void UFicsitPlannerFactoryGroup::Init(const FItemAmount Target, TArray<TSubclassOf<UFGRecipe>> InRecipes,
+void UFicsitPlannerFactoryGroup::Init(const FItemAmount Target, TArray<TSubclassOf<UFGRecipe>> InRecipes, const TArray<const FFicsitPlannerLoopSolution*>& Loops,
 	const TArray<TSubclassOf<UFGRecipe>>& VisitedRecipes, const bool AllowLockedRecipes, EFactoryOptimizationType Optimization, AFicsitPlannerEngine* Engine)
 {
 	UsesLockedRecipes = AllowLockedRecipes;
+
+	// Reserve the factory list and metric columns up front
+	const int NumAlternatives = InRecipes.Num() + Loops.Num();
+	Factories.Reserve(NumAlternatives);
+	AlternativeMultipliers.Reserve(NumAlternatives);
+	AlternativePowerConsumptions.Reserve(NumAlternatives);
+	AlternativeComplexities.Reserve(NumAlternatives);
+
 	// Cycle through all recipes
 	for (const TSubclassOf<UFGRecipe>& CurrentRecipe : InRecipes)
 	{
 		// Create a new subfactory
 		UFicsitPlannerFactory* Subfactory = NewObject<UFicsitPlannerFactory>();
 		Subfactory->Init(Target, CurrentRecipe, VisitedRecipes, AllowLockedRecipes, Optimization, Engine);
-		Factories.Add(Subfactory);
+		AddFactory(Subfactory);
+	}
+
+	// Cycle through all loops
+	for (const FFicsitPlannerLoopSolution* Loop : Loops)
+	{
+		// Create a new loop subfactory
+		UFicsitPlannerFactoryLoop* Subfactory = NewObject<UFicsitPlannerFactoryLoop>();
+		Subfactory->Init(Target, *Loop, VisitedRecipes, AllowLockedRecipes, Optimization, Engine);
+		AddFactory(Subfactory);
+	}
+
+	// Totals are filled lazily, but sized now so refreshing them never allocates
+	AlternativeTotalPowerConsumptions.SetNumZeroed(Factories.Num());
+	AlternativeTotalComplexities.SetNumZeroed(Factories.Num());
+}
+
+void UFicsitPlannerFactoryGroup::InitFromPlan(const FFicsitPlannerPlan& Plan, const int32 Node, AFicsitPlannerEngine* Engine)
+{
+	const FFicsitPlannerPlanNode& PlanNode = Plan.Nodes[Node];
+	UsesLockedRecipes = Plan.bAllowLockedRecipes;
+
+	// Create every alternative, keeping the planner core's selection
+	Factories.Reserve(PlanNode.Alternatives.Num());
+	for (const int32 Alternative : PlanNode.Alternatives)
+	{
+		if (UFicsitPlannerFactory* Subfactory = Engine->CreateFactoryFromPlan(Plan, Alternative))
+		{
+			AddFactory(Subfactory);
+		}
+	}
+	SelectedFactoryIndex = PlanNode.Selected;
+
+	// Totals are filled lazily, but sized now so refreshing them never allocates
+	AlternativeTotalPowerConsumptions.SetNumZeroed(Factories.Num());
+	AlternativeTotalComplexities.SetNumZeroed(Factories.Num());
+}
+
+UFicsitPlannerFactory* UFicsitPlannerFactoryGroup::CreateScaledCopy(const float Factor) const
+{
+	// Every alternative is scaled (keeps the selection, and switching later needs no refresh)
+	UFicsitPlannerFactoryGroup* Copy = CastChecked<UFicsitPlannerFactoryGroup>(Super::CreateScaledCopy(Factor));
+	for (int i = 0; i < Copy->Factories.Num(); ++i)
+	{
+		if (Copy->Factories[i]) Copy->SetFactory(i, Copy->Factories[i]->CreateScaledCopy(Factor));
+	}
+	return Copy;
+}
+
+void UFicsitPlannerFactoryGroup::AddFactory(UFicsitPlannerFactory* Factory)
+{
+	// Keep the metric columns aligned with the factory list
+	Factories.Add(Factory);
+	AlternativeMultipliers.Add(Factory->GetMultiplier());
+	AlternativePowerConsumptions.Add(Factory->GetPowerConsumption());
+	AlternativeComplexities.Add(Factory->GetComplexity());
+}
+
+void UFicsitPlannerFactoryGroup::SetFactory(const int Index, UFicsitPlannerFactory* Factory)
+{
+	// Keep the metric columns aligned with the factory list
+	Factories[Index] = Factory;
+	AlternativeMultipliers[Index] = Factory->GetMultiplier();
+	AlternativePowerConsumptions[Index] = Factory->GetPowerConsumption();
+	AlternativeComplexities[Index] = Factory->GetComplexity();
+}
+
+void UFicsitPlannerFactoryGroup::RefreshAlternativeTotals()
+{
+	// Columns are sized in Init, so this only writes in place
+	for (int i = 0; i < Factories.Num(); ++i)
+	{
+		AlternativeTotalPowerConsumptions[i] = Factories[i]->GetTotalPowerConsumption();
+		AlternativeTotalComplexities[i] = Factories[i]->GetTotalComplexity();
 	}
 }
 
@@ -91,94 +241,51 @@ int UFicsitPlannerFactoryGroup::GetTotalComplexity()
 	return Factories[SelectedFactoryIndex]->GetTotalComplexity();
 }
 
-TArray<float> UFicsitPlannerFactoryGroup::GetAllMultipliers() const
+TConstArrayView<float> UFicsitPlannerFactoryGroup::GetAllTotalPowerConsumption()
 {
-	// Create an array to store the multipliers
-	TArray<float> Multipliers;
-
-	// Iterate through all factories and add their multipliers to the array
-	for (const UFicsitPlannerFactory* Factory : Factories)
-	{
-		if (Factory)
-		{
-			Multipliers.Add(Factory->GetMultiplier());
-		}
-	}
-
-	// Return the array of multipliers
-	return Multipliers;
+	// Refresh the cached totals in place (subfactory selections may have changed)
+	RefreshAlternativeTotals();
+	return AlternativeTotalPowerConsumptions;
 }
 
-TArray<float> UFicsitPlannerFactoryGroup::GetAllPowerConsumptions() const
+TConstArrayView<int> UFicsitPlannerFactoryGroup::GetAllTotalComplexity()
 {
-	// Create an array to store the power consumption values
-	TArray<float> PowerConsumptions;
-
-	// Iterate through all factories and add their power consumption to the array
-	for (const UFicsitPlannerFactory* Factory : Factories)
-	{
-		if (Factory)
-		{
-			PowerConsumptions.Add(Factory->GetPowerConsumption());
-		}
-	}
-
-	// Return the array of power consumption values
-	return PowerConsumptions;
+	// Refresh the cached totals in place (subfactory selections may have changed)
+	RefreshAlternativeTotals();
+	return AlternativeTotalComplexities;
 }
 
-TArray<int> UFicsitPlannerFactoryGroup::GetAllComplexities() const
+int UFicsitPlannerFactoryGroup::FindBestFactoryIndex(const float PowerWeight, const float ComplexityWeight) const
 {
-	// Create an array to store the complexity values
-	TArray<int> Complexities;
-
-	// Iterate through all factories and add their complexity to the array
-	for (const UFicsitPlannerFactory* Factory : Factories)
-	{
-		if (Factory)
-		{
-			Complexities.Add(Factory->GetComplexity());
-		}
-	}
-
-	// Return the array of complexity values
-	return Complexities;
+	return FindMinWeightedIndex(AlternativePowerConsumptions, AlternativeComplexities, PowerWeight, ComplexityWeight);
 }
 
-TArray<float> UFicsitPlannerFactoryGroup::GetAllTotalPowerConsumption()
+int UFicsitPlannerFactoryGroup::FindBestTotalFactoryIndex(const float PowerWeight, const float ComplexityWeight)
 {
-	// Create an array to store the power consumption values
-	TArray<float> PowerConsumptions;
-
-	// Iterate through all factories and add their power consumption to the array
-	for (UFicsitPlannerFactory* Factory : Factories)
-	{
-		if (Factory)
-		{
-			PowerConsumptions.Add(Factory->GetTotalPowerConsumption());
-		}
-	}
-
-	// Return the array of power consumption values
-	return PowerConsumptions;
+	RefreshAlternativeTotals();
+	return FindMinWeightedIndex(AlternativeTotalPowerConsumptions, AlternativeTotalComplexities, PowerWeight, ComplexityWeight);
 }
 
-TArray<int> UFicsitPlannerFactoryGroup::GetAllTotalComplexity()
+void UFicsitPlannerFactoryGroup::SelectBestFactory(const EFactoryOptimizationType Optimization)
 {
-	// Create an array to store the complexity values
-	TArray<int> Complexities;
+	// No optimization, keep the current selection
+	if (Optimization == EFactoryOptimizationType::EFOT_None) return;
 
-	// Iterate through all factories and add their complexity to the array
-	for (UFicsitPlannerFactory* Factory : Factories)
+	float PowerWeight, ComplexityWeight;
+	GetOptimizationWeights(Optimization, PowerWeight, ComplexityWeight);
+
+	// Select the factory with the lowest weighted score
+	if (const int BestIndex = FindBestFactoryIndex(PowerWeight, ComplexityWeight); BestIndex != INDEX_NONE)
 	{
-		if (Factory)
-		{
-			Complexities.Add(Factory->GetTotalComplexity());
-		}
+		SelectedFactoryIndex = BestIndex;
 	}
+}
 
-	// Return the array of complexity values
-	return Complexities;
+void UFicsitPlannerFactoryGroup::GetOptimizationWeights(const EFactoryOptimizationType Optimization, float& OutPowerWeight, float& OutComplexityWeight)
+{
+	// Clock speed plans pick alternatives by power, then set building counts & clock speeds (see FFicsitPlannerClockSpeed)
+	OutPowerWeight = Optimization == EFactoryOptimizationType::EFOT_PowerConsumption || Optimization == EFactoryOptimizationType::EFOT_ClockSpeed ? 1.0f : 0.0f;
+	OutComplexityWeight = Optimization == EFactoryOptimizationType::EFOT_Complexity ? 1.0f : 0.0f;
 }
 
 TSubclassOf<UFGRecipe> UFicsitPlannerFactoryGroup::GetRecipe() const
@@ -319,4 +426,21 @@ TArray<TArray<UFicsitPlannerFactory*>> UFicsitPlannerFactoryGroup::GetAllSubfact
 
 	// Return the array of subfactories
 	return AllSubfactoriesResult;
-}
\ No newline at end of file
+}
+
+void UFicsitPlannerFactoryGroup::GetChildNodes(TArray<UFicsitPlannerFactory*>& OutNodes) const
+{
+	// Every alternative (the group's own subfactories are unused)
+	for (UFicsitPlannerFactory* Factory : Factories)
+	{
+		if (Factory) OutNodes.Add(Factory);
+	}
+}
+
+void UFicsitPlannerFactoryGroup::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Factories.GetAllocatedSize() + AlternativeMultipliers.GetAllocatedSize()
+		+ AlternativePowerConsumptions.GetAllocatedSize() + AlternativeComplexities.GetAllocatedSize()
+		+ AlternativeTotalPowerConsumptions.GetAllocatedSize() + AlternativeTotalComplexities.GetAllocatedSize());
+}
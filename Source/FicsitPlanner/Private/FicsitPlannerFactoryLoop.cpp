@@ -0,0 +1,119 @@
+#include "FicsitPlannerFactoryLoop.h"
+
+#include "FicsitPlannerCore.h"
+#include "FicsitPlannerEngine.h"
+#include "FicsitPlannerRecipeIndex.h"
+
+UFicsitPlannerFactoryLoop::UFicsitPlannerFactoryLoop()
+{
+	// Initialize default values
+	LoopRecipes.Empty();
+	LoopMultipliers.Empty();
+}
+
+UFicsitPlannerFactoryLoop::~UFicsitPlannerFactoryLoop()
+{
+	// No cleanup needed, should be handled fine by the GC
+}
+
+void UFicsitPlannerFactoryLoop::Init(const FItemAmount Target, const FFicsitPlannerLoopSolution& Solution, const TArray<TSubclassOf<UFGRecipe>>& VisitedRecipes,
+                                     const bool AllowLockedRecipes, EFactoryOptimizationType Optimization, AFicsitPlannerEngine* Engine)
+{
+	const FFicsitPlannerRecipeIndex& Index = Engine->GetRecipeIndex();
+
+	// PART 0: Basic info
+	PrimaryProduct = Target;
+	UsesLockedRecipes = AllowLockedRecipes;
+	Recipe = Index.GetRecipe(Solution.Recipes[0]).Class;
+
+	// PART 1: Scale every loop recipe to the target rate, and sum up its metrics
+	TArray<TSubclassOf<UFGRecipe>> NewVisitedRecipes = VisitedRecipes;
+	PowerConsumption = 0.0f;
+	Complexity = 0;
+	for (int i = 0; i < Solution.Recipes.Num(); ++i)
+	{
+		const FFicsitPlannerRecipeData& LoopRecipeData = Index.GetRecipe(Solution.Recipes[i]);
+		const TSubclassOf<UFGRecipe> LoopRecipe = LoopRecipeData.Class;
+		const float LoopMultiplier = Solution.Multipliers[i] * Target.Amount;
+
+		LoopRecipes.Add(LoopRecipe);
+		LoopMultipliers.Add(LoopMultiplier);
+		NewVisitedRecipes.Add(LoopRecipe);
+
+		PowerConsumption += LoopRecipeData.Power * LoopMultiplier;
+		Complexity += RECIPE_COMPLEXITY + (BUILDING_COMPLEXITY * static_cast<int>(ceil(LoopMultiplier)));
+	}
+	Multiplier = LoopMultipliers[0];
+
+	// PART 2: Save byproducts (net surplus of the loop, per minute)
+	for (const FFicsitPlannerItemRate& Byproduct : Solution.Byproducts)
+	{
+		Byproducts.Add(FItemAmount(Index.GetItemClass(Byproduct.Item), static_cast<int32>(Byproduct.Rate * Target.Amount)));
+	}
+
+	// PART 3: Generate subfactories for the inputs entering the loop
+	for (const FFicsitPlannerItemRate& Input : Solution.Inputs)
+	{
+		const FItemAmount TargetInput(Index.GetItemClass(Input.Item), static_cast<int32>(Input.Rate * Target.Amount));
+		if (UFicsitPlannerFactory* Subfactory = Engine->CreateFactoryNode(TargetInput, NewVisitedRecipes, AllowLockedRecipes, Optimization))
+		{
+			Subfactories.Add(Subfactory);
+		}
+	}
+}
+
+void UFicsitPlannerFactoryLoop::InitFromPlan(const FFicsitPlannerPlan& Plan, const int32 Node, AFicsitPlannerEngine* Engine)
+{
+	const FFicsitPlannerRecipeIndex& Index = Plan.Index ? *Plan.Index : Engine->GetRecipeIndex();
+	const FFicsitPlannerPlanNode& PlanNode = Plan.Nodes[Node];
+	const FFicsitPlannerLoopSolution& Solution = Index.GetGraph(Plan.bAllowLockedRecipes).Loops[PlanNode.Item][PlanNode.Loop];
+
+	// PART 0: Basic info & metrics (already summed over the loop by the planner core)
+	PrimaryProduct = FItemAmount(Index.GetItemClass(PlanNode.Item), static_cast<int32>(PlanNode.Rate));
+	UsesLockedRecipes = Plan.bAllowLockedRecipes;
+	Recipe = Index.GetRecipe(PlanNode.Recipe).Class;
+	Multiplier = PlanNode.Multiplier;
+	PowerConsumption = PlanNode.Power;
+	Complexity = PlanNode.Complexity;
+
+	// PART 1: Loop recipes, scaled to the node's rate
+	for (int i = 0; i < Solution.Recipes.Num(); ++i)
+	{
+		LoopRecipes.Add(Index.GetRecipe(Solution.Recipes[i]).Class);
+		LoopMultipliers.Add(Solution.Multipliers[i] * PlanNode.Rate);
+	}
+
+	// PART 2: Save byproducts (net surplus of the loop, per minute)
+	for (const FFicsitPlannerItemRate& Byproduct : Solution.Byproducts)
+	{
+		Byproducts.Add(FItemAmount(Index.GetItemClass(Byproduct.Item), static_cast<int32>(Byproduct.Rate * PlanNode.Rate)));
+	}
+
+	// PART 3: Create subfactories for the inputs entering the loop
+	for (const int32 Child : PlanNode.Children)
+	{
+		if (UFicsitPlannerFactory* Subfactory = Engine->CreateFactoryFromPlan(Plan, Child))
+		{
+			Subfactories.Add(Subfactory);
+		}
+	}
+}
+
+void UFicsitPlannerFactoryLoop::ScaleMetrics(const float Factor)
+{
+	Super::ScaleMetrics(Factor);
+
+	// Loops count every recipe they run
+	Complexity = 0;
+	for (float& LoopMultiplier : LoopMultipliers)
+	{
+		LoopMultiplier *= Factor;
+		Complexity += RECIPE_COMPLEXITY + (BUILDING_COMPLEXITY * static_cast<int>(ceil(LoopMultiplier)));
+	}
+}
+
+void UFicsitPlannerFactoryLoop::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(LoopRecipes.GetAllocatedSize() + LoopMultipliers.GetAllocatedSize());
+}
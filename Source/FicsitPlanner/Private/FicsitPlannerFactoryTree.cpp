@@ -0,0 +1,139 @@
+#include "FicsitPlannerFactoryTree.h"
+
+#include "Algo/BinarySearch.h"
+#include "Algo/Sort.h"
+
+void FFicsitPlannerFactoryTree::Build(UFicsitPlannerFactory* Root)
+{
+	BuiltRoot = Root;
+	Nodes.Reset();
+	Parents.Reset();
+	Depths.Reset();
+	SubtreeSizes.Reset();
+	NumChildren.Reset();
+	DepthNodes.Reset();
+	if (!Root) return;
+
+	// Depth-first, same numbering as FactoryPlanToString (groups stand for their selected factory's inputs)
+	struct FEntry
+	{
+		UFicsitPlannerFactory* Factory;
+		int32 Parent;
+		int32 Depth;
+	};
+	TArray<FEntry> FactoryDeque;
+	FactoryDeque.Add({Root, INDEX_NONE, 0});
+	while (FactoryDeque.Num() > 0)
+	{
+		const FEntry Entry = FactoryDeque.Pop();
+		const int32 Node = Nodes.Add(Entry.Factory);
+		Parents.Add(Entry.Parent);
+		Depths.Add(Entry.Depth);
+		NumChildren.Add(0);
+		if (DepthNodes.Num() <= Entry.Depth) DepthNodes.SetNum(Entry.Depth + 1);
+		DepthNodes[Entry.Depth].Add(Node);
+
+		if (TArray<UFicsitPlannerFactory*>* Subfactories = Entry.Factory->GetSubfactories())
+		{
+			for (UFicsitPlannerFactory* Subfactory : *Subfactories)
+			{
+				if (!Subfactory) continue;
+				FactoryDeque.Add({Subfactory, Node, Entry.Depth + 1});
+				NumChildren[Node]++;
+			}
+		}
+	}
+
+	// Subtree sizes, children first (parents always come before their children in preorder)
+	SubtreeSizes.Init(1, Nodes.Num());
+	for (int32 Node = Nodes.Num() - 1; Node > 0; --Node) SubtreeSizes[Parents[Node]] += SubtreeSizes[Node];
+
+	SetExpansion({}, 0);
+}
+
+void FFicsitPlannerFactoryTree::SetExpansion(const TSet<int32>& ExpandedNodeIDs, const int32 InMaxDepth)
+{
+	MaxDepth = FMath::Max(InMaxDepth, 0);
+	Expanded.Reset();
+	ExtraRows.Reset();
+	FrontierNodes.Reset();
+	FrontierRows.Reset();
+	for (const int32 NodeID : ExpandedNodeIDs)
+	{
+		if (NodeID >= 1 && NodeID <= Nodes.Num()) Expanded.Add(NodeID - 1);
+	}
+
+	// Rows added by expanded nodes at or past MaxDepth, deepest first (their inputs only add more if they're expanded too)
+	TArray<int32> DeepNodes;
+	for (const int32 Node : Expanded)
+	{
+		if (Depths[Node] >= MaxDepth) DeepNodes.Add(Node);
+	}
+	Algo::SortBy(DeepNodes, [&](const int32 Node) { return Depths[Node]; }, TGreater<>());
+	for (const int32 Node : DeepNodes)
+	{
+		int32 Rows = NumChildren[Node];
+		for (int32 Child = Node + 1; Child < Node + SubtreeSizes[Node]; Child += SubtreeSizes[Child]) Rows += ExtraRows.FindRef(Child);
+		ExtraRows.Add(Node, Rows);
+		if (Depths[Node] == MaxDepth) FrontierNodes.Add(Node);
+	}
+
+	FrontierNodes.Sort();
+	FrontierRows.Add(0);
+	for (const int32 Node : FrontierNodes) FrontierRows.Add(FrontierRows.Last() + ExtraRows[Node]);
+}
+
+void FFicsitPlannerFactoryTree::GetVisibleRows(const int32 FirstRow, const int32 NumRows, TArray<int32>& OutNodes) const
+{
+	OutNodes.Reset();
+	if (FirstRow < 0 || NumRows <= 0 || FirstRow >= NumVisibleRows()) return;
+
+	// PART 1: Seek the first row, descending into the input whose rows contain it
+	int32 Node = 0;
+	int32 Row = 0;
+	while (Row < FirstRow)
+	{
+		int32 Child = Node + 1;
+		Row++;
+		for (int32 ChildRows = CountVisible(Child); FirstRow >= Row + ChildRows; ChildRows = CountVisible(Child))
+		{
+			Row += ChildRows;
+			Child += SubtreeSizes[Child];
+		}
+		Node = Child;
+	}
+
+	// PART 2: Next visible nodes in preorder (the next node past a collapsed subtree is always visible, its parent is expanded)
+	OutNodes.Reserve(NumRows);
+	while (OutNodes.Num() < NumRows && Node < Nodes.Num())
+	{
+		OutNodes.Add(Node);
+		Node += IsExpanded(Node) ? 1 : SubtreeSizes[Node];
+	}
+}
+
+SIZE_T FFicsitPlannerFactoryTree::GetAllocatedSize() const
+{
+	SIZE_T Size = Nodes.GetAllocatedSize() + Parents.GetAllocatedSize() + Depths.GetAllocatedSize() + SubtreeSizes.GetAllocatedSize() + NumChildren.GetAllocatedSize()
+		+ DepthNodes.GetAllocatedSize() + Expanded.GetAllocatedSize() + ExtraRows.GetAllocatedSize() + FrontierNodes.GetAllocatedSize() + FrontierRows.GetAllocatedSize();
+	for (const TArray<int32>& Depth : DepthNodes) Size += Depth.GetAllocatedSize();
+	return Size;
+}
+
+int32 FFicsitPlannerFactoryTree::CountVisible(const int32 Node) const
+{
+	if (!IsExpanded(Node)) return 1;
+	if (Depths[Node] >= MaxDepth) return 1 + ExtraRows.FindRef(Node);
+
+	// Every node of the subtree down to MaxDepth, plus the rows added by expanded nodes at MaxDepth
+	const int32 End = Node + SubtreeSizes[Node];
+	int32 Rows = 0;
+	for (int32 Depth = Depths[Node]; Depth <= MaxDepth && Depth < DepthNodes.Num(); ++Depth) Rows += CountAtDepth(Depth, Node, End);
+	Rows += FrontierRows[Algo::LowerBound(FrontierNodes, End)] - FrontierRows[Algo::LowerBound(FrontierNodes, Node)];
+	return Rows;
+}
+
+int32 FFicsitPlannerFactoryTree::CountAtDepth(const int32 Depth, const int32 First, const int32 End) const
+{
+	return Algo::LowerBound(DepthNodes[Depth], End) - Algo::LowerBound(DepthNodes[Depth], First);
+}
@@ -0,0 +1,152 @@
+#include "FicsitPlannerJobQueue.h"
+
+#include "Algo/BinarySearch.h"
+#include "Async/Async.h"
+
+int32 FFicsitPlannerJobQueue::Enqueue(const FFicsitPlannerJobRequest& Request, const FFicsitPlannerRecipeDatasetRef& Dataset, const int32 Priority, FFicsitPlannerJobCallback&& OnCompleted)
+{
+	// Identical running job: wait on it
+	for (FRunningJob& RunningJob : Running)
+	{
+		if (RunningJob.Job->Request == Request && RunningJob.Job->Dataset == Dataset)
+		{
+			RunningJob.Job->Callbacks.Add(MoveTemp(OnCompleted));
+			return RunningJob.Job->JobID;
+		}
+	}
+
+	// Identical queued job: wait on it, moving it up if this request has a higher priority
+	for (int32 i = 0; i < Queued.Num(); ++i)
+	{
+		if (Queued[i]->Request == Request && Queued[i]->Dataset == Dataset)
+		{
+			const int32 JobID = Queued[i]->JobID;
+			Queued[i]->Callbacks.Add(MoveTemp(OnCompleted));
+			if (Priority > Queued[i]->Priority)
+			{
+				TUniquePtr<FFicsitPlannerJob> Job = MoveTemp(Queued[i]);
+				Queued.RemoveAt(i);
+				Job->Priority = Priority;
+				InsertQueued(MoveTemp(Job));
+			}
+			return JobID;
+		}
+	}
+
+	// New job
+	TUniquePtr<FFicsitPlannerJob> Job = MakeUnique<FFicsitPlannerJob>();
+	Job->JobID = NextJobID++;
+	Job->Request = Request;
+	Job->Priority = Priority;
+	Job->Sequence = NextSequence++;
+	Job->Dataset = Dataset;
+	Job->Callbacks.Add(MoveTemp(OnCompleted));
+
+	const int32 JobID = Job->JobID;
+	InsertQueued(MoveTemp(Job));
+	return JobID;
+}
+
+int32 FFicsitPlannerJobQueue::GetPosition(const int32 JobID) const
+{
+	for (const FRunningJob& RunningJob : Running)
+	{
+		if (RunningJob.Job->JobID == JobID) return 0;
+	}
+
+	const int32 Position = Queued.IndexOfByPredicate([&](const TUniquePtr<FFicsitPlannerJob>& Job) { return Job->JobID == JobID; });
+	return Position != INDEX_NONE ? Position + 1 : INDEX_NONE;
+}
+
+int32 FFicsitPlannerJobQueue::StartJobs(const int32 MaxRunning, const int32 MaxFullNodes, const int32 MaxNodes)
+{
+	while (Queued.Num() > 0 && Running.Num() < FMath::Max(MaxRunning, 1))
+	{
+		// Plan on the core (no UObjects, and the job holds its recipe data, so it's safe off the game thread during reloads)
+		FRunningJob& RunningJob = Running.AddDefaulted_GetRef();
+		RunningJob.Job = MoveTemp(Queued[0]);
+		Queued.RemoveAt(0);
+
+		FFicsitPlannerJob* Job = RunningJob.Job.Get();
+		RunningJob.Task = Async(EAsyncExecution::ThreadPool, [Job, MaxFullNodes, MaxNodes]()
+		{
+			const FFicsitPlannerRecipeIndex& Index = Job->Dataset->Index;
+			const FFicsitPlannerCore Core(Index);
+			const FFicsitPlannerJobRequest& Request = Job->Request;
+
+			// Count the plan first (same strategy as AFicsitPlannerEngine::CreateFactoryPlan), refusing what's too large or unconfirmed
+			const FFicsitPlannerPlanEstimate Estimate = Core.EstimatePlan(Request.Item, Request.bAllowLockedRecipes);
+			Job->Strategy = Core.ChooseStrategy(Estimate, Request.Item, Request.bAllowLockedRecipes, Request.Optimization, MaxFullNodes, MaxNodes);
+			if (Job->Strategy == EFactoryPlanStrategy::EFPS_TooLarge) return;
+			if (FFicsitPlannerCore::NeedsConfirmation(Job->Strategy) && !Request.bConfirmLargePlan) return;
+
+			// OPTION 1: Unit cost table
+			if (Job->Strategy == EFactoryPlanStrategy::EFPS_Optimal)
+			{
+				Job->bPlanned = Core.CreateOptimalPlan(Request.Item, Request.Rate, Request.bAllowLockedRecipes, Request.Optimization, Job->Plan);
+				return;
+			}
+
+			// OPTION 2: Every alternative (sharing identical sub-plans if memoized)
+			TUniquePtr<FFicsitPlannerPlanCache> Cache;
+			if (Job->Strategy == EFactoryPlanStrategy::EFPS_Memoized) Cache = MakeUnique<FFicsitPlannerPlanCache>(Index, Request.bAllowLockedRecipes);
+			Job->bPlanned = Core.CreatePlan(Request.Item, Request.Rate, Request.bAllowLockedRecipes, Request.Optimization, Job->Plan, Cache.Get());
+		});
+	}
+	return Running.Num();
+}
+
+TUniquePtr<FFicsitPlannerJob> FFicsitPlannerJobQueue::TakeFinishedJob()
+{
+	for (int32 i = 0; i < Running.Num(); ++i)
+	{
+		if (Running[i].Task.IsReady())
+		{
+			TUniquePtr<FFicsitPlannerJob> Job = MoveTemp(Running[i].Job);
+			Running.RemoveAt(i);
+			return Job;
+		}
+	}
+	return nullptr;
+}
+
+void FFicsitPlannerJobQueue::Wait()
+{
+	for (FRunningJob& RunningJob : Running)
+	{
+		RunningJob.Task.Wait();
+	}
+}
+
+FString FFicsitPlannerJobQueue::ToString() const
+{
+	FString QueueString = FString::Printf(TEXT("Planner jobs: %d running, %d queued\n"), Running.Num(), Queued.Num());
+
+	const auto JobToString = [&](const FFicsitPlannerJob& Job, const int32 Position)
+	{
+		const FFicsitPlannerJobRequest& Request = Job.Request;
+		const FFicsitPlannerRecipeIndex& Index = Job.Dataset->Index;
+		const FString Target = Request.Type == EFicsitPlannerJobType::Create ?
+			FString::Printf(TEXT("create %.2fx %s"), Request.Rate, Index.NumItems() > Request.Item ? *Index.GetItem(Request.Item).Name : TEXT("?")) :
+			FString::Printf(TEXT("optimize factory %d"), Request.FactoryID);
+		return FString::Printf(TEXT("- Job %d (%s): %s, priority %d, %d waiting\n"),
+			Job.JobID, Position == 0 ? TEXT("running") : *FString::Printf(TEXT("#%d"), Position), *Target, Job.Priority, Job.Callbacks.Num());
+	};
+
+	for (const FRunningJob& RunningJob : Running) QueueString += JobToString(*RunningJob.Job, 0);
+	for (int32 i = 0; i < Queued.Num(); ++i) QueueString += JobToString(*Queued[i], i + 1);
+	return QueueString;
+}
+
+bool FFicsitPlannerJobQueue::RunsBefore(const FFicsitPlannerJob& A, const FFicsitPlannerJob& B)
+{
+	return A.Priority != B.Priority ? A.Priority > B.Priority : A.Sequence < B.Sequence;
+}
+
+void FFicsitPlannerJobQueue::InsertQueued(TUniquePtr<FFicsitPlannerJob>&& Job)
+{
+	// Kept sorted, so positions are indices (queues stay short, so the shift is cheap)
+	const int32 Position = Algo::UpperBoundBy(Queued, Job.Get(), [](const TUniquePtr<FFicsitPlannerJob>& Queued) { return Queued.Get(); },
+		[](const FFicsitPlannerJob* A, const FFicsitPlannerJob* B) { return RunsBefore(*A, *B); });
+	Queued.Insert(MoveTemp(Job), Position);
+}
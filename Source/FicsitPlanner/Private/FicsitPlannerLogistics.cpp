@@ -0,0 +1,87 @@
+#include "FicsitPlannerLogistics.h"
+
+const FFicsitPlannerTransportTier FFicsitPlannerLogistics::BeltTiers[NUM_BELT_TIERS] = {
+	{TEXT("Belt Mk1"), 60.0f, TEXT("Recipe_ConveyorBeltMk1_C")},
+	{TEXT("Belt Mk2"), 120.0f, TEXT("Recipe_ConveyorBeltMk2_C")},
+	{TEXT("Belt Mk3"), 270.0f, TEXT("Recipe_ConveyorBeltMk3_C")},
+	{TEXT("Belt Mk4"), 480.0f, TEXT("Recipe_ConveyorBeltMk4_C")},
+	{TEXT("Belt Mk5"), 780.0f, TEXT("Recipe_ConveyorBeltMk5_C")},
+	{TEXT("Belt Mk6"), 1200.0f, TEXT("Recipe_ConveyorBeltMk6_C")},
+};
+
+// Fluid amounts are in liters (1000 per m3), so 300 & 600 m3 / min
+const FFicsitPlannerTransportTier FFicsitPlannerLogistics::PipeTiers[NUM_PIPE_TIERS] = {
+	{TEXT("Pipe Mk1"), 300000.0f, TEXT("Recipe_Pipeline_C")},
+	{TEXT("Pipe Mk2"), 600000.0f, TEXT("Recipe_PipelineMK2_C")},
+};
+
+void FFicsitPlannerLogistics::SetUnlockedRecipes(const TArray<TSubclassOf<UFGRecipe>>& UnlockedRecipes)
+{
+	TSet<FString> RecipeNames;
+	for (const TSubclassOf<UFGRecipe>& Recipe : UnlockedRecipes)
+	{
+		if (Recipe) RecipeNames.Add(Recipe->GetName());
+	}
+
+	// Tiers unlock in order, so the best unlocked one decides
+	const auto CountTiers = [&](const FFicsitPlannerTransportTier* Tiers, const int32 NumTiers)
+	{
+		for (int32 Tier = NumTiers; Tier > 0; --Tier)
+		{
+			if (RecipeNames.Contains(Tiers[Tier - 1].RecipeName)) return Tier;
+		}
+		return 0;
+	};
+	SetUnlockedTiers(CountTiers(BeltTiers, NUM_BELT_TIERS), CountTiers(PipeTiers, NUM_PIPE_TIERS));
+}
+
+void FFicsitPlannerLogistics::SetUnlockedTiers(const int32 InNumBeltTiers, const int32 InNumPipeTiers)
+{
+	NumBeltTiers = FMath::Clamp(InNumBeltTiers, 0, NUM_BELT_TIERS);
+	NumPipeTiers = FMath::Clamp(InNumPipeTiers, 0, NUM_PIPE_TIERS);
+}
+
+FFicsitPlannerTransport FFicsitPlannerLogistics::Size(const float Rate, const bool bFluid) const
+{
+	const FFicsitPlannerTransportTier* Tiers = bFluid ? PipeTiers : BeltTiers;
+	const int32 NumTiers = bFluid ? NumPipeTiers : NumBeltTiers;
+
+	FFicsitPlannerTransport Transport;
+	Transport.bFluid = bFluid;
+	if (Rate <= 0.0f) return Transport;
+	if (NumTiers == 0)
+	{
+		Transport.bOverCapacity = true;
+		return Transport;
+	}
+
+	// Cheapest tier carrying the rate on one line
+	for (int32 Tier = 0; Tier < NumTiers; ++Tier)
+	{
+		if (Rate <= Tiers[Tier].Capacity)
+		{
+			Transport.Tier = Tier;
+			Transport.Lines = 1;
+			return Transport;
+		}
+	}
+
+	// Otherwise parallel lines of the best tier
+	Transport.Tier = NumTiers - 1;
+	Transport.Lines = FMath::CeilToInt(Rate / Tiers[Transport.Tier].Capacity);
+	Transport.bOverCapacity = true;
+	return Transport;
+}
+
+FString FFicsitPlannerLogistics::TransportToString(const FFicsitPlannerTransport& Transport)
+{
+	if (Transport.Tier == INDEX_NONE)
+	{
+		if (!Transport.bOverCapacity) return FString();
+		return Transport.bFluid ? TEXT("No pipes unlocked") : TEXT("No belts unlocked");
+	}
+
+	const TCHAR* TierName = (Transport.bFluid ? PipeTiers : BeltTiers)[Transport.Tier].Name;
+	if (Transport.Lines <= 1) return TierName;
+	return FString::Printf(TEXT("%dx %s (over capacity)"), Transport.Lines, TierName);
+}
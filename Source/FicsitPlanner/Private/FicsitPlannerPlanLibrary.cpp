@@ -0,0 +1,270 @@
+#include "FicsitPlannerPlanLibrary.h"
+
+int32 FFicsitPlannerPlanLibrary::Save(const int32 Item, const float Rate, const bool bAllowLockedRecipes, const EFactoryOptimizationType Optimization)
+{
+	if (Rate <= 0.0f) return INDEX_NONE;
+
+	// PART 1: Explored plan (shared)
+	FFicsitPlannerSharedPlan SharedPlan;
+	SharedPlan.Explored = Explore(Item, bAllowLockedRecipes);
+	if (!SharedPlan.Explored) return INDEX_NONE;
+	SharedPlan.Rate = Rate;
+	SharedPlan.Choices.Init(0, SharedPlan.Explored->NumGroups);
+
+	// PART 2: Choices (selected at the plan's rate, complexity counts whole buildings)
+	if (Optimization != EFactoryOptimizationType::EFOT_None)
+	{
+		FFicsitPlannerPlan Plan;
+		const FFicsitPlannerCore Core(SharedPlan.Explored->Dataset->Index);
+		Core.ScalePlan(SharedPlan.Explored->Plan, Rate, Plan);
+		Core.OptimizePlan(Plan, Optimization);
+		if (!ReadChoices(Plan, SharedPlan)) return INDEX_NONE;
+	}
+
+	const int32 PlanID = NextPlanID++;
+	Plans.Add(PlanID, MoveTemp(SharedPlan));
+	return PlanID;
+}
+
+int32 FFicsitPlannerPlanLibrary::Clone(const int32 PlanID)
+{
+	const FFicsitPlannerSharedPlan* SharedPlan = Plans.Find(PlanID);
+	if (!SharedPlan) return INDEX_NONE;
+
+	// Shares the explored plan, copies the choices
+	const int32 CloneID = NextPlanID++;
+	Plans.Add(CloneID, FFicsitPlannerSharedPlan(*SharedPlan));
+	return CloneID;
+}
+
+int32 FFicsitPlannerPlanLibrary::SaveTop(const int32 Item, const float Rate, const bool bAllowLockedRecipes, const EFactoryOptimizationType Optimization, const int32 K, TArray<int32>& OutPlanIDs, TArray<FFicsitPlannerRankedPlan>& OutRankedPlans)
+{
+	OutPlanIDs.Reset();
+	OutRankedPlans.Reset();
+	if (Rate <= 0.0f) return 0;
+
+	const TSharedPtr<const FFicsitPlannerExploredPlan> Explored = Explore(Item, bAllowLockedRecipes);
+	if (!Explored) return 0;
+
+	// Rank at the plan's rate (groups a selection doesn't reach keep their best alternative)
+	FFicsitPlannerPlan Plan;
+	const FFicsitPlannerCore Core(Explored->Dataset->Index);
+	Core.ScalePlan(Explored->Plan, Rate, Plan);
+	Core.OptimizePlan(Plan, Optimization);
+	Core.FindTopPlans(Plan, Optimization, K, OutRankedPlans);
+
+	FFicsitPlannerSharedPlan BestPlan;
+	BestPlan.Explored = Explored;
+	BestPlan.Rate = Rate;
+	BestPlan.Choices.Init(0, Explored->NumGroups);
+	if (!ReadChoices(Plan, BestPlan))
+	{
+		OutRankedPlans.Reset();
+		return 0;
+	}
+
+	for (const FFicsitPlannerRankedPlan& RankedPlan : OutRankedPlans)
+	{
+		// Best choices, overridden by the ranked plan's selections (choices are bytes, see Explore)
+		FFicsitPlannerSharedPlan SharedPlan(BestPlan);
+		for (const TPair<int32, int32>& Selection : RankedPlan.Selections)
+		{
+			const int32 Group = Explored->NodeGroups[Selection.Key];
+			if (Group != INDEX_NONE && Selection.Value >= 0 && Selection.Value <= MAX_uint8) SharedPlan.Choices[Group] = static_cast<uint8>(Selection.Value);
+		}
+
+		const int32 PlanID = NextPlanID++;
+		Plans.Add(PlanID, MoveTemp(SharedPlan));
+		OutPlanIDs.Add(PlanID);
+	}
+	return OutPlanIDs.Num();
+}
+
+void FFicsitPlannerPlanLibrary::SetDataset(const FFicsitPlannerRecipeDatasetRef& InDataset)
+{
+	// Explored plans of the previous version can't be shared with new plans anymore
+	Dataset = InDataset;
+	ExploredPlans.Empty();
+}
+
+bool FFicsitPlannerPlanLibrary::Remove(const int32 PlanID)
+{
+	// The explored plan goes with its last saved plan
+	return Plans.Remove(PlanID) > 0;
+}
+
+bool FFicsitPlannerPlanLibrary::Select(const int32 PlanID, const int32 NodeID, const int32 Alternative)
+{
+	FFicsitPlannerSharedPlan* SharedPlan = Plans.Find(PlanID);
+	if (!SharedPlan) return false;
+
+	const int32 Group = FindGroup(*SharedPlan, NodeID);
+	if (Group == INDEX_NONE) return false;
+
+	// Check the alternative against the group's node
+	const FFicsitPlannerExploredPlan& Explored = *SharedPlan->Explored;
+	const int32 GroupNode = Explored.NodeGroups.IndexOfByKey(Group);
+	if (!Explored.Plan.Nodes[GroupNode].Alternatives.IsValidIndex(Alternative) || Alternative > MAX_uint8) return false;
+
+	SharedPlan->Choices[Group] = static_cast<uint8>(Alternative);
+	return true;
+}
+
+bool FFicsitPlannerPlanLibrary::SetRate(const int32 PlanID, const float Rate)
+{
+	FFicsitPlannerSharedPlan* SharedPlan = Plans.Find(PlanID);
+	if (!SharedPlan || Rate <= 0.0f) return false;
+
+	// Everything else is linear in the rate, and computed when the plan is read
+	SharedPlan->Rate = Rate;
+	return true;
+}
+
+bool FFicsitPlannerPlanLibrary::Instantiate(const int32 PlanID, FFicsitPlannerPlan& OutPlan) const
+{
+	const FFicsitPlannerSharedPlan* SharedPlan = Plans.Find(PlanID);
+	if (!SharedPlan) return false;
+
+	const FFicsitPlannerCore Core(SharedPlan->Explored->Dataset->Index);
+	Core.ScalePlan(SharedPlan->Explored->Plan, SharedPlan->Rate, OutPlan);
+	ApplyChoices(*SharedPlan, OutPlan);
+
+	// Totals follow the choices (no reselection)
+	Core.OptimizePlan(OutPlan, EFactoryOptimizationType::EFOT_None);
+	return true;
+}
+
+SIZE_T FFicsitPlannerPlanLibrary::GetAllocatedSize(int32& OutExploredPlans) const
+{
+	SIZE_T Size = ExploredPlans.GetAllocatedSize() + Plans.GetAllocatedSize();
+	TSet<const FFicsitPlannerExploredPlan*> Counted;
+	for (const TPair<int32, FFicsitPlannerSharedPlan>& Pair : Plans)
+	{
+		Size += Pair.Value.Choices.GetAllocatedSize();
+
+		bool bAlreadyCounted = false;
+		const FFicsitPlannerExploredPlan* Explored = Pair.Value.Explored.Get();
+		Counted.Add(Explored, &bAlreadyCounted);
+		if (bAlreadyCounted) continue;
+
+		Size += sizeof(FFicsitPlannerExploredPlan) + Explored->Plan.Nodes.GetAllocatedSize() + Explored->NodeGroups.GetAllocatedSize();
+		for (const FFicsitPlannerPlanNode& Node : Explored->Plan.Nodes)
+		{
+			Size += Node.Children.GetAllocatedSize() + Node.Alternatives.GetAllocatedSize();
+		}
+	}
+	OutExploredPlans = Counted.Num();
+	return Size;
+}
+
+FString FFicsitPlannerPlanLibrary::ToString() const
+{
+	TArray<int32> PlanIDs;
+	GetPlanIDs(PlanIDs);
+	PlanIDs.Sort();
+
+	FString LibraryString = FString::Printf(TEXT("%d shared plans:\n"), PlanIDs.Num());
+	for (const int32 PlanID : PlanIDs)
+	{
+		const FFicsitPlannerSharedPlan& SharedPlan = Plans[PlanID];
+		const FFicsitPlannerPlanNode& Root = SharedPlan.Explored->Plan.Nodes[0];
+		const FFicsitPlannerRecipeIndex& Index = SharedPlan.Explored->Dataset->Index;
+		LibraryString += FString::Printf(TEXT("%d: %.2fx %s / min (%d choices, explored plan shared by %d)\n"), PlanID, SharedPlan.Rate,
+			*Index.GetItem(Root.Item).Name, SharedPlan.Choices.Num(), SharedPlan.Explored.GetSharedReferenceCount());
+	}
+	return LibraryString;
+}
+
+TSharedPtr<const FFicsitPlannerExploredPlan> FFicsitPlannerPlanLibrary::Explore(const int32 Item, const bool bAllowLockedRecipes)
+{
+	// Reuse the explored plan while any saved plan holds it
+	const TPair<int32, bool> Key(Item, bAllowLockedRecipes);
+	if (const TWeakPtr<const FFicsitPlannerExploredPlan>* Existing = ExploredPlans.Find(Key))
+	{
+		if (TSharedPtr<const FFicsitPlannerExploredPlan> Explored = Existing->Pin()) return Explored;
+	}
+
+	// Count the plan first, so huge items are refused before anything is expanded
+	const FFicsitPlannerCore Core(Dataset->Index);
+	if (MaxNodes > 0)
+	{
+		const FFicsitPlannerPlanEstimate Estimate = Core.EstimatePlan(Item, bAllowLockedRecipes);
+		if (!Estimate.bComplete || Estimate.Nodes > MaxNodes)
+		{
+			UE_LOG(LogFicsitPlannerCore, Error, TEXT("Shared plan for %s is too large to explore (%s%.0f nodes, limit %d)!"),
+				*Dataset->Index.GetItem(Item).Name, Estimate.bComplete ? TEXT("") : TEXT("over "), Estimate.Nodes, MaxNodes);
+			return nullptr;
+		}
+	}
+
+	// Every alternative, for 1 / min
+	TSharedPtr<FFicsitPlannerExploredPlan> Explored = MakeShared<FFicsitPlannerExploredPlan>();
+	Explored->Dataset = Dataset;
+	if (!Core.CreatePlan(Item, 1.0f, bAllowLockedRecipes, EFactoryOptimizationType::EFOT_None, Explored->Plan)) return nullptr;
+
+	// Number the groups in node order (choices are bytes, so groups can't have more alternatives than that)
+	Explored->NodeGroups.Init(INDEX_NONE, Explored->Plan.Nodes.Num());
+	for (int32 Node = 0; Node < Explored->Plan.Nodes.Num(); ++Node)
+	{
+		const FFicsitPlannerPlanNode& PlanNode = Explored->Plan.Nodes[Node];
+		if (!PlanNode.IsGroup()) continue;
+		if (PlanNode.Alternatives.Num() > MAX_uint8 + 1)
+		{
+			UE_LOG(LogFicsitPlannerCore, Error, TEXT("Shared plan for %s has a group with %d alternatives (at most %d)!"),
+				*Dataset->Index.GetItem(Item).Name, PlanNode.Alternatives.Num(), MAX_uint8 + 1);
+			return nullptr;
+		}
+		Explored->NodeGroups[Node] = Explored->NumGroups++;
+	}
+
+	ExploredPlans.Add(Key, Explored);
+	return Explored;
+}
+
+bool FFicsitPlannerPlanLibrary::ReadChoices(const FFicsitPlannerPlan& Plan, FFicsitPlannerSharedPlan& SharedPlan)
+{
+	const TArray<int32>& NodeGroups = SharedPlan.Explored->NodeGroups;
+	for (int32 Node = 0; Node < Plan.Nodes.Num(); ++Node)
+	{
+		if (NodeGroups[Node] == INDEX_NONE) continue;
+
+		// Same check as Select (a selection that doesn't fit in a byte would wrap)
+		const int32 Selected = Plan.Nodes[Node].Selected;
+		if (Selected < 0 || Selected > MAX_uint8) return false;
+		SharedPlan.Choices[NodeGroups[Node]] = static_cast<uint8>(Selected);
+	}
+	return true;
+}
+
+void FFicsitPlannerPlanLibrary::ApplyChoices(const FFicsitPlannerSharedPlan& SharedPlan, FFicsitPlannerPlan& Plan)
+{
+	const TArray<int32>& NodeGroups = SharedPlan.Explored->NodeGroups;
+	for (int32 Node = 0; Node < Plan.Nodes.Num(); ++Node)
+	{
+		if (NodeGroups[Node] != INDEX_NONE) Plan.Nodes[Node].Selected = SharedPlan.Choices[NodeGroups[Node]];
+	}
+}
+
+int32 FFicsitPlannerPlanLibrary::FindGroup(const FFicsitPlannerSharedPlan& SharedPlan, const int32 NodeID)
+{
+	const FFicsitPlannerExploredPlan& Explored = *SharedPlan.Explored;
+
+	// Depth-first, following the choices (same numbering as FFicsitPlannerCore::PlanToString)
+	TArray<int32> NodeStack;
+	NodeStack.Add(0);
+	int32 CurrentNodeIndex = 1;
+	while (NodeStack.Num() > 0)
+	{
+		const int32 GroupNode = NodeStack.Pop();
+		const FFicsitPlannerPlanNode& Node = Explored.Plan.Nodes[GroupNode];
+		if (Node.IsInput()) continue;
+
+		const int32 Group = Explored.NodeGroups[GroupNode];
+		if (CurrentNodeIndex == NodeID) return Group;
+
+		const FFicsitPlannerPlanNode& Selected = Group != INDEX_NONE ? Explored.Plan.Nodes[Node.Alternatives[SharedPlan.Choices[Group]]] : Node;
+		NodeStack.Append(Selected.Children);
+		CurrentNodeIndex++;
+	}
+	return INDEX_NONE;
+}
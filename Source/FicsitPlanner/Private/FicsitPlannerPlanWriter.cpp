@@ -0,0 +1,235 @@
+#include "FicsitPlannerPlanWriter.h"
+
+#include "FicsitPlannerCore.h"
+#include "FicsitPlannerRecipeIndex.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+
+namespace FicsitPlannerPlanWriter
+{
+	/**
+	 * JSON writer: { "version": 1, "plans": [ { "item", "rate", "power", "complexity", "root": { ..., "inputs": [ ... ] } } ] }
+	 */
+	class FJsonPlanWriter : public IFicsitPlannerPlanWriter
+	{
+	public:
+		explicit FJsonPlanWriter(FArchive& Archive)
+			: Writer(TJsonWriterFactory<UTF8CHAR, TCondensedJsonPrintPolicy<UTF8CHAR>>::Create(&Archive))
+		{
+		}
+
+		virtual void BeginDocument(const bool bBillsOfMaterials) override
+		{
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("version"), 1);
+			Writer->WriteArrayStart(bBillsOfMaterials ? TEXT("bills") : TEXT("plans"));
+		}
+
+		virtual void EndDocument() override
+		{
+			Writer->WriteArrayEnd();
+			Writer->WriteObjectEnd();
+			Writer->Close();
+		}
+
+		virtual void BeginPlan(const FFicsitPlannerPlanHeader& Header) override
+		{
+			Writer->WriteObjectStart();
+			WriteHeader(Header);
+			NodeDepth = 0;
+		}
+
+		virtual void BeginNode(const FFicsitPlannerPlanRow& Row) override
+		{
+			// The root is a field of the plan, other nodes go in their parent's inputs
+			if (NodeDepth++ == 0) Writer->WriteObjectStart(TEXT("root"));
+			else Writer->WriteObjectStart();
+
+			Writer->WriteValue(TEXT("id"), Row.NodeId);
+			Writer->WriteValue(TEXT("item"), Row.Item);
+			Writer->WriteValue(TEXT("rate"), Row.Rate);
+			Writer->WriteValue(TEXT("recipe"), Row.Recipe);
+			Writer->WriteValue(TEXT("multiplier"), Row.Multiplier);
+			Writer->WriteValue(TEXT("power"), Row.Power);
+			Writer->WriteValue(TEXT("complexity"), Row.Complexity);
+			Writer->WriteValue(TEXT("transport"), Row.Transport);
+			Writer->WriteValue(TEXT("lines"), Row.Lines);
+			Writer->WriteValue(TEXT("overCapacity"), Row.bOverCapacity);
+			if (Row.NumOptions > 0)
+			{
+				Writer->WriteValue(TEXT("option"), Row.Option);
+				Writer->WriteValue(TEXT("options"), Row.NumOptions);
+			}
+			if (Row.LoopRecipes.Num() > 0)
+			{
+				Writer->WriteArrayStart(TEXT("loop"));
+				for (const TPair<FString, float>& LoopRecipe : Row.LoopRecipes)
+				{
+					Writer->WriteObjectStart();
+					Writer->WriteValue(TEXT("recipe"), LoopRecipe.Key);
+					Writer->WriteValue(TEXT("multiplier"), LoopRecipe.Value);
+					Writer->WriteObjectEnd();
+				}
+				Writer->WriteArrayEnd();
+			}
+			Writer->WriteArrayStart(TEXT("inputs"));
+		}
+
+		virtual void EndNode() override
+		{
+			Writer->WriteArrayEnd();
+			Writer->WriteObjectEnd();
+			NodeDepth--;
+		}
+
+		virtual void EndPlan() override
+		{
+			Writer->WriteObjectEnd();
+		}
+
+		virtual void WriteBill(const FFicsitPlannerPlanHeader& Header, const FFicsitPlannerBillOfMaterials& Bill, const FFicsitPlannerRecipeIndex& Index) override
+		{
+			Writer->WriteObjectStart();
+			WriteHeader(Header);
+
+			Writer->WriteArrayStart(TEXT("recipes"));
+			for (const FFicsitPlannerRecipeUse& Use : Bill.Recipes)
+			{
+				Writer->WriteObjectStart();
+				Writer->WriteValue(TEXT("recipe"), Index.GetRecipe(Use.Recipe).Name);
+				Writer->WriteValue(TEXT("multiplier"), Use.Multiplier);
+				Writer->WriteValue(TEXT("power"), Use.Power);
+				Writer->WriteObjectEnd();
+			}
+			Writer->WriteArrayEnd();
+
+			WriteRates(TEXT("inputs"), Bill.Inputs, Index);
+			WriteRates(TEXT("byproducts"), Bill.Byproducts, Index);
+			Writer->WriteObjectEnd();
+		}
+
+	private:
+		TSharedRef<TJsonWriter<UTF8CHAR, TCondensedJsonPrintPolicy<UTF8CHAR>>> Writer;
+		int32 NodeDepth = 0;
+
+		void WriteHeader(const FFicsitPlannerPlanHeader& Header)
+		{
+			Writer->WriteValue(TEXT("item"), Header.Item);
+			Writer->WriteValue(TEXT("rate"), Header.Rate);
+			Writer->WriteValue(TEXT("power"), Header.Power);
+			Writer->WriteValue(TEXT("complexity"), Header.Complexity);
+			Writer->WriteValue(TEXT("edgesOverCapacity"), Header.EdgesOverCapacity);
+		}
+
+		void WriteRates(const TCHAR* Field, const TArray<FFicsitPlannerItemRate>& Rates, const FFicsitPlannerRecipeIndex& Index)
+		{
+			Writer->WriteArrayStart(Field);
+			for (const FFicsitPlannerItemRate& Rate : Rates)
+			{
+				Writer->WriteObjectStart();
+				Writer->WriteValue(TEXT("item"), Index.GetItem(Rate.Item).Name);
+				Writer->WriteValue(TEXT("rate"), Rate.Rate);
+				Writer->WriteObjectEnd();
+			}
+			Writer->WriteArrayEnd();
+		}
+	};
+
+	/**
+	 * CSV writer: one row per node (or per bill entry), the plan column tells plans apart.
+	 */
+	class FCsvPlanWriter : public IFicsitPlannerPlanWriter
+	{
+	public:
+		explicit FCsvPlanWriter(FArchive& InArchive)
+			: Archive(InArchive)
+		{
+		}
+
+		virtual void BeginDocument(const bool bBillsOfMaterials) override
+		{
+			WriteLine(bBillsOfMaterials ?
+				TEXT("Plan,Type,Name,Rate,Multiplier,Power") :
+				TEXT("Plan,NodeID,ParentID,Depth,Item,Rate,Recipe,Multiplier,Power,Complexity,Option,Options,Loop,Transport,Lines,OverCapacity"));
+		}
+
+		virtual void EndDocument() override
+		{
+		}
+
+		virtual void BeginPlan(const FFicsitPlannerPlanHeader& Header) override
+		{
+			PlanName = Escape(Header.Item);
+		}
+
+		virtual void BeginNode(const FFicsitPlannerPlanRow& Row) override
+		{
+			FString Loop;
+			for (const TPair<FString, float>& LoopRecipe : Row.LoopRecipes)
+			{
+				if (!Loop.IsEmpty()) Loop += TEXT("; ");
+				Loop += FString::Printf(TEXT("%s x%.4f"), *LoopRecipe.Key, LoopRecipe.Value);
+			}
+
+			WriteLine(FString::Printf(TEXT("%s,%d,%d,%d,%s,%.4f,%s,%.4f,%.4f,%d,%d,%d,%s,%s,%d,%d"),
+				*PlanName, Row.NodeId, Row.ParentId, Row.Depth, *Escape(Row.Item), Row.Rate, *Escape(Row.Recipe),
+				Row.Multiplier, Row.Power, Row.Complexity, Row.Option, Row.NumOptions, *Escape(Loop),
+				*Escape(Row.Transport), Row.Lines, Row.bOverCapacity ? 1 : 0));
+		}
+
+		virtual void EndNode() override
+		{
+		}
+
+		virtual void EndPlan() override
+		{
+		}
+
+		virtual void WriteBill(const FFicsitPlannerPlanHeader& Header, const FFicsitPlannerBillOfMaterials& Bill, const FFicsitPlannerRecipeIndex& Index) override
+		{
+			const FString Plan = Escape(Header.Item);
+			for (const FFicsitPlannerRecipeUse& Use : Bill.Recipes)
+			{
+				WriteLine(FString::Printf(TEXT("%s,Recipe,%s,,%.4f,%.4f"), *Plan, *Escape(Index.GetRecipe(Use.Recipe).Name), Use.Multiplier, Use.Power));
+			}
+			for (const FFicsitPlannerItemRate& Input : Bill.Inputs)
+			{
+				WriteLine(FString::Printf(TEXT("%s,Input,%s,%.4f,,"), *Plan, *Escape(Index.GetItem(Input.Item).Name), Input.Rate));
+			}
+			for (const FFicsitPlannerItemRate& Byproduct : Bill.Byproducts)
+			{
+				WriteLine(FString::Printf(TEXT("%s,Byproduct,%s,%.4f,,"), *Plan, *Escape(Index.GetItem(Byproduct.Item).Name), Byproduct.Rate));
+			}
+		}
+
+	private:
+		FArchive& Archive;
+		FString PlanName;
+
+		void WriteLine(const FString& Line)
+		{
+			const FTCHARToUTF8 Utf8Line(*(Line + TEXT("\n")));
+			Archive.Serialize(const_cast<ANSICHAR*>(Utf8Line.Get()), Utf8Line.Length());
+		}
+
+		static FString Escape(const FString& Value)
+		{
+			// Quote fields containing separators, quotes or line breaks
+			if (!Value.Contains(TEXT(",")) && !Value.Contains(TEXT("\"")) && !Value.Contains(TEXT("\n"))) return Value;
+			return TEXT("\"") + Value.Replace(TEXT("\""), TEXT("\"\"")) + TEXT("\"");
+		}
+	};
+}
+
+TUniquePtr<IFicsitPlannerPlanWriter> IFicsitPlannerPlanWriter::Create(const EFactoryExportFormat Format, FArchive& Archive)
+{
+	using namespace FicsitPlannerPlanWriter;
+
+	if (Format == EFactoryExportFormat::EFEF_Csv) return MakeUnique<FCsvPlanWriter>(Archive);
+	return MakeUnique<FJsonPlanWriter>(Archive);
+}
+
+const TCHAR* IFicsitPlannerPlanWriter::GetFileExtension(const EFactoryExportFormat Format)
+{
+	return Format == EFactoryExportFormat::EFEF_Csv ? TEXT("csv") : TEXT("json");
+}
@@ -0,0 +1,35 @@
+#include "FicsitPlannerRecipeDataset.h"
+
+void FFicsitPlannerRecipeDataset::RegisterRecipes()
+{
+	AllItems.Empty();
+	UnlockedItems.Empty();
+	AllRecipesMap.Empty();
+	UnlockedRecipesMap.Empty();
+	for (int32 Recipe = 0; Recipe < Index.NumRecipes(); Recipe++)
+	{
+		if (Index.IsRecipeExcluded(Recipe)) continue;
+
+		// Add products to the item lists & recipe maps (unlocked ones too, if the recipe is unlocked)
+		const FFicsitPlannerRecipeData& RecipeData = Index.GetRecipe(Recipe);
+		const bool bUnlocked = Index.IsRecipeUnlocked(Recipe);
+		for (const FFicsitPlannerItemRate& Product : RecipeData.Products)
+		{
+			const TSubclassOf<UFGItemDescriptor> Item = Index.GetItemClass(Product.Item);
+			AllItems.AddUnique(Item);
+			AllRecipesMap.FindOrAdd(Item).AddUnique(RecipeData.Class);
+			if (!bUnlocked) continue;
+
+			UnlockedItems.AddUnique(Item);
+			UnlockedRecipesMap.FindOrAdd(Item).AddUnique(RecipeData.Class);
+		}
+	}
+}
+
+SIZE_T FFicsitPlannerRecipeDataset::GetRecipeMapsAllocatedSize() const
+{
+	SIZE_T Size = UnlockedItems.GetAllocatedSize() + AllItems.GetAllocatedSize() + UnlockedRecipesMap.GetAllocatedSize() + AllRecipesMap.GetAllocatedSize();
+	for (const auto& Pair : UnlockedRecipesMap) Size += Pair.Value.GetAllocatedSize();
+	for (const auto& Pair : AllRecipesMap) Size += Pair.Value.GetAllocatedSize();
+	return Size;
+}
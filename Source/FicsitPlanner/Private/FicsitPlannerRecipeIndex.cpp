@@ -0,0 +1,973 @@
+#include "FicsitPlannerRecipeIndex.h"
+
+#include "Algo/StableSort.h"
+#include "FicsitPlannerEngine.h"
+#include "FicsitPlannerRecipeSource.h"
+#include "Misc/ScopeLock.h"
+
+int32 FFicsitPlannerRecipeTables::AddItem(FFicsitPlannerItemData&& Item)
+{
+	const int32 Id = Items.Num();
+	ItemPathIds.Add(Item.Path, Id);
+	if (Item.Class) ItemIds.Add(Item.Class, Id);
+	Items.Add(MoveTemp(Item));
+	return Id;
+}
+
+int32 FFicsitPlannerRecipeTables::AddRecipe(FFicsitPlannerRecipeData&& Recipe)
+{
+	const int32 Id = Recipes.Num();
+	if (Recipe.Class) RecipeIds.Add(Recipe.Class, Id);
+	Recipes.Add(MoveTemp(Recipe));
+	return Id;
+}
+
+int32 FFicsitPlannerRecipeTables::AddBuilding(const FString& Path)
+{
+	if (const int32* Existing = BuildingIds.Find(Path)) return *Existing;
+
+	const int32 Id = BuildingPaths.Add(Path);
+	BuildingIds.Add(Path, Id);
+	return Id;
+}
+
+SIZE_T FFicsitPlannerRecipeTables::GetAllocatedSize() const
+{
+	SIZE_T Size = Items.GetAllocatedSize() + Recipes.GetAllocatedSize() + RawItems.GetAllocatedSize();
+	Size += ItemPathIds.GetAllocatedSize() + ItemIds.GetAllocatedSize() + RecipeIds.GetAllocatedSize();
+	Size += BuildingPaths.GetAllocatedSize() + BuildingIds.GetAllocatedSize();
+	for (const FFicsitPlannerItemData& Item : Items)
+	{
+		Size += Item.Path.GetAllocatedSize() + Item.Name.GetAllocatedSize();
+	}
+	for (const FFicsitPlannerRecipeData& Recipe : Recipes)
+	{
+		Size += Recipe.Path.GetAllocatedSize() + Recipe.Name.GetAllocatedSize() + Recipe.Ingredients.GetAllocatedSize() + Recipe.Products.GetAllocatedSize();
+	}
+	for (const TPair<FString, int32>& Pair : ItemPathIds)
+	{
+		Size += Pair.Key.GetAllocatedSize();
+	}
+	for (const TPair<FString, int32>& Pair : BuildingIds)
+	{
+		Size += Pair.Key.GetAllocatedSize() + BuildingPaths[Pair.Value].GetAllocatedSize();
+	}
+	return Size;
+}
+
+SIZE_T FFicsitPlannerRecipeGraph::GetAllocatedSize() const
+{
+	SIZE_T Size = Producers.GetAllocatedSize() + ObtainableItems.GetAllocatedSize() + PrunedRecipes.GetAllocatedSize();
+	Size += ItemComponents.GetAllocatedSize() + CyclicComponents.GetAllocatedSize() + Loops.GetAllocatedSize() + UnitCosts.GetAllocatedSize();
+	Size += ComponentRecipes.GetAllocatedSize();
+	for (const TBitArray<>& Reach : ComponentRecipes)
+	{
+		Size += Reach.GetAllocatedSize();
+	}
+	for (const TArray<int32>& ItemProducers : Producers)
+	{
+		Size += ItemProducers.GetAllocatedSize();
+	}
+	for (const TArray<FFicsitPlannerLoopSolution>& ItemLoops : Loops)
+	{
+		Size += ItemLoops.GetAllocatedSize();
+		for (const FFicsitPlannerLoopSolution& Loop : ItemLoops)
+		{
+			Size += Loop.Recipes.GetAllocatedSize() + Loop.Multipliers.GetAllocatedSize() + Loop.Inputs.GetAllocatedSize() + Loop.Byproducts.GetAllocatedSize();
+		}
+	}
+	return Size;
+}
+
+bool FFicsitPlannerRecipeIndex::Compile(const IFicsitPlannerRecipeSource& Source)
+{
+	Reset();
+
+	// PART 1: Load the source data
+	TArray<FFicsitPlannerSourceItem> SourceItems;
+	TArray<FFicsitPlannerSourceRecipe> SourceRecipes;
+	if (!Source.LoadRecipes(SourceItems, SourceRecipes)) return false;
+
+	// PART 2: Intern items (into new tables, shared once complete)
+	const TSharedRef<FFicsitPlannerRecipeTables, ESPMode::ThreadSafe> NewTables = MakeShared<FFicsitPlannerRecipeTables, ESPMode::ThreadSafe>();
+	TArray<bool> ResourceItems;
+	for (FFicsitPlannerSourceItem& SourceItem : SourceItems)
+	{
+		if (NewTables->ItemPathIds.Contains(SourceItem.Path)) continue;
+		NewTables->AddItem({SourceItem.Class, MoveTemp(SourceItem.Path), MoveTemp(SourceItem.Name), SourceItem.bFluid});
+		ResourceItems.Add(SourceItem.bResource);
+	}
+
+	// PART 3: Intern recipes, resolving item paths (rates for unknown items are dropped)
+	for (FFicsitPlannerSourceRecipe& SourceRecipe : SourceRecipes)
+	{
+		FFicsitPlannerRecipeData Data;
+		Data.Class = SourceRecipe.Class;
+		Data.Path = MoveTemp(SourceRecipe.Path);
+		Data.Name = MoveTemp(SourceRecipe.Name);
+		Data.Power = SourceRecipe.Power;
+		Data.Building = SourceRecipe.BuildingPath.IsEmpty() ? INDEX_NONE : NewTables->AddBuilding(SourceRecipe.BuildingPath);
+		for (const FFicsitPlannerSourceRate& Ingredient : SourceRecipe.Ingredients)
+		{
+			if (const int32* Item = NewTables->ItemPathIds.Find(Ingredient.ItemPath)) Data.Ingredients.Add({*Item, Ingredient.Rate});
+		}
+		for (const FFicsitPlannerSourceRate& Product : SourceRecipe.Products)
+		{
+			if (const int32* Item = NewTables->ItemPathIds.Find(Product.ItemPath)) Data.Products.Add({*Item, Product.Rate});
+		}
+		UnlockedRecipes.Add(SourceRecipe.bUnlocked);
+		NewTables->AddRecipe(MoveTemp(Data));
+	}
+
+	// PART 4: Raw items (resources, or items no recipe produces at all, like leaves or wood)
+	NewTables->RawItems.Init(true, NewTables->Items.Num());
+	for (const FFicsitPlannerRecipeData& Recipe : NewTables->Recipes)
+	{
+		for (const FFicsitPlannerItemRate& Product : Recipe.Products) NewTables->RawItems[Product.Item] = false;
+	}
+	for (int32 Item = 0; Item < NewTables->Items.Num(); ++Item)
+	{
+		NewTables->RawItems[Item] |= ResourceItems[Item];
+	}
+
+	Tables = NewTables;
+	return true;
+}
+
+void FFicsitPlannerRecipeIndex::SetUnlockedRecipes(const TArray<TSubclassOf<UFGRecipe>>& InUnlockedRecipes)
+{
+	// PART 1: Unlock flags (recipes that were filtered out at compile time are ignored)
+	UnlockedRecipes.Init(false, Tables->Recipes.Num());
+	for (const TSubclassOf<UFGRecipe>& Recipe : InUnlockedRecipes)
+	{
+		if (const int32 Id = FindRecipe(Recipe); Id != INDEX_NONE) UnlockedRecipes[Id] = true;
+	}
+
+	// PART 2: Build graphs for both lock modes
+	BuildGraphs();
+}
+
+void FFicsitPlannerRecipeIndex::BuildGraphs()
+{
+	// Recipes default to locked if no unlock flags were provided
+	UnlockedRecipes.SetNumZeroed(Tables->Recipes.Num());
+	CompileExclusions();
+	BuildGraph(UnlockedGraph, false);
+	BuildLockedGraph();
+}
+
+void FFicsitPlannerRecipeIndex::Reset()
+{
+	// Releases this index's reference to the tables (other worlds & versions may keep them)
+	Tables = MakeShared<FFicsitPlannerRecipeTables, ESPMode::ThreadSafe>();
+	UnlockedRecipes.Empty();
+	ExcludedItems.Empty();
+	ExcludedRecipes.Empty();
+	UnlockedGraph = FFicsitPlannerRecipeGraph();
+	LockedGraph = MakeShared<FFicsitPlannerRecipeGraph, ESPMode::ThreadSafe>();
+}
+
+bool FFicsitPlannerRecipeIndex::SetExclusionRules(const FFicsitPlannerExclusionRules& Rules)
+{
+	// Only the masks are compiled again, the graphs are rebuilt if they changed
+	ExclusionRules = Rules;
+	if (!CompileExclusions()) return false;
+
+	BuildGraph(UnlockedGraph, false);
+	BuildLockedGraph();
+	return true;
+}
+
+int32 FFicsitPlannerRecipeIndex::FindItem(const TSubclassOf<UFGItemDescriptor> Item) const
+{
+	const int32* Id = Tables->ItemIds.Find(Item);
+	return Id ? *Id : INDEX_NONE;
+}
+
+int32 FFicsitPlannerRecipeIndex::FindRecipe(const TSubclassOf<UFGRecipe> Recipe) const
+{
+	const int32* Id = Tables->RecipeIds.Find(Recipe);
+	return Id ? *Id : INDEX_NONE;
+}
+
+int32 FFicsitPlannerRecipeIndex::FindItemByPath(const FString& Path) const
+{
+	const int32* Id = Tables->ItemPathIds.Find(Path);
+	return Id ? *Id : INDEX_NONE;
+}
+
+int32 FFicsitPlannerRecipeIndex::FindItemByName(const FString& Name) const
+{
+	// Display names aren't unique keys, return the first match
+	for (int32 Item = 0; Item < Tables->Items.Num(); ++Item)
+	{
+		if (Tables->Items[Item].Name.Equals(Name, ESearchCase::IgnoreCase)) return Item;
+	}
+	return INDEX_NONE;
+}
+
+float FFicsitPlannerRecipeIndex::GetProductRate(const int32 Recipe, const int32 Item) const
+{
+	for (const FFicsitPlannerItemRate& Product : Tables->Recipes[Recipe].Products)
+	{
+		if (Product.Item == Item) return Product.Rate;
+	}
+	return 0.0f;
+}
+
+bool FFicsitPlannerRecipeIndex::IsObtainable(const bool bAllowLockedRecipes, const int32 Item) const
+{
+	const FFicsitPlannerRecipeGraph& Graph = GetGraph(bAllowLockedRecipes);
+	return Graph.ObtainableItems.IsValidIndex(Item) && Graph.ObtainableItems[Item];
+}
+
+bool FFicsitPlannerRecipeIndex::IsUsableRecipe(const bool bAllowLockedRecipes, const int32 Item, const int32 Recipe) const
+{
+	// Pruned recipes were removed from the item's producers
+	const FFicsitPlannerRecipeGraph& Graph = GetGraph(bAllowLockedRecipes);
+	return Graph.Producers.IsValidIndex(Item) && Graph.Producers[Item].Contains(Recipe);
+}
+
+bool FFicsitPlannerRecipeIndex::IsLoopItem(const bool bAllowLockedRecipes, const int32 Item) const
+{
+	// Only items with at least one solved loop are planned through loops
+	const FFicsitPlannerRecipeGraph& Graph = GetGraph(bAllowLockedRecipes);
+	return Graph.Loops.IsValidIndex(Item) && Graph.Loops[Item].Num() > 0;
+}
+
+bool FFicsitPlannerRecipeIndex::ConsumesFromComponent(const bool bAllowLockedRecipes, const int32 Recipe, const int32 Item) const
+{
+	if (!Tables->Recipes.IsValidIndex(Recipe) || !Tables->Items.IsValidIndex(Item)) return false;
+
+	// Check if any ingredient lives in the same component as the item
+	const FFicsitPlannerRecipeGraph& Graph = GetGraph(bAllowLockedRecipes);
+	const int32 Component = Graph.ItemComponents[Item];
+	for (const FFicsitPlannerItemRate& Ingredient : Tables->Recipes[Recipe].Ingredients)
+	{
+		if (Graph.ItemComponents[Ingredient.Item] == Component) return true;
+	}
+	return false;
+}
+
+int32 FFicsitPlannerRecipeIndex::NumLoopSolutions(const bool bAllowLockedRecipes) const
+{
+	int32 Count = 0;
+	for (const TArray<FFicsitPlannerLoopSolution>& ItemLoops : GetGraph(bAllowLockedRecipes).Loops)
+	{
+		Count += ItemLoops.Num();
+	}
+	return Count;
+}
+
+SIZE_T FFicsitPlannerRecipeIndex::GetAllocatedSize(const bool bIncludeShared) const
+{
+	// Masks & the unlocked graph, and the shared tables & all-recipes graph
+	SIZE_T Size = UnlockedRecipes.GetAllocatedSize() + ExcludedItems.GetAllocatedSize() + ExcludedRecipes.GetAllocatedSize();
+	Size += UnlockedGraph.GetAllocatedSize();
+	if (bIncludeShared) Size += GetSharedAllocatedSize();
+	return Size;
+}
+
+SIZE_T FFicsitPlannerRecipeIndex::GetSharedAllocatedSize() const
+{
+	return Tables->GetAllocatedSize() + LockedGraph->GetAllocatedSize();
+}
+
+bool FFicsitPlannerRecipeIndex::CompileExclusions()
+{
+	// Rules match a class name or a full class path (case-insensitive, like FString sets)
+	const auto MakeRuleSet = [](const TArray<FString>& Rules)
+	{
+		TSet<FString> RuleSet;
+		for (const FString& Rule : Rules) RuleSet.Add(Rule.TrimStartAndEnd());
+		return RuleSet;
+	};
+	const auto Matches = [](const TSet<FString>& RuleSet, const FString& Path)
+	{
+		if (RuleSet.Num() == 0 || Path.IsEmpty()) return false;
+		int32 Dot;
+		return RuleSet.Contains(Path) || (Path.FindLastChar(TEXT('.'), Dot) && RuleSet.Contains(Path.RightChop(Dot + 1)));
+	};
+	const TSet<FString> ItemRules = MakeRuleSet(ExclusionRules.Items);
+	const TSet<FString> RecipeRules = MakeRuleSet(ExclusionRules.Recipes);
+	const TSet<FString> BuildingRules = MakeRuleSet(ExclusionRules.Buildings);
+
+	// PART 1: Items & buildings (names are only matched here, once per rule change)
+	TBitArray<> NewExcludedItems(false, Tables->Items.Num());
+	for (int32 Item = 0; Item < Tables->Items.Num(); ++Item)
+	{
+		NewExcludedItems[Item] = Matches(ItemRules, Tables->Items[Item].Path);
+	}
+	TBitArray<> ExcludedBuildings(false, Tables->BuildingPaths.Num());
+	for (int32 Building = 0; Building < Tables->BuildingPaths.Num(); ++Building)
+	{
+		ExcludedBuildings[Building] = Matches(BuildingRules, Tables->BuildingPaths[Building]);
+	}
+
+	// PART 2: Recipes (by name, building, or any excluded ingredient / product)
+	TBitArray<> NewExcludedRecipes(false, Tables->Recipes.Num());
+	for (int32 Recipe = 0; Recipe < Tables->Recipes.Num(); ++Recipe)
+	{
+		const FFicsitPlannerRecipeData& RecipeData = Tables->Recipes[Recipe];
+		bool bExcluded = Matches(RecipeRules, RecipeData.Path) || (RecipeData.Building != INDEX_NONE && ExcludedBuildings[RecipeData.Building]);
+		for (const FFicsitPlannerItemRate& Ingredient : RecipeData.Ingredients) bExcluded |= NewExcludedItems[Ingredient.Item];
+		for (const FFicsitPlannerItemRate& Product : RecipeData.Products) bExcluded |= NewExcludedItems[Product.Item];
+		NewExcludedRecipes[Recipe] = bExcluded;
+	}
+
+	const bool bChanged = NewExcludedItems != ExcludedItems || NewExcludedRecipes != ExcludedRecipes;
+	ExcludedItems = MoveTemp(NewExcludedItems);
+	ExcludedRecipes = MoveTemp(NewExcludedRecipes);
+	return bChanged;
+}
+
+namespace FicsitPlannerRecipeGraphs
+{
+	// All-recipes graph built last in this process, and the tables & recipe exclusion mask it was built from (the only inputs it depends on)
+	FCriticalSection SharedGraphLock;
+	TSharedPtr<const FFicsitPlannerRecipeGraph, ESPMode::ThreadSafe> SharedGraph;
+	TWeakPtr<const FFicsitPlannerRecipeTables, ESPMode::ThreadSafe> SharedGraphTables;
+	TBitArray<> SharedGraphExcludedRecipes;
+}
+
+void FFicsitPlannerRecipeIndex::BuildLockedGraph()
+{
+	using namespace FicsitPlannerRecipeGraphs;
+
+	// PART 1: Reuse the shared graph if it was built from the same tables & exclusions (unlocks don't change it)
+	{
+		FScopeLock Lock(&SharedGraphLock);
+		if (SharedGraph && SharedGraphTables.Pin().Get() == &Tables.Get() && SharedGraphExcludedRecipes == ExcludedRecipes)
+		{
+			LockedGraph = SharedGraph.ToSharedRef();
+			return;
+		}
+	}
+
+	// PART 2: Build it (outside the lock), and replace the shared graph (other worlds keep theirs while they hold them)
+	const TSharedRef<FFicsitPlannerRecipeGraph, ESPMode::ThreadSafe> NewGraph = MakeShared<FFicsitPlannerRecipeGraph, ESPMode::ThreadSafe>();
+	BuildGraph(*NewGraph, true);
+	LockedGraph = NewGraph;
+
+	FScopeLock Lock(&SharedGraphLock);
+	SharedGraph = NewGraph;
+	SharedGraphTables = Tables;
+	SharedGraphExcludedRecipes = ExcludedRecipes;
+}
+
+void FFicsitPlannerRecipeIndex::BuildGraph(FFicsitPlannerRecipeGraph& Graph, const bool bAllowLockedRecipes) const
+{
+	// PART 1: Producers per item (excluded recipes left out)
+	Graph = FFicsitPlannerRecipeGraph();
+	Graph.Producers.SetNum(Tables->Items.Num());
+	for (int32 Recipe = 0; Recipe < Tables->Recipes.Num(); ++Recipe)
+	{
+		if (ExcludedRecipes[Recipe] || (!bAllowLockedRecipes && !UnlockedRecipes[Recipe])) continue;
+		for (const FFicsitPlannerItemRate& Product : Tables->Recipes[Recipe].Products)
+		{
+			Graph.Producers[Product.Item].AddUnique(Recipe);
+		}
+	}
+
+	// PART 2: Prune dead ends & dominated alternatives (before looking for loops, so they never end up in one)
+	PruneRecipes(Graph);
+
+	// PART 3: Strongly connected components
+	FindComponents(Graph);
+
+	// PART 4: Solve loops for every item in a cyclic component
+	Graph.Loops.SetNum(Tables->Items.Num());
+	for (int32 Item = 0; Item < Tables->Items.Num(); ++Item)
+	{
+		if (Graph.CyclicComponents[Graph.ItemComponents[Item]])
+		{
+			SolveLoops(Graph, Item);
+		}
+	}
+
+	// PART 5: Optimal unit costs
+	ComputeUnitCosts(Graph);
+
+	// PART 6: Recipes reachable from each component (sub-plan keys)
+	FindComponentRecipes(Graph);
+}
+
+void FFicsitPlannerRecipeIndex::PruneRecipes(FFicsitPlannerRecipeGraph& Graph) const
+{
+	const int32 ItemCount = Tables->Items.Num();
+	const int32 RecipeCount = Tables->Recipes.Num();
+
+	// PART 1: Recipes available in this lock mode, and what consumes each item
+	TArray<bool> Available;
+	TArray<int32> UnmetIngredients;
+	TArray<TArray<int32>> Consumers;
+	Available.Init(false, RecipeCount);
+	UnmetIngredients.Init(0, RecipeCount);
+	Consumers.SetNum(ItemCount);
+	for (const TArray<int32>& ItemProducers : Graph.Producers)
+	{
+		for (const int32 Recipe : ItemProducers) Available[Recipe] = true;
+	}
+	for (int32 Recipe = 0; Recipe < RecipeCount; ++Recipe)
+	{
+		if (!Available[Recipe]) continue;
+		for (const FFicsitPlannerItemRate& Ingredient : Tables->Recipes[Recipe].Ingredients)
+		{
+			Consumers[Ingredient.Item].Add(Recipe);
+			UnmetIngredients[Recipe]++;
+		}
+	}
+
+	// PART 2: Obtainable items, growing from raw items through recipes whose ingredients are all obtainable
+	Graph.ObtainableItems.Init(false, ItemCount);
+	TArray<int32> Worklist;
+	const auto MarkProducts = [&](const int32 Recipe)
+	{
+		for (const FFicsitPlannerItemRate& Product : Tables->Recipes[Recipe].Products)
+		{
+			if (!Graph.ObtainableItems[Product.Item])
+			{
+				Graph.ObtainableItems[Product.Item] = true;
+				Worklist.Push(Product.Item);
+			}
+		}
+	};
+
+	for (int32 Item = 0; Item < ItemCount; ++Item)
+	{
+		if (Tables->RawItems[Item] && !Graph.ObtainableItems[Item])
+		{
+			Graph.ObtainableItems[Item] = true;
+			Worklist.Push(Item);
+		}
+	}
+	for (int32 Recipe = 0; Recipe < RecipeCount; ++Recipe)
+	{
+		if (Available[Recipe] && UnmetIngredients[Recipe] == 0) MarkProducts(Recipe);
+	}
+	while (Worklist.Num() > 0)
+	{
+		const int32 Item = Worklist.Pop();
+		for (const int32 Recipe : Consumers[Item])
+		{
+			if (--UnmetIngredients[Recipe] == 0) MarkProducts(Recipe);
+		}
+	}
+
+	// PART 3: Remove dead ends (recipes with an ingredient that can never be obtained)
+	Graph.PrunedRecipes.Empty();
+	for (int32 Item = 0; Item < ItemCount; ++Item)
+	{
+		Graph.Producers[Item].RemoveAll([&](const int32 Recipe)
+		{
+			if (UnmetIngredients[Recipe] == 0) return false;
+
+			FFicsitPlannerPrunedRecipe& Pruned = Graph.PrunedRecipes.AddDefaulted_GetRef();
+			Pruned.Item = Item;
+			Pruned.Recipe = Recipe;
+			Pruned.Reason = EFicsitPlannerPruneReason::DeadEnd;
+			for (const FFicsitPlannerItemRate& Ingredient : Tables->Recipes[Recipe].Ingredients)
+			{
+				if (!Graph.ObtainableItems[Ingredient.Item])
+				{
+					Pruned.Cause = Ingredient.Item;
+					break;
+				}
+			}
+			return true;
+		});
+	}
+
+	// PART 4: Remove dominated alternatives (per item, so a recipe can stay for its other products)
+	for (int32 Item = 0; Item < ItemCount; ++Item)
+	{
+		TArray<int32>& ItemProducers = Graph.Producers[Item];
+		TArray<int32> Dominated;
+		for (const int32 Recipe : ItemProducers)
+		{
+			for (const int32 OtherRecipe : ItemProducers)
+			{
+				if (OtherRecipe != Recipe && Dominates(OtherRecipe, Recipe, Item))
+				{
+					FFicsitPlannerPrunedRecipe& Pruned = Graph.PrunedRecipes.AddDefaulted_GetRef();
+					Pruned.Item = Item;
+					Pruned.Recipe = Recipe;
+					Pruned.Reason = EFicsitPlannerPruneReason::Dominated;
+					Pruned.Cause = OtherRecipe;
+					Dominated.Add(Recipe);
+					break;
+				}
+			}
+		}
+		ItemProducers.RemoveAll([&](const int32 Recipe) { return Dominated.Contains(Recipe); });
+	}
+}
+
+bool FFicsitPlannerRecipeIndex::Dominates(const int32 Recipe, const int32 OtherRecipe, const int32 Item) const
+{
+	// Compares per unit of the item, with a small relative tolerance
+	constexpr float Tolerance = 1.0e-4f;
+	const auto Worse = [](const float A, const float B) { return A > B * (1.0f + Tolerance) + Tolerance; };
+	const auto Better = [](const float A, const float B) { return A * (1.0f + Tolerance) + Tolerance < B; };
+	const auto FindRate = [](const TArray<FFicsitPlannerItemRate>& Rates, const int32 RateItem)
+	{
+		const FFicsitPlannerItemRate* Rate = Rates.FindByPredicate([&](const FFicsitPlannerItemRate& Entry) { return Entry.Item == RateItem; });
+		return Rate ? Rate->Rate : 0.0f;
+	};
+
+	const FFicsitPlannerRecipeData& A = Tables->Recipes[Recipe];
+	const FFicsitPlannerRecipeData& B = Tables->Recipes[OtherRecipe];
+	const float OutputA = FindRate(A.Products, Item);
+	const float OutputB = FindRate(B.Products, Item);
+	if (OutputA <= 0.0f || OutputB <= 0.0f) return false;
+
+	bool bStrictlyBetter = false;
+
+	// Buildings per unit
+	const float BuildingsA = 1.0f / OutputA;
+	const float BuildingsB = 1.0f / OutputB;
+	if (Worse(BuildingsA, BuildingsB)) return false;
+	bStrictlyBetter |= Better(BuildingsA, BuildingsB);
+
+	// Power per unit
+	const float PowerA = A.Power / OutputA;
+	const float PowerB = B.Power / OutputB;
+	if (Worse(PowerA, PowerB)) return false;
+	bStrictlyBetter |= Better(PowerA, PowerB);
+
+	// Ingredients per unit (A may not need anything B doesn't, nor more of it)
+	for (const FFicsitPlannerItemRate& Ingredient : A.Ingredients)
+	{
+		const float RateA = Ingredient.Rate / OutputA;
+		const float RateB = FindRate(B.Ingredients, Ingredient.Item) / OutputB;
+		if (Worse(RateA, RateB)) return false;
+		bStrictlyBetter |= Better(RateA, RateB);
+	}
+	for (const FFicsitPlannerItemRate& Ingredient : B.Ingredients)
+	{
+		if (FindRate(A.Ingredients, Ingredient.Item) <= 0.0f) bStrictlyBetter = true;
+	}
+
+	// Byproducts per unit (A must make at least as much of everything B makes, and nothing extra to get rid of)
+	for (const FFicsitPlannerItemRate& Product : A.Products)
+	{
+		if (Product.Item != Item && FindRate(B.Products, Product.Item) <= 0.0f) return false;
+	}
+	for (const FFicsitPlannerItemRate& Product : B.Products)
+	{
+		if (Product.Item == Item) continue;
+		const float RateA = FindRate(A.Products, Product.Item) / OutputA;
+		const float RateB = Product.Rate / OutputB;
+		if (Better(RateA, RateB)) return false;
+		bStrictlyBetter |= Worse(RateA, RateB);
+	}
+
+	return bStrictlyBetter;
+}
+
+void FFicsitPlannerRecipeIndex::FindComponents(FFicsitPlannerRecipeGraph& Graph) const
+{
+	const int32 ItemCount = Tables->Items.Num();
+
+	// Item -> ingredient items, over all recipes producing the item
+	TArray<TArray<int32>> Edges;
+	Edges.SetNum(ItemCount);
+	for (int32 Item = 0; Item < ItemCount; ++Item)
+	{
+		for (const int32 Recipe : Graph.Producers[Item])
+		{
+			for (const FFicsitPlannerItemRate& Ingredient : Tables->Recipes[Recipe].Ingredients)
+			{
+				Edges[Item].AddUnique(Ingredient.Item);
+			}
+		}
+	}
+
+	// Tarjan's algorithm, iterative (w/ explicit call stack) to avoid deep recursion on long chains
+	struct FFrame
+	{
+		int32 Item;
+		int32 Edge;
+	};
+
+	TArray<int32> Order;
+	TArray<int32> LowLink;
+	TArray<bool> OnStack;
+	Order.Init(INDEX_NONE, ItemCount);
+	LowLink.Init(INDEX_NONE, ItemCount);
+	OnStack.Init(false, ItemCount);
+
+	TArray<int32> Stack;
+	TArray<FFrame> CallStack;
+	int32 Counter = 0;
+
+	Graph.ItemComponents.Init(INDEX_NONE, ItemCount);
+	Graph.CyclicComponents.Empty();
+
+	for (int32 Root = 0; Root < ItemCount; ++Root)
+	{
+		if (Order[Root] != INDEX_NONE) continue;
+
+		Order[Root] = LowLink[Root] = Counter++;
+		Stack.Push(Root);
+		OnStack[Root] = true;
+		CallStack.Push({Root, 0});
+
+		while (CallStack.Num() > 0)
+		{
+			const int32 Item = CallStack.Last().Item;
+
+			// Visit the next edge
+			if (CallStack.Last().Edge < Edges[Item].Num())
+			{
+				const int32 Next = Edges[Item][CallStack.Last().Edge++];
+				if (Order[Next] == INDEX_NONE)
+				{
+					Order[Next] = LowLink[Next] = Counter++;
+					Stack.Push(Next);
+					OnStack[Next] = true;
+					CallStack.Push({Next, 0});
+				}
+				else if (OnStack[Next])
+				{
+					LowLink[Item] = FMath::Min(LowLink[Item], Order[Next]);
+				}
+				continue;
+			}
+
+			// All edges visited, pop the component if this is its root
+			if (LowLink[Item] == Order[Item])
+			{
+				const int32 Component = Graph.CyclicComponents.Num();
+				int32 Size = 0;
+				int32 Member;
+				do
+				{
+					Member = Stack.Pop();
+					OnStack[Member] = false;
+					Graph.ItemComponents[Member] = Component;
+					Size++;
+				}
+				while (Member != Item);
+
+				// Single items are only cyclic if a recipe consumes its own product
+				Graph.CyclicComponents.Add(Size > 1 || Edges[Item].Contains(Item));
+			}
+
+			CallStack.Pop();
+			if (CallStack.Num() > 0)
+			{
+				const int32 Parent = CallStack.Last().Item;
+				LowLink[Parent] = FMath::Min(LowLink[Parent], LowLink[Item]);
+			}
+		}
+	}
+}
+
+void FFicsitPlannerRecipeIndex::SolveLoops(FFicsitPlannerRecipeGraph& Graph, const int32 TargetItem) const
+{
+	TArray<int32> AssignedItems;
+	TArray<int32> ChosenRecipes;
+
+	// Start with every recipe producing the target
+	for (const int32 Recipe : Graph.Producers[TargetItem])
+	{
+		AssignedItems.Reset();
+		ChosenRecipes.Reset();
+		AssignedItems.Add(TargetItem);
+		ChosenRecipes.Add(Recipe);
+		EnumerateLoops(Graph, TargetItem, AssignedItems, ChosenRecipes);
+	}
+}
+
+void FFicsitPlannerRecipeIndex::FindComponentRecipes(FFicsitPlannerRecipeGraph& Graph) const
+{
+	const int32 ComponentCount = Graph.CyclicComponents.Num();
+
+	// Items per component
+	TArray<TArray<int32>> ComponentItems;
+	ComponentItems.SetNum(ComponentCount);
+	for (int32 Item = 0; Item < Tables->Items.Num(); ++Item)
+	{
+		ComponentItems[Graph.ItemComponents[Item]].Add(Item);
+	}
+
+	// Ingredients first (Tarjan numbers components in reverse topological order)
+	Graph.ComponentRecipes.SetNum(ComponentCount);
+	for (int32 Component = 0; Component < ComponentCount; ++Component)
+	{
+		TBitArray<>& Reach = Graph.ComponentRecipes[Component];
+		Reach.Init(false, Tables->Recipes.Num());
+		for (const int32 Item : ComponentItems[Component])
+		{
+			for (const int32 Recipe : Graph.Producers[Item])
+			{
+				Reach[Recipe] = true;
+				for (const FFicsitPlannerItemRate& Ingredient : Tables->Recipes[Recipe].Ingredients)
+				{
+					const int32 IngredientComponent = Graph.ItemComponents[Ingredient.Item];
+					if (IngredientComponent != Component)
+					{
+						Reach.CombineWithBitwiseOR(Graph.ComponentRecipes[IngredientComponent], EBitwiseOperatorFlags::MaxSize);
+					}
+				}
+			}
+		}
+	}
+}
+
+void FFicsitPlannerRecipeIndex::ComputeUnitCosts(FFicsitPlannerRecipeGraph& Graph) const
+{
+	// Items by component, ingredients first (Tarjan numbers components in reverse topological order)
+	TArray<int32> SortedItems;
+	SortedItems.Reserve(Tables->Items.Num());
+	for (int32 Item = 0; Item < Tables->Items.Num(); ++Item) SortedItems.Add(Item);
+	Algo::StableSortBy(SortedItems, [&](const int32 Item) { return Graph.ItemComponents[Item]; });
+
+	Graph.UnitCosts.SetNum(Tables->Items.Num());
+	for (const int32 Item : SortedItems)
+	{
+		FFicsitPlannerUnitCost& Cost = Graph.UnitCosts[Item];
+		const int32 Component = Graph.ItemComponents[Item];
+		const bool bLoopItem = Graph.Loops[Item].Num() > 0;
+		bool bFirst = true;
+
+		// Alternatives in the same order as FFicsitPlannerCore::ExpandNode (the first one wins ties, like RefreshNode)
+		const auto AddAlternative = [&](const int32 Recipe, const int32 Loop, float Power, float Buildings, int32 RecipesRun, const TArray<FFicsitPlannerItemRate>& Inputs, const float InputScale)
+		{
+			float RawInputs = 0.0f;
+			bool bExact = true;
+			for (const FFicsitPlannerItemRate& Input : Inputs)
+			{
+				// Inputs in the same component (cycles without solved loops) are cut by the planner at some depth, so they're left out
+				if (Graph.ItemComponents[Input.Item] == Component)
+				{
+					bExact = false;
+					continue;
+				}
+
+				// Recipes run don't scale with the rate (every input runs its own recipes once)
+				const FFicsitPlannerUnitCost& InputCost = Graph.UnitCosts[Input.Item];
+				Power += InputCost.Power * Input.Rate * InputScale;
+				Buildings += InputCost.Buildings * Input.Rate * InputScale;
+				RecipesRun += InputCost.RecipesRun;
+				RawInputs += InputCost.RawInputs * Input.Rate * InputScale;
+				bExact &= InputCost.bExact;
+			}
+
+			// Only the chosen alternative (and its inputs) decides whether the least power is exact
+			if (bFirst || Power < Cost.Power)
+			{
+				Cost.Power = Power;
+				Cost.PowerRecipe = Recipe;
+				Cost.PowerLoop = Loop;
+				Cost.bExact = bExact;
+			}
+			Cost.Buildings = bFirst ? Buildings : FMath::Min(Cost.Buildings, Buildings);
+			Cost.RecipesRun = bFirst ? RecipesRun : FMath::Min(Cost.RecipesRun, RecipesRun);
+			Cost.RawInputs = bFirst ? RawInputs : FMath::Min(Cost.RawInputs, RawInputs);
+			bFirst = false;
+		};
+
+		// PART 1: Recipes (loop items only use the ones not consuming from their loop)
+		for (const int32 Recipe : Graph.Producers[Item])
+		{
+			const float ProductRate = GetProductRate(Recipe, Item);
+			if (ProductRate <= 0.0f) continue;
+
+			const bool bConsumesFromComponent = Tables->Recipes[Recipe].Ingredients.ContainsByPredicate([&](const FFicsitPlannerItemRate& Ingredient) { return Graph.ItemComponents[Ingredient.Item] == Component; });
+			if (bLoopItem && bConsumesFromComponent) continue;
+
+			const float Multiplier = 1.0f / ProductRate;
+			AddAlternative(Recipe, INDEX_NONE, Tables->Recipes[Recipe].Power * Multiplier, Multiplier, 1, Tables->Recipes[Recipe].Ingredients, Multiplier);
+		}
+
+		// PART 2: Loops (inputs are normalized to 1 / min already)
+		for (int32 Loop = 0; Loop < Graph.Loops[Item].Num(); ++Loop)
+		{
+			const FFicsitPlannerLoopSolution& Solution = Graph.Loops[Item][Loop];
+			float Power = 0.0f;
+			float Buildings = 0.0f;
+			for (int32 i = 0; i < Solution.Recipes.Num(); ++i)
+			{
+				Power += Tables->Recipes[Solution.Recipes[i]].Power * Solution.Multipliers[i];
+				Buildings += Solution.Multipliers[i];
+			}
+			AddAlternative(Solution.Recipes[0], Loop, Power, Buildings, Solution.Recipes.Num(), Solution.Inputs, 1.0f);
+		}
+
+		// PART 3: Raw resources can be mined instead, and leaf inputs are supplied as they are
+		if (bFirst || Tables->RawItems[Item]) Cost.RawInputs = bFirst ? 1.0f : FMath::Min(Cost.RawInputs, 1.0f);
+	}
+}
+
+void FFicsitPlannerRecipeIndex::EnumerateLoops(FFicsitPlannerRecipeGraph& Graph, const int32 TargetItem, TArray<int32>& AssignedItems, TArray<int32>& ChosenRecipes) const
+{
+	TArray<FFicsitPlannerLoopSolution>& Solutions = Graph.Loops[TargetItem];
+	if (Solutions.Num() >= MAX_LOOP_SOLUTIONS) return;
+
+	// Find the next ingredient inside the component that has no recipe assigned yet
+	const int32 Component = Graph.ItemComponents[TargetItem];
+	int32 NextItem = INDEX_NONE;
+	for (const int32 Recipe : ChosenRecipes)
+	{
+		for (const FFicsitPlannerItemRate& Ingredient : Tables->Recipes[Recipe].Ingredients)
+		{
+			if (Graph.ItemComponents[Ingredient.Item] == Component && !AssignedItems.Contains(Ingredient.Item))
+			{
+				NextItem = Ingredient.Item;
+				break;
+			}
+		}
+		if (NextItem != INDEX_NONE) break;
+	}
+
+	// Closed system, solve it
+	if (NextItem == INDEX_NONE)
+	{
+		FFicsitPlannerLoopSolution Solution;
+		if (!EvaluateLoop(AssignedItems, ChosenRecipes, Solution)) return;
+
+		// Skip duplicates (same recipe set reached through a different assignment order)
+		TArray<int32> SortedRecipes = Solution.Recipes;
+		SortedRecipes.Sort();
+		for (const FFicsitPlannerLoopSolution& Existing : Solutions)
+		{
+			TArray<int32> ExistingRecipes = Existing.Recipes;
+			ExistingRecipes.Sort();
+			if (ExistingRecipes == SortedRecipes) return;
+		}
+
+		Solutions.Add(MoveTemp(Solution));
+		return;
+	}
+
+	// Too many recipes for this loop
+	if (ChosenRecipes.Num() >= MAX_LOOP_RECIPES) return;
+
+	// Branch over the recipes producing the next item
+	for (const int32 Recipe : Graph.Producers[NextItem])
+	{
+		// A recipe can only balance one item
+		if (ChosenRecipes.Contains(Recipe)) continue;
+
+		AssignedItems.Add(NextItem);
+		ChosenRecipes.Add(Recipe);
+		EnumerateLoops(Graph, TargetItem, AssignedItems, ChosenRecipes);
+		AssignedItems.Pop();
+		ChosenRecipes.Pop();
+	}
+}
+
+bool FFicsitPlannerRecipeIndex::EvaluateLoop(const TArray<int32>& AssignedItems, const TArray<int32>& ChosenRecipes, FFicsitPlannerLoopSolution& OutSolution) const
+{
+	const int32 Size = ChosenRecipes.Num();
+
+	// PART 1: A lone recipe that consumes nothing from the component is planned normally
+	if (Size == 1)
+	{
+		bool bConsumesOwnProduct = false;
+		for (const FFicsitPlannerItemRate& Ingredient : Tables->Recipes[ChosenRecipes[0]].Ingredients)
+		{
+			bConsumesOwnProduct |= Ingredient.Item == AssignedItems[0];
+		}
+		if (!bConsumesOwnProduct) return false;
+	}
+
+	// PART 2: Steady state, net production of the target is 1 / min, every other balanced item nets 0
+	TArray<double> Matrix;
+	TArray<double> Values;
+	Matrix.SetNumZeroed(Size * Size);
+	Values.SetNumZeroed(Size);
+	Values[0] = 1.0;
+
+	for (int32 Column = 0; Column < Size; ++Column)
+	{
+		const FFicsitPlannerRecipeData& Recipe = Tables->Recipes[ChosenRecipes[Column]];
+		for (const FFicsitPlannerItemRate& Product : Recipe.Products)
+		{
+			if (const int32 Row = AssignedItems.Find(Product.Item); Row != INDEX_NONE) Matrix[Row * Size + Column] += Product.Rate;
+		}
+		for (const FFicsitPlannerItemRate& Ingredient : Recipe.Ingredients)
+		{
+			if (const int32 Row = AssignedItems.Find(Ingredient.Item); Row != INDEX_NONE) Matrix[Row * Size + Column] -= Ingredient.Rate;
+		}
+	}
+
+	if (!SolveLinearSystem(Matrix, Values, Size)) return false;
+
+	// Every recipe must run forwards
+	for (const double Multiplier : Values)
+	{
+		if (Multiplier <= KINDA_SMALL_NUMBER) return false;
+	}
+
+	// PART 3: Net flows across the loop boundary
+	TMap<int32, double> NetFlows;
+	for (int32 Column = 0; Column < Size; ++Column)
+	{
+		const FFicsitPlannerRecipeData& Recipe = Tables->Recipes[ChosenRecipes[Column]];
+		for (const FFicsitPlannerItemRate& Product : Recipe.Products)
+		{
+			if (!AssignedItems.Contains(Product.Item)) NetFlows.FindOrAdd(Product.Item) += Values[Column] * Product.Rate;
+		}
+		for (const FFicsitPlannerItemRate& Ingredient : Recipe.Ingredients)
+		{
+			if (!AssignedItems.Contains(Ingredient.Item)) NetFlows.FindOrAdd(Ingredient.Item) -= Values[Column] * Ingredient.Rate;
+		}
+	}
+
+	// PART 4: Save solution
+	OutSolution.TargetItem = AssignedItems[0];
+	OutSolution.Recipes = ChosenRecipes;
+	for (const double Multiplier : Values)
+	{
+		OutSolution.Multipliers.Add(static_cast<float>(Multiplier));
+	}
+	for (const auto& Flow : NetFlows)
+	{
+		if (Flow.Value < -KINDA_SMALL_NUMBER) OutSolution.Inputs.Add({Flow.Key, static_cast<float>(-Flow.Value)});
+		else if (Flow.Value > KINDA_SMALL_NUMBER) OutSolution.Byproducts.Add({Flow.Key, static_cast<float>(Flow.Value)});
+	}
+
+	return true;
+}
+
+bool FFicsitPlannerRecipeIndex::SolveLinearSystem(TArray<double>& Matrix, TArray<double>& Values, const int32 Size)
+{
+	// Gauss-Jordan elimination w/ partial pivoting (systems are at most MAX_LOOP_RECIPES wide)
+	for (int32 Column = 0; Column < Size; ++Column)
+	{
+		// Pick the largest pivot
+		int32 Pivot = Column;
+		for (int32 Row = Column + 1; Row < Size; ++Row)
+		{
+			if (FMath::Abs(Matrix[Row * Size + Column]) > FMath::Abs(Matrix[Pivot * Size + Column])) Pivot = Row;
+		}
+		if (FMath::Abs(Matrix[Pivot * Size + Column]) < UE_DOUBLE_SMALL_NUMBER) return false;
+
+		// Swap rows
+		if (Pivot != Column)
+		{
+			for (int32 k = 0; k < Size; ++k) Swap(Matrix[Pivot * Size + k], Matrix[Column * Size + k]);
+			Swap(Values[Pivot], Values[Column]);
+		}
+
+		// Eliminate the column from every other row
+		for (int32 Row = 0; Row < Size; ++Row)
+		{
+			if (Row == Column) continue;
+			const double Factor = Matrix[Row * Size + Column] / Matrix[Column * Size + Column];
+			if (Factor == 0.0) continue;
+			for (int32 k = Column; k < Size; ++k) Matrix[Row * Size + k] -= Factor * Matrix[Column * Size + k];
+			Values[Row] -= Factor * Values[Column];
+		}
+	}
+
+	// Normalize
+	for (int32 Row = 0; Row < Size; ++Row)
+	{
+		Values[Row] /= Matrix[Row * Size + Row];
+	}
+	return true;
+}
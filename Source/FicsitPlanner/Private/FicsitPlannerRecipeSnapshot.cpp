@@ -0,0 +1,307 @@
+#include "FicsitPlannerRecipeIndex.h"
+
+#include "FicsitPlannerEngine.h"
+#include "HAL/PlatformFileManager.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeLock.h"
+#include "ModLoading/ModLoadingLibrary.h"
+
+/**
+ * Snapshot layout: a header followed by flat, 8-byte aligned sections.
+ * Everything is plain data addressed by offsets, so the file can be mapped and read in place.
+ */
+namespace FicsitPlannerSnapshot
+{
+	constexpr uint32 MAGIC = 0x49525046; // "FPRI"
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint64 Hash;
+		uint32 NumItems;
+		uint32 NumRecipes;
+		uint32 NumRates;
+		uint32 NumChars;
+		uint32 ItemsOffset;
+		uint32 RecipesOffset;
+		uint32 RatesOffset;
+		uint32 CharsOffset;
+		uint64 TotalSize;
+	};
+
+	struct FItem
+	{
+		uint32 PathOffset;
+		uint32 PathLength;
+		uint32 bRaw;
+		uint32 bFluid;
+	};
+
+	struct FRecipe
+	{
+		uint32 PathOffset;
+		uint32 PathLength;
+		uint32 FirstRate;
+		uint16 NumIngredients;
+		uint16 NumProducts;
+		float Power;
+		uint32 BuildingOffset;
+		uint32 BuildingLength;
+	};
+
+	static_assert(sizeof(FFicsitPlannerItemRate) == 8, "Item rates are written to snapshots as-is");
+
+	// Appends a section, aligned to 8 bytes, and returns its offset
+	template <typename T>
+	uint32 AppendSection(TArray<uint8>& Buffer, const TArray<T>& Section)
+	{
+		Buffer.SetNumZeroed(Align(Buffer.Num(), 8));
+		const uint32 Offset = Buffer.Num();
+		Buffer.Append(reinterpret_cast<const uint8*>(Section.GetData()), Section.Num() * sizeof(T));
+		return Offset;
+	}
+
+	// Returns a typed view of a section, or an empty view if it doesn't fit in the snapshot
+	template <typename T>
+	TConstArrayView<T> GetSection(TConstArrayView<uint8> Bytes, const uint32 Offset, const uint32 Num)
+	{
+		if (Offset % alignof(T) != 0 || static_cast<uint64>(Offset) + static_cast<uint64>(Num) * sizeof(T) > static_cast<uint64>(Bytes.Num()))
+		{
+			return TConstArrayView<T>();
+		}
+		return TConstArrayView<T>(reinterpret_cast<const T*>(Bytes.GetData() + Offset), Num);
+	}
+}
+
+uint64 FFicsitPlannerRecipeIndex::ComputeSnapshotHash(const TArray<TSubclassOf<UFGRecipe>>& LoadedRecipes)
+{
+	// PART 1: Loaded recipe classes (sorted, the recipe manager's order isn't stable)
+	TArray<FString> Keys;
+	Keys.Reserve(LoadedRecipes.Num() + 16);
+	for (const TSubclassOf<UFGRecipe>& Recipe : LoadedRecipes)
+	{
+		if (Recipe) Keys.Add(Recipe->GetPathName());
+	}
+
+	// PART 2: Loaded mods and their versions
+	if (GEngine)
+	{
+		if (const UModLoadingLibrary* ModLoadingLibrary = GEngine->GetEngineSubsystem<UModLoadingLibrary>())
+		{
+			for (const FModInfo& Mod : ModLoadingLibrary->GetLoadedMods())
+			{
+				Keys.Add(FString::Printf(TEXT("mod:%s@%s"), *Mod.Name, *Mod.Version.ToString()));
+			}
+		}
+	}
+	Keys.Sort();
+
+	// PART 3: Hash everything, along with the format version
+	uint64 Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&SNAPSHOT_VERSION), sizeof(SNAPSHOT_VERSION), 0);
+	for (const FString& Key : Keys)
+	{
+		const FTCHARToUTF8 Utf8Key(*Key);
+		Hash = CityHash64WithSeed(Utf8Key.Get(), Utf8Key.Length(), Hash);
+	}
+	return Hash;
+}
+
+bool FFicsitPlannerRecipeIndex::SaveSnapshot(const FString& Path, const uint64 Hash) const
+{
+	using namespace FicsitPlannerSnapshot;
+
+	TArray<FItem> SnapshotItems;
+	TArray<FRecipe> SnapshotRecipes;
+	TArray<FFicsitPlannerItemRate> SnapshotRates;
+	TArray<ANSICHAR> SnapshotChars;
+
+	// Class paths go into a shared UTF-8 string table
+	const auto AddPath = [&SnapshotChars](const FString& Path, uint32& OutOffset, uint32& OutLength)
+	{
+		const FTCHARToUTF8 Utf8Path(*Path);
+		OutOffset = SnapshotChars.Num();
+		OutLength = Utf8Path.Length();
+		SnapshotChars.Append(Utf8Path.Get(), Utf8Path.Length());
+	};
+
+	// PART 1: Items
+	for (int32 Item = 0; Item < Tables->Items.Num(); ++Item)
+	{
+		FItem& SnapshotItem = SnapshotItems.AddZeroed_GetRef();
+		AddPath(Tables->Items[Item].Path, SnapshotItem.PathOffset, SnapshotItem.PathLength);
+		SnapshotItem.bRaw = Tables->RawItems[Item] ? 1 : 0;
+		SnapshotItem.bFluid = Tables->Items[Item].bFluid ? 1 : 0;
+	}
+
+	// PART 2: Recipes, with ingredients & products flattened into one rate pool
+	for (const FFicsitPlannerRecipeData& Recipe : Tables->Recipes)
+	{
+		FRecipe& SnapshotRecipe = SnapshotRecipes.AddZeroed_GetRef();
+		AddPath(Recipe.Path, SnapshotRecipe.PathOffset, SnapshotRecipe.PathLength);
+		SnapshotRecipe.FirstRate = SnapshotRates.Num();
+		SnapshotRecipe.NumIngredients = Recipe.Ingredients.Num();
+		SnapshotRecipe.NumProducts = Recipe.Products.Num();
+		SnapshotRecipe.Power = Recipe.Power;
+		if (Recipe.Building != INDEX_NONE) AddPath(Tables->BuildingPaths[Recipe.Building], SnapshotRecipe.BuildingOffset, SnapshotRecipe.BuildingLength);
+		SnapshotRates.Append(Recipe.Ingredients);
+		SnapshotRates.Append(Recipe.Products);
+	}
+
+	// PART 3: Write header & sections
+	TArray<uint8> Buffer;
+	Buffer.SetNumZeroed(sizeof(FHeader));
+	FHeader Header = {};
+	Header.Magic = MAGIC;
+	Header.Version = SNAPSHOT_VERSION;
+	Header.Hash = Hash;
+	Header.NumItems = SnapshotItems.Num();
+	Header.NumRecipes = SnapshotRecipes.Num();
+	Header.NumRates = SnapshotRates.Num();
+	Header.NumChars = SnapshotChars.Num();
+	Header.ItemsOffset = AppendSection(Buffer, SnapshotItems);
+	Header.RecipesOffset = AppendSection(Buffer, SnapshotRecipes);
+	Header.RatesOffset = AppendSection(Buffer, SnapshotRates);
+	Header.CharsOffset = AppendSection(Buffer, SnapshotChars);
+	Header.TotalSize = Buffer.Num();
+	FMemory::Memcpy(Buffer.GetData(), &Header, sizeof(FHeader));
+
+	return FFileHelper::SaveArrayToFile(Buffer, *Path);
+}
+
+bool FFicsitPlannerRecipeIndex::LoadSnapshot(const FString& Path, const uint64 Hash)
+{
+	using namespace FicsitPlannerSnapshot;
+
+	// PART 1: Map the snapshot (or read it, if the platform can't map files)
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.FileExists(*Path)) return false;
+
+	TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*Path));
+	TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile ? MappedFile->MapRegion() : nullptr);
+	TArray<uint8> FileData;
+	TConstArrayView<uint8> Bytes;
+	if (MappedRegion)
+	{
+		Bytes = TConstArrayView<uint8>(MappedRegion->GetMappedPtr(), static_cast<int32>(MappedRegion->GetMappedSize()));
+	}
+	else if (FFileHelper::LoadFileToArray(FileData, *Path))
+	{
+		Bytes = FileData;
+	}
+	else
+	{
+		return false;
+	}
+
+	// PART 2: Validate the header
+	if (Bytes.Num() < sizeof(FHeader)) return false;
+	FHeader Header;
+	FMemory::Memcpy(&Header, Bytes.GetData(), sizeof(FHeader));
+	if (Header.Magic != MAGIC || Header.Version != SNAPSHOT_VERSION || Header.Hash != Hash || Header.TotalSize != static_cast<uint64>(Bytes.Num()))
+	{
+		UE_LOG(LogFicsitPlannerEngine, Display, TEXT("Recipe snapshot %s is out of date, rebuilding."), *Path);
+		return false;
+	}
+
+	const TConstArrayView<FItem> SnapshotItems = GetSection<FItem>(Bytes, Header.ItemsOffset, Header.NumItems);
+	const TConstArrayView<FRecipe> SnapshotRecipes = GetSection<FRecipe>(Bytes, Header.RecipesOffset, Header.NumRecipes);
+	const TConstArrayView<FFicsitPlannerItemRate> SnapshotRates = GetSection<FFicsitPlannerItemRate>(Bytes, Header.RatesOffset, Header.NumRates);
+	const TConstArrayView<ANSICHAR> SnapshotChars = GetSection<ANSICHAR>(Bytes, Header.CharsOffset, Header.NumChars);
+	if (SnapshotItems.Num() != static_cast<int32>(Header.NumItems) || SnapshotRecipes.Num() != static_cast<int32>(Header.NumRecipes) ||
+		SnapshotRates.Num() != static_cast<int32>(Header.NumRates) || SnapshotChars.Num() != static_cast<int32>(Header.NumChars))
+	{
+		UE_LOG(LogFicsitPlannerEngine, Warning, TEXT("Recipe snapshot %s is corrupted, rebuilding."), *Path);
+		return false;
+	}
+
+	// Reads a class path from the string table
+	const auto ReadPath = [&SnapshotChars](const uint32 Offset, const uint32 Length) -> FString
+	{
+		if (static_cast<uint64>(Offset) + Length > static_cast<uint64>(SnapshotChars.Num())) return FString();
+		const FUTF8ToTCHAR ClassPath(SnapshotChars.GetData() + Offset, Length);
+		return FString(ClassPath.Length(), ClassPath.Get());
+	};
+
+	// Resolves a class path (classes are already loaded by the recipe manager)
+	const auto ResolveClass = [](const FString& ClassPath) -> UClass*
+	{
+		return ClassPath.IsEmpty() ? nullptr : FSoftClassPath(ClassPath).ResolveClass();
+	};
+
+	Reset();
+
+	// PART 3: Items (into new tables, shared once complete)
+	const TSharedRef<FFicsitPlannerRecipeTables, ESPMode::ThreadSafe> NewTables = MakeShared<FFicsitPlannerRecipeTables, ESPMode::ThreadSafe>();
+	NewTables->Items.Reserve(SnapshotItems.Num());
+	NewTables->RawItems.Reserve(SnapshotItems.Num());
+	for (const FItem& SnapshotItem : SnapshotItems)
+	{
+		FString ItemPath = ReadPath(SnapshotItem.PathOffset, SnapshotItem.PathLength);
+		const TSubclassOf<UFGItemDescriptor> ItemClass = ResolveClass(ItemPath);
+		if (!ItemClass) return false;
+		NewTables->AddItem({ItemClass, MoveTemp(ItemPath), ItemClass->GetDefaultObject<UFGItemDescriptor>()->mDisplayName.ToString(), SnapshotItem.bFluid != 0});
+		NewTables->RawItems.Add(SnapshotItem.bRaw != 0);
+	}
+
+	// PART 4: Recipes
+	NewTables->Recipes.Reserve(SnapshotRecipes.Num());
+	for (const FRecipe& SnapshotRecipe : SnapshotRecipes)
+	{
+		FString RecipePath = ReadPath(SnapshotRecipe.PathOffset, SnapshotRecipe.PathLength);
+		const TSubclassOf<UFGRecipe> RecipeClass = ResolveClass(RecipePath);
+		const uint64 LastRate = static_cast<uint64>(SnapshotRecipe.FirstRate) + SnapshotRecipe.NumIngredients + SnapshotRecipe.NumProducts;
+		if (!RecipeClass || LastRate > static_cast<uint64>(SnapshotRates.Num())) return false;
+
+		FFicsitPlannerRecipeData Recipe;
+		Recipe.Class = RecipeClass;
+		Recipe.Path = MoveTemp(RecipePath);
+		Recipe.Name = RecipeClass->GetDefaultObject<UFGRecipe>()->GetDisplayName().ToString();
+		Recipe.Power = SnapshotRecipe.Power;
+		if (SnapshotRecipe.BuildingLength > 0) Recipe.Building = NewTables->AddBuilding(ReadPath(SnapshotRecipe.BuildingOffset, SnapshotRecipe.BuildingLength));
+		Recipe.Ingredients.Append(SnapshotRates.Slice(SnapshotRecipe.FirstRate, SnapshotRecipe.NumIngredients));
+		Recipe.Products.Append(SnapshotRates.Slice(SnapshotRecipe.FirstRate + SnapshotRecipe.NumIngredients, SnapshotRecipe.NumProducts));
+		NewTables->AddRecipe(MoveTemp(Recipe));
+
+		// Item indices must point inside the item table
+		for (const FFicsitPlannerItemRate& Rate : SnapshotRates.Slice(SnapshotRecipe.FirstRate, SnapshotRecipe.NumIngredients + SnapshotRecipe.NumProducts))
+		{
+			if (!NewTables->Items.IsValidIndex(Rate.Item)) return false;
+		}
+	}
+
+	Tables = NewTables;
+	return true;
+}
+
+namespace FicsitPlannerSnapshot
+{
+	// Tables compiled or loaded last in this process, and their snapshot hash (shared by every world & reload loading the same recipes)
+	FCriticalSection SharedTablesLock;
+	TSharedPtr<const FFicsitPlannerRecipeTables, ESPMode::ThreadSafe> SharedTables;
+	uint64 SharedTablesHash = 0;
+}
+
+bool FFicsitPlannerRecipeIndex::LoadSharedTables(const uint64 Hash)
+{
+	using namespace FicsitPlannerSnapshot;
+
+	FScopeLock Lock(&SharedTablesLock);
+	if (!SharedTables || SharedTablesHash != Hash) return false;
+
+	// Unlock flags & masks are applied afterwards (SetUnlockedRecipes), like for a loaded snapshot
+	Reset();
+	Tables = SharedTables.ToSharedRef();
+	return true;
+}
+
+void FFicsitPlannerRecipeIndex::ShareTables(const uint64 Hash) const
+{
+	using namespace FicsitPlannerSnapshot;
+
+	// Replaces the previous tables (other worlds keep them while they hold them)
+	FScopeLock Lock(&SharedTablesLock);
+	SharedTables = Tables;
+	SharedTablesHash = Hash;
+}
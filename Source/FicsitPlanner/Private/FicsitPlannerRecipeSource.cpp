@@ -0,0 +1,192 @@
+#include "FicsitPlannerRecipeSource.h"
+
+#include "FicsitPlannerEngine.h"
+#include "FicsitPlannerRecipeIndex.h"
+#include "Dom/JsonObject.h"
+#include "Misc/FileHelper.h"
+#include "Resources/FGResourceDescriptor.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+FFicsitPlannerGameRecipeSource::FFicsitPlannerGameRecipeSource(const TArray<TSubclassOf<UFGRecipe>>& InRecipes, const TArray<TSubclassOf<UFGRecipe>>& InUnlockedRecipes)
+	: Recipes(InRecipes), UnlockedRecipes(InUnlockedRecipes)
+{
+}
+
+bool FFicsitPlannerGameRecipeSource::LoadRecipes(TArray<FFicsitPlannerSourceItem>& OutItems, TArray<FFicsitPlannerSourceRecipe>& OutRecipes) const
+{
+	TSet<TSubclassOf<UFGItemDescriptor>> AddedItems;
+
+	// Adds an item the first time it's used, and converts a per-craft amount to a per-minute rate
+	const auto AddRate = [&](const FItemAmount& Amount, const float CraftsPerMinute, TArray<FFicsitPlannerSourceRate>& OutRates)
+	{
+		if (!Amount.ItemClass) return;
+
+		bool bAlreadyAdded = false;
+		AddedItems.Add(Amount.ItemClass, &bAlreadyAdded);
+		if (!bAlreadyAdded)
+		{
+			FFicsitPlannerSourceItem& Item = OutItems.AddDefaulted_GetRef();
+			Item.Class = Amount.ItemClass;
+			Item.Path = Amount.ItemClass->GetPathName();
+			Item.Name = Amount.ItemClass->GetDefaultObject<UFGItemDescriptor>()->mDisplayName.ToString();
+			Item.bResource = Amount.ItemClass->IsChildOf(UFGResourceDescriptor::StaticClass());
+			const EResourceForm Form = UFGItemDescriptor::GetForm(Amount.ItemClass);
+			Item.bFluid = Form == EResourceForm::RF_LIQUID || Form == EResourceForm::RF_GAS;
+		}
+
+		OutRates.Add({Amount.ItemClass->GetPathName(), Amount.Amount * CraftsPerMinute});
+	};
+
+	OutRecipes.Reserve(OutRecipes.Num() + Recipes.Num());
+	for (const TSubclassOf<UFGRecipe>& Recipe : Recipes)
+	{
+		if (!Recipe) continue;
+
+		// Convert per-craft amounts to per-minute rates
+		const UFGRecipe* RecipeObj = Recipe->GetDefaultObject<UFGRecipe>();
+		const float CraftDuration = RecipeObj->GetManufacturingDuration();
+		const float CraftsPerMinute = CraftDuration > 0.0f ? 60.0f / CraftDuration : 0.0f;
+
+		FFicsitPlannerSourceRecipe& SourceRecipe = OutRecipes.AddDefaulted_GetRef();
+		SourceRecipe.Class = Recipe;
+		SourceRecipe.Path = Recipe->GetPathName();
+		SourceRecipe.Name = RecipeObj->GetDisplayName().ToString();
+		SourceRecipe.Power = AFicsitPlannerEngine::GetFactoryPowerConsumption(Recipe, 1.0f);
+		if (const TSubclassOf<UObject> Building = AFicsitPlannerEngine::GetRecipeBuilding(Recipe)) SourceRecipe.BuildingPath = Building->GetPathName();
+		SourceRecipe.bUnlocked = UnlockedRecipes.Contains(Recipe);
+		for (const FItemAmount& Ingredient : RecipeObj->GetIngredients()) AddRate(Ingredient, CraftsPerMinute, SourceRecipe.Ingredients);
+		for (const FItemAmount& Product : RecipeObj->GetProducts()) AddRate(Product, CraftsPerMinute, SourceRecipe.Products);
+	}
+
+	return true;
+}
+
+FFicsitPlannerJsonRecipeSource::FFicsitPlannerJsonRecipeSource(const FString& InPath)
+	: Path(InPath)
+{
+}
+
+bool FFicsitPlannerJsonRecipeSource::LoadRecipes(TArray<FFicsitPlannerSourceItem>& OutItems, TArray<FFicsitPlannerSourceRecipe>& OutRecipes) const
+{
+	// PART 1: Read & parse the file
+	FString JsonString;
+	if (!FFileHelper::LoadFileToString(JsonString, *Path))
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to read recipe data %s!"), *Path);
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Root;
+	if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(JsonString), Root) || !Root.IsValid())
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Failed to parse recipe data %s!"), *Path);
+		return false;
+	}
+
+	if (Root->GetIntegerField(TEXT("version")) != JSON_VERSION)
+	{
+		UE_LOG(LogFicsitPlannerEngine, Error, TEXT("Unsupported recipe data version in %s!"), *Path);
+		return false;
+	}
+
+	// PART 2: Items
+	for (const TSharedPtr<FJsonValue>& ItemValue : Root->GetArrayField(TEXT("items")))
+	{
+		const TSharedPtr<FJsonObject> ItemObject = ItemValue->AsObject();
+		if (!ItemObject.IsValid()) continue;
+
+		FFicsitPlannerSourceItem& Item = OutItems.AddDefaulted_GetRef();
+		Item.Path = ItemObject->GetStringField(TEXT("path"));
+		Item.Name = ItemObject->GetStringField(TEXT("name"));
+		Item.bResource = ItemObject->GetBoolField(TEXT("resource"));
+		ItemObject->TryGetBoolField(TEXT("fluid"), Item.bFluid);
+	}
+
+	// PART 3: Recipes
+	const auto ReadRates = [](const TArray<TSharedPtr<FJsonValue>>& RateValues, TArray<FFicsitPlannerSourceRate>& OutRates)
+	{
+		for (const TSharedPtr<FJsonValue>& RateValue : RateValues)
+		{
+			if (const TSharedPtr<FJsonObject> RateObject = RateValue->AsObject())
+			{
+				OutRates.Add({RateObject->GetStringField(TEXT("item")), static_cast<float>(RateObject->GetNumberField(TEXT("rate")))});
+			}
+		}
+	};
+
+	for (const TSharedPtr<FJsonValue>& RecipeValue : Root->GetArrayField(TEXT("recipes")))
+	{
+		const TSharedPtr<FJsonObject> RecipeObject = RecipeValue->AsObject();
+		if (!RecipeObject.IsValid()) continue;
+
+		FFicsitPlannerSourceRecipe& Recipe = OutRecipes.AddDefaulted_GetRef();
+		Recipe.Path = RecipeObject->GetStringField(TEXT("path"));
+		Recipe.Name = RecipeObject->GetStringField(TEXT("name"));
+		Recipe.Power = RecipeObject->GetNumberField(TEXT("power"));
+		Recipe.bUnlocked = RecipeObject->GetBoolField(TEXT("unlocked"));
+		RecipeObject->TryGetStringField(TEXT("building"), Recipe.BuildingPath);
+		ReadRates(RecipeObject->GetArrayField(TEXT("ingredients")), Recipe.Ingredients);
+		ReadRates(RecipeObject->GetArrayField(TEXT("products")), Recipe.Products);
+	}
+
+	return true;
+}
+
+bool FFicsitPlannerJsonRecipeSource::SaveIndex(const FFicsitPlannerRecipeIndex& Index, const FString& Path)
+{
+	FString JsonString;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonString);
+
+	const auto WriteRates = [&](const TCHAR* Field, const TArray<FFicsitPlannerItemRate>& Rates)
+	{
+		Writer->WriteArrayStart(Field);
+		for (const FFicsitPlannerItemRate& Rate : Rates)
+		{
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("item"), Index.GetItem(Rate.Item).Path);
+			Writer->WriteValue(TEXT("rate"), Rate.Rate);
+			Writer->WriteObjectEnd();
+		}
+		Writer->WriteArrayEnd();
+	};
+
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("version"), JSON_VERSION);
+
+	// PART 1: Items
+	Writer->WriteArrayStart(TEXT("items"));
+	for (int32 Item = 0; Item < Index.NumItems(); ++Item)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("path"), Index.GetItem(Item).Path);
+		Writer->WriteValue(TEXT("name"), Index.GetItem(Item).Name);
+		Writer->WriteValue(TEXT("resource"), Index.IsRawItem(Item));
+		Writer->WriteValue(TEXT("fluid"), Index.GetItem(Item).bFluid);
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	// PART 2: Recipes
+	Writer->WriteArrayStart(TEXT("recipes"));
+	for (int32 Recipe = 0; Recipe < Index.NumRecipes(); ++Recipe)
+	{
+		const FFicsitPlannerRecipeData& RecipeData = Index.GetRecipe(Recipe);
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("path"), RecipeData.Path);
+		Writer->WriteValue(TEXT("name"), RecipeData.Name);
+		Writer->WriteValue(TEXT("power"), RecipeData.Power);
+		Writer->WriteValue(TEXT("unlocked"), Index.IsRecipeUnlocked(Recipe));
+		if (RecipeData.Building != INDEX_NONE) Writer->WriteValue(TEXT("building"), Index.GetBuildingPath(RecipeData.Building));
+		WriteRates(TEXT("ingredients"), RecipeData.Ingredients);
+		WriteRates(TEXT("products"), RecipeData.Products);
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	return FFileHelper::SaveStringToFile(JsonString, *Path, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+}
@@ -0,0 +1,62 @@
+#include "FicsitPlannerCore.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFicsitPlannerFindTopPlansTest, "FicsitPlanner.Core.FindTopPlans",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+bool FFicsitPlannerFindTopPlansTest::RunTest(const FString& Parameters)
+{
+	// Root recipe (1 MW) with two group inputs: (2 MW | 5 MW) and (1 MW | 4 MW), so the plans cost 4, 7, 7 and 10 MW
+	// Ranking only reads the plan's metrics, so no recipe data is needed
+	const auto AddNode = [](FFicsitPlannerPlan& Plan, const float Power, const TArray<int32>& Children, const TArray<int32>& Alternatives)
+	{
+		FFicsitPlannerPlanNode& Node = Plan.Nodes.AddDefaulted_GetRef();
+		Node.Recipe = Alternatives.Num() > 0 ? INDEX_NONE : 0;
+		Node.Power = Power;
+		Node.Children = Children;
+		Node.Alternatives = Alternatives;
+		Node.Selected = Alternatives.Num() > 0 ? 0 : INDEX_NONE;
+	};
+	FFicsitPlannerPlan Plan;
+	AddNode(Plan, 1.0f, {1, 4}, {});
+	AddNode(Plan, 0.0f, {}, {2, 3});
+	AddNode(Plan, 2.0f, {}, {});
+	AddNode(Plan, 5.0f, {}, {});
+	AddNode(Plan, 0.0f, {}, {5, 6});
+	AddNode(Plan, 1.0f, {}, {});
+	AddNode(Plan, 4.0f, {}, {});
+
+	FFicsitPlannerRecipeIndex Index;
+	const FFicsitPlannerCore Core(Index);
+	TArray<FFicsitPlannerRankedPlan> RankedPlans;
+	Core.FindTopPlans(Plan, EFactoryOptimizationType::EFOT_PowerConsumption, 10, RankedPlans);
+
+	// Every distinct plan once, best first (no more than there are)
+	if (!TestEqual(TEXT("Plans"), RankedPlans.Num(), 4)) return false;
+	const double ExpectedPower[] = {4.0, 7.0, 7.0, 10.0};
+	TSet<int32> Seen;
+	for (int32 Rank = 0; Rank < RankedPlans.Num(); ++Rank)
+	{
+		TestEqual(FString::Printf(TEXT("Power of plan %d"), Rank), RankedPlans[Rank].TotalPower, ExpectedPower[Rank]);
+		TestEqual(FString::Printf(TEXT("Groups selected by plan %d"), Rank), RankedPlans[Rank].Selections.Num(), 2);
+
+		// Both groups' alternatives, as one key
+		int32 Key = 0;
+		for (const TPair<int32, int32>& Selection : RankedPlans[Rank].Selections) Key += Selection.Value * (Selection.Key == 1 ? 1 : 2);
+		bool bSeen = false;
+		Seen.Add(Key, &bSeen);
+		TestFalse(FString::Printf(TEXT("Plan %d is distinct"), Rank), bSeen);
+	}
+
+	// The best plan takes the first alternative of both groups
+	TestTrue(TEXT("Best selections"), RankedPlans[0].Selections.Contains(TPair<int32, int32>(1, 0)) && RankedPlans[0].Selections.Contains(TPair<int32, int32>(4, 0)));
+
+	// Fewer plans asked for than there are
+	Core.FindTopPlans(Plan, EFactoryOptimizationType::EFOT_PowerConsumption, 1, RankedPlans);
+	TestEqual(TEXT("Top 1"), RankedPlans.Num(), 1);
+	return true;
+}
+
+#endif
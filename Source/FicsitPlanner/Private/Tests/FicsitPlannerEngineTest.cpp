@@ -0,0 +1,46 @@
+#include "FicsitPlannerEngine.h"
+#include "FicsitPlannerFactory.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFicsitPlannerFactoryIDTest, "FicsitPlanner.Engine.FactoryIDs",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+bool FFicsitPlannerFactoryIDTest::RunTest(const FString& Parameters)
+{
+	// Stale & unknown IDs are refused (and logged)
+	AddExpectedError(TEXT("Invalid factory ID"), EAutomationExpectedErrorFlags::Contains, 0);
+
+	// Only the factory store is used (no world or recipe data needed)
+	AFicsitPlannerEngine* Engine = NewObject<AFicsitPlannerEngine>();
+	UFicsitPlannerFactory* FactoryA = NewObject<UFicsitPlannerFactory>();
+	UFicsitPlannerFactory* FactoryB = NewObject<UFicsitPlannerFactory>();
+	UFicsitPlannerFactory* FactoryC = NewObject<UFicsitPlannerFactory>();
+
+	const int IDA = Engine->SaveFactory(FactoryA);
+	const int IDB = Engine->SaveFactory(FactoryB);
+	TestNotEqual(TEXT("Distinct IDs"), IDA, IDB);
+	TestTrue(TEXT("Get A"), Engine->GetFactory(IDA) == FactoryA);
+	TestTrue(TEXT("Get B"), Engine->GetFactory(IDB) == FactoryB);
+
+	// Deleting A moves B into its entry, B's ID still resolves and A's is stale
+	TestTrue(TEXT("Delete A"), Engine->DeleteFactory(IDA));
+	TestTrue(TEXT("Get B after delete"), Engine->GetFactory(IDB) == FactoryB);
+	TestNull(TEXT("Get deleted A"), Engine->GetFactory(IDA));
+	TestFalse(TEXT("Delete A twice"), Engine->DeleteFactory(IDA));
+
+	// C reuses A's slot with a new generation, so A's ID stays stale
+	const int IDC = Engine->SaveFactory(FactoryC);
+	TestNotEqual(TEXT("Reused slot gets a new ID"), IDC, IDA);
+	TestTrue(TEXT("Get C"), Engine->GetFactory(IDC) == FactoryC);
+	TestNull(TEXT("Get stale A after reuse"), Engine->GetFactory(IDA));
+	TestEqual(TEXT("Saved factories"), Engine->GetAllFactoryIDs().Num(), 2);
+
+	// Unknown IDs
+	TestNull(TEXT("Negative ID"), Engine->GetFactory(-1));
+	TestNull(TEXT("Unused slot"), Engine->GetFactory(IDC + 100));
+	return true;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#include "FicsitPlannerFactoryGroup.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFicsitPlannerFindMinWeightedIndexTest, "FicsitPlanner.FactoryGroup.FindMinWeightedIndex",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+bool FFicsitPlannerFindMinWeightedIndexTest::RunTest(const FString& Parameters)
+{
+	const float Inf = std::numeric_limits<float>::infinity();
+	const float NaN = std::numeric_limits<float>::quiet_NaN();
+	const TArray<int> NoComplexity = {0, 0, 0, 0, 0, 0};
+
+	// Empty lists have no best index
+	TestEqual(TEXT("Empty"), UFicsitPlannerFactoryGroup::FindMinWeightedIndex({}, {}, 1.0f, 0.0f), INDEX_NONE);
+
+	// Lowest score wins, ties go to the lowest index (vectorized body & scalar tail)
+	const TArray<float> Power = {5.0f, 3.0f, 4.0f, 3.0f, 1.0f, 1.0f};
+	TestEqual(TEXT("Lowest"), UFicsitPlannerFactoryGroup::FindMinWeightedIndex(Power, NoComplexity, 1.0f, 0.0f), 4);
+	TestEqual(TEXT("Tie"), UFicsitPlannerFactoryGroup::FindMinWeightedIndex(MakeArrayView(Power).Left(4), MakeArrayView(NoComplexity).Left(4), 1.0f, 0.0f), 1);
+
+	// Scores at or over MAX_flt (inf, overflowed, NaN) still select a valid index
+	const TArray<float> InfPower = {Inf, Inf, Inf, Inf, Inf, Inf};
+	TestEqual(TEXT("All inf"), UFicsitPlannerFactoryGroup::FindMinWeightedIndex(InfPower, NoComplexity, 1.0f, 0.0f), 0);
+	TestEqual(TEXT("All inf (4)"), UFicsitPlannerFactoryGroup::FindMinWeightedIndex(MakeArrayView(InfPower).Left(4), MakeArrayView(NoComplexity).Left(4), 1.0f, 0.0f), 0);
+	TestEqual(TEXT("Overflowed"), UFicsitPlannerFactoryGroup::FindMinWeightedIndex(TArray<float>{MAX_flt, MAX_flt}, TArray<int>{0, 0}, 2.0f, 0.0f), 0);
+
+	const TArray<float> NaNPower = {NaN, Inf, Inf, Inf, 2.0f, NaN};
+	TestEqual(TEXT("NaN first"), UFicsitPlannerFactoryGroup::FindMinWeightedIndex(NaNPower, NoComplexity, 1.0f, 0.0f), 4);
+	return true;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include "FicsitPlannerFactoryTree.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFicsitPlannerFactoryTreeVisibleRowsTest, "FicsitPlanner.FactoryTree.GetVisibleRows",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+bool FFicsitPlannerFactoryTreeVisibleRowsTest::RunTest(const FString& Parameters)
+{
+	// Root -> (A -> (A1 -> A1a, A2), B -> B1), uneven depths so the seek has to skip whole subtrees
+	const auto MakeNode = [](const TArray<UFicsitPlannerFactory*>& Inputs)
+	{
+		UFicsitPlannerFactory* Node = NewObject<UFicsitPlannerFactory>();
+		Node->GetSubfactories()->Append(Inputs);
+		return Node;
+	};
+	UFicsitPlannerFactory* A1 = MakeNode({MakeNode({})});
+	UFicsitPlannerFactory* A = MakeNode({A1, MakeNode({})});
+	UFicsitPlannerFactory* B = MakeNode({MakeNode({})});
+	UFicsitPlannerFactory* Root = MakeNode({A, B});
+
+	FFicsitPlannerFactoryTree Tree;
+	Tree.Build(Root);
+	TestTrue(TEXT("Built"), Tree.IsBuiltFor(Root));
+	TestEqual(TEXT("Nodes"), Tree.Num(), 7);
+
+	// Every expansion (any set of expanded nodes, at every depth limit), against a plain preorder scan
+	TArray<int32> Expected;
+	TArray<int32> Window;
+	for (int32 MaxDepth = 0; MaxDepth <= 3; ++MaxDepth)
+	{
+		for (int32 Mask = 0; Mask < (1 << Tree.Num()); ++Mask)
+		{
+			TSet<int32> ExpandedNodeIDs;
+			for (int32 Node = 0; Node < Tree.Num(); ++Node)
+			{
+				if (Mask & (1 << Node)) ExpandedNodeIDs.Add(Node + 1);
+			}
+			Tree.SetExpansion(ExpandedNodeIDs, MaxDepth);
+
+			// Visible nodes: every ancestor expanded
+			Expected.Reset();
+			for (int32 Node = 0; Node < Tree.Num(); ++Node)
+			{
+				bool bVisible = true;
+				for (int32 Parent = Tree.GetParent(Node); Parent != INDEX_NONE && bVisible; Parent = Tree.GetParent(Parent)) bVisible = Tree.IsExpanded(Parent);
+				if (bVisible) Expected.Add(Node);
+			}
+
+			const FString Context = FString::Printf(TEXT("MaxDepth %d, expanded mask %d"), MaxDepth, Mask);
+			if (!TestEqual(Context + TEXT(": visible rows"), Tree.NumVisibleRows(), Expected.Num())) return false;
+
+			// Every window, including ones running past the end
+			for (int32 FirstRow = 0; FirstRow < Expected.Num(); ++FirstRow)
+			{
+				for (int32 NumRows = 1; FirstRow + NumRows <= Expected.Num() + 1; ++NumRows)
+				{
+					Tree.GetVisibleRows(FirstRow, NumRows, Window);
+					TArray<int32> ExpectedWindow;
+					for (int32 Row = FirstRow; Row < FMath::Min(FirstRow + NumRows, Expected.Num()); ++Row) ExpectedWindow.Add(Expected[Row]);
+					if (!TestTrue(FString::Printf(TEXT("%s: rows [%d, %d)"), *Context, FirstRow, FirstRow + NumRows), Window == ExpectedWindow)) return false;
+				}
+			}
+		}
+	}
+
+	// Out of range windows are empty
+	Tree.SetExpansion({}, 3);
+	Tree.GetVisibleRows(Tree.NumVisibleRows(), 4, Window);
+	TestEqual(TEXT("Past the end"), Window.Num(), 0);
+	Tree.GetVisibleRows(-1, 4, Window);
+	TestEqual(TEXT("Negative first row"), Window.Num(), 0);
+	return true;
+}
+
+#endif
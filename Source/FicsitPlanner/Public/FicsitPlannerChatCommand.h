@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Command/ChatCommandInstance.h"
+#include "FicsitPlannerChatCommand.generated.h"
+
+class AFicsitPlannerEngine;
+
+/**
+ * Chat command for the planner's extended CLI (/planner <command> [arguments]).
+ * Registered by AFicsitPlannerEngine::Initialize.
+ */
+UCLASS()
+class FICSITPLANNER_API AFicsitPlannerChatCommand : public AChatCommandInstance
+{
+	GENERATED_BODY()
+
+public:
+	// Constructor
+	AFicsitPlannerChatCommand();
+
+	// Command execution
+	virtual EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+
+private:
+	// Helpers
+	AFicsitPlannerEngine* GetEngine() const;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FFicsitPlannerRecipeIndex;
+
+/**
+ * Limits for clock speed planning, over a whole plan.
+ */
+struct FICSITPLANNER_API FFicsitPlannerClockLimits
+{
+	// Buildings available (0 = one building per started 100%, i.e. only underclock the last one)
+	int32 MaxBuildings = 0;
+
+	// Power shards available (each one allows +50% clock speed on one building)
+	int32 MaxShards = 0;
+
+	// Lowest clock speed a building may run at (1 = 100%)
+	float MinClockSpeed = 0.01f;
+};
+
+/**
+ * Buildings running one recipe for one plan node, all at the same clock speed.
+ */
+struct FICSITPLANNER_API FFicsitPlannerMachineGroup
+{
+	// Input (recipe, total multiplier & power at 100% for a multiplier of 1)
+	int32 Recipe = INDEX_NONE;
+	float Multiplier = 0.0f;
+	float BasePower = 0.0f;
+
+	// Output
+	int32 Buildings = 0;
+	float ClockSpeed = 0.0f;
+	int32 Shards = 0;
+	float Power = 0.0f;
+};
+
+/**
+ * Building counts & clock speeds for every recipe node of a plan.
+ */
+struct FICSITPLANNER_API FFicsitPlannerClockPlan
+{
+	TArray<FFicsitPlannerMachineGroup> Groups;
+	int32 TotalBuildings = 0;
+	int32 TotalShards = 0;
+	float TotalPower = 0.0f;
+
+	// Power as estimated by the planner (linear in the multiplier)
+	float LinearPower = 0.0f;
+
+	// False if the limits couldn't be met (too few buildings / shards for the plan)
+	bool bWithinLimits = true;
+};
+
+/**
+ * Clock speed planning: picks the building count & clock speed of every machine group to minimize total power.
+ * Power grows with ClockSpeed ^ POWER_EXPONENT, so running more buildings slower always saves power:
+ * for a fixed building count, equal clock speeds are optimal, and the power saved by each extra building shrinks (convex).
+ * Buildings are handed out greedily (largest saving first), which is optimal for a building budget.
+ */
+class FICSITPLANNER_API FFicsitPlannerClockSpeed
+{
+public:
+	// Game rules
+	static constexpr float POWER_EXPONENT = 1.321928f;
+	static constexpr float MAX_CLOCK_SPEED = 2.5f;
+	static constexpr float SHARD_CLOCK_SPEED = 0.5f;
+
+	// Power (MW) of a machine group, and the shards it needs (per building, equal clock speeds)
+	static float GetPower(float BasePower, float Multiplier, int32 Buildings);
+	static int32 GetShards(float Multiplier, int32 Buildings);
+
+	// Fills the output of every group (inputs must be set) & the plan totals
+	static void Solve(FFicsitPlannerClockPlan& Plan, const FFicsitPlannerClockLimits& Limits);
+
+	// Output
+	static FString ToString(const FFicsitPlannerClockPlan& Plan, const FFicsitPlannerRecipeIndex& Index);
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "FicsitPlannerCommandlet.generated.h"
+
+/**
+ * Headless planner, running the planner core on exported game data (see AFicsitPlannerEngine::ExportGameData).
+ * Usage: -run=FicsitPlanner -Data=<GameData.json> -Targets="<Item>:<Rate>,..." [-TargetsFile=<file>] [-Optimize=power|complexity|clock] [-MaxBuildings=<N>] [-MaxShards=<N>] [-BeltTier=<N>] [-PipeTier=<N>] [-Locked] [-Flatten] [-Repeat=<N>] [-NoCache] [-Optimal] [-Format=json|csv] [-Output=<file>]
+ */
+UCLASS()
+class FICSITPLANNER_API UFicsitPlannerCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	// Constructor
+	UFicsitPlannerCommandlet();
+
+	// Commandlet entry point, returns 0 if every target was planned
+	virtual int32 Main(const FString& Params) override;
+};
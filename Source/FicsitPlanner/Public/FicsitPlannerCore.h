@@ -0,0 +1,334 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/ScopeRWLock.h"
+#include <atomic>
+#include "FicsitPlannerClockSpeed.h"
+#include "FicsitPlannerFactory.h"
+#include "FicsitPlannerLogistics.h"
+#include "FicsitPlannerPlanWriter.h"
+#include "FicsitPlannerRecipeIndex.h"
+
+DECLARE_LOG_CATEGORY_CLASS(LogFicsitPlannerCore, Log, All);
+
+/**
+ * Node of a plan made by FFicsitPlannerCore.
+ * Nodes are stored flat in FFicsitPlannerPlan, children & alternatives are node indices.
+ */
+struct FICSITPLANNER_API FFicsitPlannerPlanNode
+{
+	// Produced item & rate (items / min)
+	int32 Item = INDEX_NONE;
+	float Rate = 0.0f;
+
+	// Recipe, and loop solution index (in the recipe graph's loops for the item) for loop nodes
+	int32 Recipe = INDEX_NONE;
+	int32 Loop = INDEX_NONE;
+
+	// Metrics of this node alone (selected alternative for groups)
+	float Multiplier = 0.0f;
+	float Power = 0.0f;
+	int32 Complexity = 0;
+
+	// Inputs, and alternatives (groups only)
+	TArray<int32> Children;
+	TArray<int32> Alternatives;
+	int32 Selected = INDEX_NONE;
+
+	// Metrics including inputs (selected alternative for groups)
+	float TotalPower = 0.0f;
+	int32 TotalComplexity = 0;
+
+	bool IsGroup() const { return Alternatives.Num() > 0; }
+	bool IsLoop() const { return Loop != INDEX_NONE; }
+
+	// Leaf input (raw resource, or no recipe left to produce it on this branch)
+	bool IsInput() const { return Recipe == INDEX_NONE && !IsGroup(); }
+};
+
+/**
+ * Plan made by FFicsitPlannerCore, Nodes[0] is the root.
+ */
+struct FICSITPLANNER_API FFicsitPlannerPlan
+{
+	TArray<FFicsitPlannerPlanNode> Nodes;
+	bool bAllowLockedRecipes = false;
+
+	// Recipe index its IDs refer to (the one it was planned with)
+	const FFicsitPlannerRecipeIndex* Index = nullptr;
+	// Node a walker follows: a group's selected alternative (nullptr if its selection is out of range), the node itself otherwise
+	const FFicsitPlannerPlanNode* GetSelectedNode(const FFicsitPlannerPlanNode& Node) const;
+};
+
+/**
+ * Recipe used by a flattened plan, summed over every node using it.
+ */
+struct FICSITPLANNER_API FFicsitPlannerRecipeUse
+{
+	int32 Recipe = INDEX_NONE;
+	float Multiplier = 0.0f;
+	float Power = 0.0f;
+};
+
+/**
+ * Flattened plan (bill of materials), following the selected alternative of every group.
+ */
+struct FICSITPLANNER_API FFicsitPlannerBillOfMaterials
+{
+	TArray<FFicsitPlannerRecipeUse> Recipes;
+	TArray<FFicsitPlannerItemRate> Inputs;
+	TArray<FFicsitPlannerItemRate> Byproducts;
+	float TotalPower = 0.0f;
+	int32 TotalComplexity = 0;
+};
+
+/**
+ * Item x recipe flow matrix of a flattened plan, stored sparse by column: each recipe's column holds its products (positive) and
+ * ingredients (negative) per minute at 1x, so the net flow of every item is the matrix times the recipe multipliers.
+ */
+struct FICSITPLANNER_API FFicsitPlannerFlowMatrix
+{
+	// Column c (recipe Recipes[c], run at Multipliers[c]) spans [ColumnStarts[c], ColumnStarts[c + 1]) of Items & Rates
+	TArray<int32> Recipes;
+	TArray<float> Multipliers;
+	TArray<int32> ColumnStarts;
+	TArray<int32> Items;
+	TArray<float> Rates;
+};
+
+/**
+ * Net flow of an item over a plan (per minute).
+ */
+struct FICSITPLANNER_API FFicsitPlannerItemBalance
+{
+	int32 Item = INDEX_NONE;
+	float Produced = 0.0f;
+	float Consumed = 0.0f;
+
+	float GetNet() const { return Produced - Consumed; }
+};
+
+/**
+ * Balance of a plan (see FFicsitPlannerCore::CheckBalance): items consumed more than produced (deficits), produced more than
+ * consumed (surpluses, the target's output excluded) and raw inputs (raw & excluded items, expected to be consumed).
+ */
+struct FICSITPLANNER_API FFicsitPlannerBalanceReport
+{
+	int32 TargetItem = INDEX_NONE;
+	float TargetRate = 0.0f;
+
+	TArray<FFicsitPlannerItemBalance> Deficits;
+	TArray<FFicsitPlannerItemBalance> Surpluses;
+	TArray<FFicsitPlannerItemBalance> RawInputs;
+	int32 NumItems = 0;
+
+	bool IsBalanced() const { return Deficits.Num() == 0; }
+};
+
+/**
+ * Value of unlocking a locked recipe (see FFicsitPlannerCore::RankLockedRecipes): what making one of its products with it,
+ * from optimal ingredients, would save over the current best way of making that product.
+ */
+struct FICSITPLANNER_API FFicsitPlannerRecipeValue
+{
+	int32 Recipe = INDEX_NONE;
+
+	// Product it would make, and how much of it is needed (per minute)
+	int32 Item = INDEX_NONE;
+	float Demand = 0.0f;
+
+	// Saved in total, and per unit of the product (MW, buildings or raw items / min, by metric)
+	float Saving = 0.0f;
+	float UnitSaving = 0.0f;
+
+	// False if an ingredient's cost is only a lower bound (unsolved cycles), or depends on the product itself
+	bool bExact = true;
+};
+
+/**
+ * One of the K best selections of a plan (see FFicsitPlannerCore::FindTopPlans).
+ */
+struct FICSITPLANNER_API FFicsitPlannerRankedPlan
+{
+	// Objective score (weighted power & complexity) and totals
+	double Score = 0.0;
+	double TotalPower = 0.0;
+	int64 TotalComplexity = 0;
+
+	// Selected alternative of every group this selection reaches (group node, alternative), other groups don't matter
+	TArray<TPair<int32, int32>> Selections;
+};
+
+/**
+ * Size of the plan CreatePlan would make, counted without building it.
+ * Counts are doubles, as full plans can grow exponentially with the recipe depth.
+ */
+struct FICSITPLANNER_API FFicsitPlannerPlanEstimate
+{
+	// Plan nodes (leaf inputs & groups included)
+	double Nodes = 0.0;
+	double Inputs = 0.0;
+	double Groups = 0.0;
+
+	// Heap bytes of the plan's nodes
+	double Bytes = 0.0;
+
+	// Distinct sub-plans counted
+	int32 SubPlans = 0;
+
+	// False if the sub-plan budget ran out first (counts are lower bounds)
+	bool bComplete = true;
+};
+
+/**
+ * Key of a sub-plan: its item, and the visited recipes that could change its expansion (visited recipes reachable from the item).
+ * Two expansions with the same key make the same sub-plan, whatever the rest of the path was.
+ */
+struct FICSITPLANNER_API FFicsitPlannerSubPlanKey
+{
+	int32 Item = INDEX_NONE;
+	TArray<int32> VisitedRecipes;
+
+	static FFicsitPlannerSubPlanKey Make(const FFicsitPlannerRecipeGraph& Graph, int32 Item, const TArray<int32>& VisitedRecipes);
+
+	bool operator==(const FFicsitPlannerSubPlanKey& Other) const { return Item == Other.Item && VisitedRecipes == Other.VisitedRecipes; }
+	friend uint32 GetTypeHash(const FFicsitPlannerSubPlanKey& Key)
+	{
+		uint32 Hash = ::GetTypeHash(Key.Item);
+		for (const int32 Recipe : Key.VisitedRecipes) Hash = HashCombine(Hash, ::GetTypeHash(Recipe));
+		return Hash;
+	}
+};
+
+/**
+ * Sub-plans shared between plans (e.g. a batch), for one lock mode. Thread-safe.
+ * Sub-plans are stored for 1 / min of their item, keyed by FFicsitPlannerSubPlanKey, so a cached sub-plan is exactly what expanding it again would give.
+ */
+class FICSITPLANNER_API FFicsitPlannerPlanCache
+{
+public:
+	// Cache budget (nodes over all cached sub-plans)
+	static constexpr int32 MAX_CACHED_NODES = 1 << 20;
+
+	FFicsitPlannerPlanCache(const FFicsitPlannerRecipeIndex& Index, bool bInAllowLockedRecipes);
+
+	bool AllowsLockedRecipes() const { return bAllowLockedRecipes; }
+
+	// Lookups (Add returns the cached sub-plan, which may have been added by another thread first)
+	TSharedPtr<const FFicsitPlannerPlan> Find(int32 Item, const TArray<int32>& VisitedRecipes) const;
+	TSharedPtr<const FFicsitPlannerPlan> Add(int32 Item, const TArray<int32>& VisitedRecipes, TSharedPtr<const FFicsitPlannerPlan> Fragment);
+
+	// Stats
+	int32 GetHits() const { return Hits.load(std::memory_order_relaxed); }
+	int32 GetMisses() const { return Misses.load(std::memory_order_relaxed); }
+	int32 GetCachedNodes() const { return CachedNodes; }
+
+private:
+	bool bAllowLockedRecipes;
+	const FFicsitPlannerRecipeGraph& Graph;
+
+	// Cached sub-plans
+	TMap<FFicsitPlannerSubPlanKey, TSharedPtr<const FFicsitPlannerPlan>> Fragments;
+	mutable FRWLock Lock;
+	int32 CachedNodes = 0;
+	mutable std::atomic<int32> Hits = 0;
+	mutable std::atomic<int32> Misses = 0;
+};
+
+/**
+ * Planner core, working on a compiled recipe index only (no recipe CDOs, recipe manager or UObjects).
+ * Follows the same rules as AFicsitPlannerEngine::CreateFactoryNode, so it can run outside the game (see UFicsitPlannerCommandlet).
+ * Rates are kept as floats instead of being rounded to whole items at every node.
+ */
+class FICSITPLANNER_API FFicsitPlannerCore
+{
+public:
+	// Complexity weights (same as UFicsitPlannerFactory)
+	static constexpr int32 RECIPE_COMPLEXITY = 10;
+	static constexpr int32 BUILDING_COMPLEXITY = 1;
+
+	explicit FFicsitPlannerCore(const FFicsitPlannerRecipeIndex& InIndex) : Index(InIndex) {}
+
+	// Create (every alternative is expanded, then the best one is selected unless Optimization is None)
+	// Sub-plans are taken from / added to the cache, if given (and made for the same lock mode)
+	bool CreatePlan(int32 Item, float Rate, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, FFicsitPlannerPlan& OutPlan, FFicsitPlannerPlanCache* Cache = nullptr) const;
+
+	// Create the least-power plan straight from the unit cost table, in O(plan size) (no alternatives, power-weighted objectives only)
+	// Falls back to CreatePlan when a cycle without solved loops is reachable, as the table only has lower bounds there
+	bool CreateOptimalPlan(int32 Item, float Rate, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, FFicsitPlannerPlan& OutPlan) const;
+
+	// Whether CreateOptimalPlan plans that objective from the table (power-weighted objectives, exact unit cost), without falling back
+	bool SupportsOptimalPlan(int32 Item, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization) const;
+
+	// Estimate (counts the nodes CreatePlan would make in O(distinct sub-plans), memoized by FFicsitPlannerSubPlanKey)
+	static constexpr int32 MAX_ESTIMATED_SUBPLANS = 1 << 16;
+	FFicsitPlannerPlanEstimate EstimatePlan(int32 Item, bool bAllowLockedRecipes, int32 MaxSubPlans = MAX_ESTIMATED_SUBPLANS) const;
+
+	// Strategy for a plan of that size: full up to MaxFullNodes nodes, memoized up to MaxNodes, the unit cost table past that
+	// (only if it serves the objective, the plan is too large otherwise)
+	EFactoryPlanStrategy ChooseStrategy(const FFicsitPlannerPlanEstimate& Estimate, int32 Item, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, double MaxFullNodes, double MaxNodes) const;
+	static bool NeedsConfirmation(const EFactoryPlanStrategy Strategy) { return Strategy == EFactoryPlanStrategy::EFPS_Memoized || Strategy == EFactoryPlanStrategy::EFPS_Optimal; }
+
+	// Top K (the K best distinct selections of a plan's groups for the objective, best first)
+	// Lazy k-best over the plan's nodes: each node only ranks as many of its selections as its parents ask for, so K small lists
+	// are built instead of every combination (the plan itself, every alternative included, must already be expanded)
+	void FindTopPlans(const FFicsitPlannerPlan& Plan, EFactoryOptimizationType Optimization, int32 K, TArray<FFicsitPlannerRankedPlan>& OutPlans) const;
+
+	// Scale (copy of a plan with every rate multiplied by Rate, e.g. a plan made for 1 / min, selections kept & totals not refreshed)
+	void ScalePlan(const FFicsitPlannerPlan& Plan, float Rate, FFicsitPlannerPlan& OutPlan) const;
+
+	// Optimize (reselects every group by its total metrics, bottom-up)
+	void OptimizePlan(FFicsitPlannerPlan& Plan, EFactoryOptimizationType Optimization) const;
+
+	// Flatten (bill of materials)
+	void FlattenPlan(const FFicsitPlannerPlan& Plan, FFicsitPlannerBillOfMaterials& OutBill) const;
+
+	// Balance (net flow of every item over a bill: one pass over the flow matrix entries, the target expected at TargetRate)
+	static constexpr float BALANCE_TOLERANCE = 0.001f;
+	void BuildFlowMatrix(const FFicsitPlannerBillOfMaterials& Bill, FFicsitPlannerFlowMatrix& OutMatrix) const;
+	void CheckBalance(const FFicsitPlannerFlowMatrix& Matrix, int32 TargetItem, float TargetRate, FFicsitPlannerBalanceReport& OutReport) const;
+
+	// Research (what unlocking each locked recipe would save, best first): each locked recipe is priced once from the unlocked unit
+	// cost table, so every recipe is valued in one pass over the recipes instead of planning again with it
+	// Demands (item -> rate needed) come from targets (following their least-power plans) or from a plan's flow matrix
+	void ComputeDemands(TConstArrayView<FFicsitPlannerItemRate> Targets, TArray<float>& OutDemands) const;
+	void ComputeDemands(const FFicsitPlannerFlowMatrix& Matrix, int32 TargetItem, float TargetRate, TArray<float>& OutDemands) const;
+	void RankLockedRecipes(const TArray<float>& Demands, EFactoryResearchMetric Metric, TArray<FFicsitPlannerRecipeValue>& OutValues) const;
+
+	// Clock speeds (one machine group per recipe node, and per recipe of loop nodes, following selected alternatives)
+	void CollectMachines(const FFicsitPlannerPlan& Plan, FFicsitPlannerClockPlan& OutClockPlan) const;
+
+	// Logistics (belt / pipe tiers used to size plan edges, every tier by default)
+	void SetLogistics(const FFicsitPlannerLogistics& InLogistics) { Logistics = InLogistics; }
+	FFicsitPlannerTransport SizeEdge(const FFicsitPlannerPlanNode& Node) const;
+	int32 CountEdgesOverCapacity(const FFicsitPlannerPlan& Plan) const;
+
+	// Output
+	FString PlanToString(const FFicsitPlannerPlan& Plan) const;
+	FString BillToString(const FFicsitPlannerBillOfMaterials& Bill) const;
+	FString BalanceToString(const FFicsitPlannerBalanceReport& Report) const;
+	FString RecipeValuesToString(const TArray<FFicsitPlannerRecipeValue>& Values, EFactoryResearchMetric Metric, int32 MaxValues) const;
+
+	// Export (streamed node by node, following selected alternatives)
+	void WritePlan(const FFicsitPlannerPlan& Plan, IFicsitPlannerPlanWriter& Writer) const;
+	void WriteBill(const FFicsitPlannerPlan& Plan, IFicsitPlannerPlanWriter& Writer) const;
+
+private:
+	const FFicsitPlannerRecipeIndex& Index;
+	FFicsitPlannerLogistics Logistics;
+
+	// Helpers
+	int32 CreateNode(FFicsitPlannerPlan& Plan, int32 Item, float Rate, TArray<int32>& VisitedRecipes, FFicsitPlannerPlanCache* Cache) const;
+	void GetAlternatives(bool bAllowLockedRecipes, int32 Item, const TArray<int32>& VisitedRecipes, TArray<int32>& OutRecipes, TArray<int32>& OutLoops) const;
+	FFicsitPlannerPlanEstimate EstimateNode(bool bAllowLockedRecipes, int32 Item, TArray<int32>& VisitedRecipes, TMap<FFicsitPlannerSubPlanKey, FFicsitPlannerPlanEstimate>& SubPlans, int32 MaxSubPlans, bool& bComplete) const;
+	int32 ExpandNode(FFicsitPlannerPlan& Plan, int32 Item, float Rate, TArray<int32>& VisitedRecipes, FFicsitPlannerPlanCache* Cache) const;
+	int32 CreateRecipeNode(FFicsitPlannerPlan& Plan, int32 Item, float Rate, int32 Recipe, TArray<int32>& VisitedRecipes, FFicsitPlannerPlanCache* Cache) const;
+	int32 CreateLoopNode(FFicsitPlannerPlan& Plan, int32 Item, float Rate, int32 Loop, TArray<int32>& VisitedRecipes, FFicsitPlannerPlanCache* Cache) const;
+	int32 CreateOptimalNode(FFicsitPlannerPlan& Plan, int32 Item, float Rate) const;
+	int32 AddRecipeNode(FFicsitPlannerPlan& Plan, int32 Item, float Rate, int32 Recipe) const;
+	int32 AddLoopNode(FFicsitPlannerPlan& Plan, int32 Item, float Rate, int32 Loop) const;
+	int32 AppendFragment(FFicsitPlannerPlan& Plan, const FFicsitPlannerPlan& Fragment, float Rate) const;
+	int32 ComputeComplexity(const FFicsitPlannerPlan& Plan, const FFicsitPlannerPlanNode& Node) const;
+	FFicsitPlannerPlanHeader MakeHeader(const FFicsitPlannerPlan& Plan) const;
+	void RefreshNode(FFicsitPlannerPlan& Plan, int32 Node, float PowerWeight, float ComplexityWeight, bool bReselect) const;
+};
@@ -3,17 +3,198 @@
 #include "CoreMinimal.h"
 #include "FGRecipe.h"
 #include "FicsitPlannerFactory.h"
+#include "FicsitPlannerFactoryTree.h"
+#include "FicsitPlannerJobQueue.h"
+#include "FicsitPlannerLogistics.h"
+#include "FicsitPlannerPlanLibrary.h"
+#include "FicsitPlannerRecipeDataset.h"
 #include "Subsystem/ModSubsystem.h"
 #include "FicsitPlannerEngine.generated.h"
 
 DECLARE_LOG_CATEGORY_CLASS(LogFicsitPlannerEngine, Log, All);
 
+// Queued job done, with the created / replaced factory ID (INDEX_NONE if it failed)
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FFicsitPlannerJobCompleted, int32, JobID, int32, FactoryID);
+
+// Saved factory created, deleted (or evicted), or replaced by another version (replace, optimize, scale, undo & redo)
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FFicsitPlannerFactoryChanged, int32, FactoryID);
+
+// Group node selection changed (NodeID & SelectedIndex as in Update Factory Group), the rest of the factory is unchanged
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FFicsitPlannerFactorySelectionChanged, int32, FactoryID, int32, NodeID, int32, SelectedIndex);
+
+// Totals changed on these nodes only (the path from the root to an edited node, root first)
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FFicsitPlannerFactoryTotalsChanged, int32, FactoryID, const TArray<int32>&, NodeIDs);
+
+class IFicsitPlannerPlanWriter;
+struct FFicsitPlannerBillOfMaterials;
+struct FFicsitPlannerPlan;
+struct FFicsitPlannerClockPlan;
+
+/**
+ * Previous & undone versions of a saved factory.
+ * Versions share every node an edit didn't touch (see AFicsitPlannerEngine::CopyFactoryPath), so each one costs O(depth), and so does accounting for it.
+ */
+USTRUCT()
+struct FICSITPLANNER_API FFicsitPlannerFactoryHistory
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UFicsitPlannerFactory*> UndoVersions;
+
+	UPROPERTY()
+	TArray<UFicsitPlannerFactory*> RedoVersions;
+};
+
+/**
+ * Memory used by saved factories (one factory, or all of them) & the loaded recipe data, in bytes.
+ * Versions share the nodes an edit didn't touch, so each node is counted once, under the first version reaching it.
+ */
+USTRUCT(BlueprintType)
+struct FICSITPLANNER_API FFicsitPlannerMemoryStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 Factories = 0;
+
+	// Current, undo & redo versions
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 Versions = 0;
+
+	// Distinct nodes, and nodes reached again from another version or factory (each one shares its whole subtree)
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 Nodes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 SharedSubtrees = 0;
+
+	// Nodes of current versions (& slot map), nodes only kept for undo / redo (& history lists)
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 FactoryBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 HistoryBytes = 0;
+
+	// Compiled recipe data (this world's masks & unlocked graph, and the recipe tables & all-recipes graph shared by every world), and the item lists & recipe maps (engine-wide only)
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 RecipeIndexBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 RecipeTableBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 RecipeMapBytes = 0;
+
+	// Shared plans (choice vectors), the explored plans they share, and their bytes (engine-wide only)
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 SharedPlans = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 ExploredPlans = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 SharedPlanBytes = 0;
+
+	int64 GetTotalBytes() const { return FactoryBytes + HistoryBytes + RecipeIndexBytes + RecipeTableBytes + RecipeMapBytes + SharedPlanBytes; }
+};
+
+/**
+ * Target of a batch of factory plans (see AFicsitPlannerEngine::CreateFactoryPlans).
+ */
+USTRUCT(BlueprintType)
+struct FICSITPLANNER_API FFicsitPlannerBatchRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ficsit Planner")
+	TSubclassOf<UFGItemDescriptor> Item;
+
+	// Target rate (items / min)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ficsit Planner")
+	float Rate = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ficsit Planner")
+	TEnumAsByte<EFactoryOptimizationType> Optimization = EFactoryOptimizationType::EFOT_None;
+
+	// Plan it even if it's large (memoized or optimal strategy, see AFicsitPlannerEngine::EstimateFactoryPlan)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ficsit Planner")
+	bool bConfirmLargePlan = false;
+};
+
+/**
+ * Estimated size of a factory plan (see FFicsitPlannerCore::EstimatePlan), and the strategy picked for it.
+ */
+USTRUCT(BlueprintType)
+struct FICSITPLANNER_API FFicsitPlannerPlanSizeEstimate
+{
+	GENERATED_BODY()
+
+	// Plan nodes (groups & leaf inputs included), factories made from them (leaf inputs have none), groups
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 Nodes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 Factories = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 Groups = 0;
+
+	// Bytes of the factory objects, and of the planner core's plan (memoized strategy only)
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 FactoryBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 PlanBytes = 0;
+
+	// False if counting stopped early (the plan is at least this large)
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	bool bComplete = true;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	TEnumAsByte<EFactoryPlanStrategy> Strategy = EFactoryPlanStrategy::EFPS_Full;
+
+	// Not expanded node by node, so Create Factory Plan only creates it once confirmed
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	bool bNeedsConfirmation = false;
+};
+
+/**
+ * Visible row of a factory tree view (see AFicsitPlannerEngine::GetFactoryRows).
+ */
+USTRUCT(BlueprintType)
+struct FICSITPLANNER_API FFicsitPlannerFactoryRow
+{
+	GENERATED_BODY()
+
+	// Node ID (same numbering as Factory Plan to String & Update Factory Group), and its parent's (0 for the root)
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 NodeID = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 ParentID = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 Depth = 0;
+
+	// Inputs (rows below it when expanded)
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 NumChildren = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	bool bExpanded = false;
+
+	// Node (groups as is, their inputs are their selected factory's)
+	UPROPERTY(BlueprintReadOnly, Category = "Ficsit Planner")
+	UFicsitPlannerFactory* Factory = nullptr;
+};
+
 /**
  * Backend for Ficsit Planner!
  * Handles loading data and generating factories.
  * NOTE: Created once per world, like a singleton.
  */
-UCLASS()
+UCLASS(Config = Game)
 class FICSITPLANNER_API AFicsitPlannerEngine : public AModSubsystem
 {
 	GENERATED_BODY()
@@ -23,6 +204,10 @@ public:
 	AFicsitPlannerEngine();
 	virtual ~AFicsitPlannerEngine() override;
 
+	// Tick (finishes queued jobs)
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Initialization
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner")
 	void Initialize();
@@ -31,19 +216,59 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner")
 	void ReloadGameData();
 
-	// Getters for recipe maps & item lists
-	const TMap<TSubclassOf<UFGItemDescriptor>, TArray<TSubclassOf<UFGRecipe>>>& GetUnlockedRecipesMap() const { return UnlockedRecipesMap; }
-	const TMap<TSubclassOf<UFGItemDescriptor>, TArray<TSubclassOf<UFGRecipe>>>& GetAllRecipesMap() const { return AllRecipesMap; }
-	const TArray<TSubclassOf<UFGItemDescriptor>>& GetUnlockedItems() const { return UnlockedItems; }
-	const TArray<TSubclassOf<UFGItemDescriptor>>& GetAllItems() const { return AllItems; }
+	// Getters for recipe maps & item lists (current version, on the game thread)
+	const TMap<TSubclassOf<UFGItemDescriptor>, TArray<TSubclassOf<UFGRecipe>>>& GetUnlockedRecipesMap() const { return Dataset->UnlockedRecipesMap; }
+	const TMap<TSubclassOf<UFGItemDescriptor>, TArray<TSubclassOf<UFGRecipe>>>& GetAllRecipesMap() const { return Dataset->AllRecipesMap; }
+	const TArray<TSubclassOf<UFGItemDescriptor>>& GetUnlockedItems() const { return Dataset->UnlockedItems; }
+	const TArray<TSubclassOf<UFGItemDescriptor>>& GetAllItems() const { return Dataset->AllItems; }
+	const FFicsitPlannerRecipeIndex& GetRecipeIndex() const { return Dataset->Index; }
+
+	// Current version of the recipe data (immutable), hold the reference to keep reading it on other threads across reloads
+	FFicsitPlannerRecipeDatasetRef GetRecipeDataset() const { return Dataset; }
 
 	// Utilities for calculating factory stats
 	static float GetFactoryMultiplier(const TSubclassOf<UFGRecipe> Recipe, FItemAmount Target);
 	static float GetFactoryPowerConsumption(const TSubclassOf<UFGRecipe> Recipe, float Multiplier);
+	static TSubclassOf<UObject> GetRecipeBuilding(const TSubclassOf<UFGRecipe> Recipe);
 
-	// Factory Generation
+	// Factory Generation (plans larger than MaxFullPlanNodes are refused unless bConfirmLargePlan, see Estimate Factory Plan)
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Create Factory Plan"))
-	UFicsitPlannerFactory* CreateFactoryPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization = EFactoryOptimizationType::EFOT_None);
+	UFicsitPlannerFactory* CreateFactoryPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization = EFactoryOptimizationType::EFOT_None, bool bConfirmLargePlan = false);
+
+	// Plan size, counted before expanding anything, and the strategy Create Factory Plan picks for it (for that objective)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Estimate Factory Plan"))
+	FFicsitPlannerPlanSizeEstimate EstimateFactoryPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization = EFactoryOptimizationType::EFOT_None);
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Plan Estimate to String"))
+	FString PlanEstimateToString(const FFicsitPlannerPlanSizeEstimate& Estimate) const;
+
+	// Creates the factory with a given strategy (e.g. once a large plan was confirmed), Create Factory Plan picks it from the estimate
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Create Factory Plan with Strategy"))
+	UFicsitPlannerFactory* CreateFactoryPlanWithStrategy(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, EFactoryPlanStrategy Strategy);
+
+	// Plans up to this many nodes are expanded node by node, up to MaxPlanNodes on the planner core, larger ones from the unit cost table
+	// Sharing sub-plans only speeds up planning: the factory still gets one object per node (made on the game thread), so MaxPlanNodes stays low
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 MaxFullPlanNodes = 20000;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 MaxPlanNodes = 200000;
+
+	// Creates a single plan node (factory, factory group or loop) for the target, or nullptr if it can't be produced
+	UFicsitPlannerFactory* CreateFactoryNode(FItemAmount Target, const TArray<TSubclassOf<UFGRecipe>>& VisitedRecipes, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization);
+
+	// Batch Factory Generation (estimated & planned in parallel, sharing sub-plans, then saved)
+	// Returns the saved factory ID of every request, or INDEX_NONE if it couldn't be planned, was too large or needed confirmation
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Create Factory Plans"))
+	TArray<int> CreateFactoryPlans(const TArray<FFicsitPlannerBatchRequest>& Requests, bool bAllowLockedRecipes);
+
+	// Least-power factory, made from the unit cost table computed at load in O(plan size) (best recipes only, no alternatives)
+	// Other objectives (or unsolved recipe cycles) are planned in full, see FFicsitPlannerCore::CreateOptimalPlan
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Create Optimal Factory Plan"))
+	UFicsitPlannerFactory* CreateOptimalFactoryPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization = EFactoryOptimizationType::EFOT_PowerConsumption);
+
+	// Creates the plan node (factory, factory group or loop) for a node of a core plan, or nullptr for leaf inputs
+	UFicsitPlannerFactory* CreateFactoryFromPlan(const FFicsitPlannerPlan& Plan, int32 Node);
 
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Log Factory Plan"))
 	void LogFactoryPlan(UFicsitPlannerFactory* Factory);
@@ -54,7 +279,47 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Factory Plan to Header String"))
 	FString FactoryPlanToHeaderString(UFicsitPlannerFactory* Factory);
 
+	// Clock speeds (building counts & clock speeds minimizing power, MaxBuildings = 0 for one building per started 100%)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Factory Clock Speeds to String"))
+	FString FactoryClockSpeedsToString(int FactoryID, int MaxBuildings, int MaxShards);
+
+	void CollectFactoryMachines(UFicsitPlannerFactory* Factory, FFicsitPlannerClockPlan& OutClockPlan) const;
+
+	// Balance (net flow of every item over the factory's recipes, e.g. after manual updates), returns whether nothing is in deficit
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Check Factory Balance"))
+	bool CheckFactoryBalance(int FactoryID, FString& Report);
+
+	// Research advisor (what unlocking each locked recipe would save on a saved factory, or on targets, best first)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Factory Research to String"))
+	FString FactoryResearchToString(int FactoryID, EFactoryResearchMetric Metric, int MaxRecipes = 10);
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Research to String"))
+	FString ResearchToString(const TArray<FFicsitPlannerBatchRequest>& Targets, EFactoryResearchMetric Metric, int MaxRecipes = 10);
+
+	// Logistics (belt / pipe carrying each factory's output, limited to unlocked tiers)
+	FFicsitPlannerTransport SizeFactoryEdge(UFicsitPlannerFactory* Factory) const;
+	int32 CountFactoryEdgesOverCapacity(UFicsitPlannerFactory* Factory) const;
+
+	// Diagnostics
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Pruned Recipes to String"))
+	FString PrunedRecipesToString(bool bAllowLockedRecipes);
+
+	// Export (recipe data for planning outside the game, empty path = Saved/FicsitPlanner/GameData.json)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Export Game Data"))
+	bool ExportGameData(const FString& Path);
+
+	static FString GetGameDataExportPath();
+
+	// Export (saved factory, or its bill of materials, streamed to JSON / CSV, empty path = Saved/FicsitPlanner/Factory_<ID>.<ext>)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Export Factory"))
+	bool ExportFactory(int FactoryID, const FString& Path, EFactoryExportFormat Format, bool bBillOfMaterials);
+
+	static FString GetFactoryExportPath(int FactoryID, EFactoryExportFormat Format, bool bBillOfMaterials);
+	void WriteFactory(UFicsitPlannerFactory* Factory, IFicsitPlannerPlanWriter& Writer) const;
+	void FlattenFactory(UFicsitPlannerFactory* Factory, FFicsitPlannerBillOfMaterials& OutBill) const;
+
 	// Factory Management (CLI Commands)
+	// IDs stay valid until the factory is deleted, IDs of deleted factories are rejected (even once their slot is reused)
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Save Factory"))
 	int SaveFactory(UFicsitPlannerFactory* Factory);
 
@@ -67,6 +332,20 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Get All Factories"))
 	TArray<UFicsitPlannerFactory*> GetAllFactories();
 
+	// IDs of all factories, in the same order as Get All Factories
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Get All Factory IDs"))
+	TArray<int> GetAllFactoryIDs() const { return FactoryIDs; }
+
+	// Iteration without copies (factories & their IDs, same order, invalidated by saving / deleting a factory)
+	TConstArrayView<UFicsitPlannerFactory*> GetFactories() const { return Factories; }
+	TConstArrayView<int> GetFactoryIDs() const { return FactoryIDs; }
+
+	// Windowed rows: the visible rows [FirstRow, FirstRow + NumRows) of a factory, for virtualized tree views (TotalRows = all visible rows)
+	// Nodes above MaxDepth, and the ones in ExpandedNodeIDs, show their inputs. Seeks in O(depth * MaxDepth log n) using subtree sizes
+	// cached per factory version, so only the window's rows are read
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Get Factory Rows"))
+	TArray<FFicsitPlannerFactoryRow> GetFactoryRows(int FactoryID, const TSet<int32>& ExpandedNodeIDs, int MaxDepth, int FirstRow, int NumRows, int& TotalRows);
+
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Replace Factory at index"))
 	bool ReplaceFactory(int FactoryID, UFicsitPlannerFactory* Factory);
 
@@ -76,6 +355,144 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Optimize Factory"))
 	bool OptimizeFactory(int Factory, EFactoryOptimizationType Optimization);
 
+	// Rescales every rate of the factory to a new target rate in O(n), keeping every group selection (recorded for undo)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Scale Factory"))
+	bool ScaleFactory(int FactoryID, float Rate);
+
+	// History (replace, update, optimize & scale are recorded, up to MAX_FACTORY_HISTORY versions per factory)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Undo Factory"))
+	bool UndoFactory(int FactoryID);
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Redo Factory"))
+	bool RedoFactory(int FactoryID);
+
+	// Change events (broadcast once the change is made, so the UI can patch the affected rows instead of reading the factory again)
+	UPROPERTY(BlueprintAssignable, Category = "Ficsit Planner")
+	FFicsitPlannerFactoryChanged OnFactoryCreated;
+
+	UPROPERTY(BlueprintAssignable, Category = "Ficsit Planner")
+	FFicsitPlannerFactoryChanged OnFactoryDeleted;
+
+	UPROPERTY(BlueprintAssignable, Category = "Ficsit Planner")
+	FFicsitPlannerFactoryChanged OnFactoryReplaced;
+
+	UPROPERTY(BlueprintAssignable, Category = "Ficsit Planner")
+	FFicsitPlannerFactorySelectionChanged OnFactorySelectionChanged;
+
+	UPROPERTY(BlueprintAssignable, Category = "Ficsit Planner")
+	FFicsitPlannerFactoryTotalsChanged OnFactoryTotalsChanged;
+
+	// Shared Plans (target rate & choice vector over an explored plan shared per item & lock mode, see FFicsitPlannerPlanLibrary)
+	// Cheap to keep & clone in large numbers, expanded into factories only when needed
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Save Shared Plan"))
+	int SaveSharedPlan(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization);
+
+	// Saves the K best distinct plans for the objective (best first), Ranking lists their scores
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Save Top Shared Plans"))
+	TArray<int> SaveTopSharedPlans(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, int K, FString& Ranking);
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Clone Shared Plan"))
+	int CloneSharedPlan(int PlanID) { return SharedPlans.Clone(PlanID); }
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Delete Shared Plan"))
+	bool DeleteSharedPlan(int PlanID) { return SharedPlans.Remove(PlanID); }
+
+	// Selects recipe newIndex (from 1) at node nodeID, like Update Factory Group
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Update Shared Plan"))
+	bool UpdateSharedPlan(int PlanID, int nodeID, int newIndex) { return SharedPlans.Select(PlanID, nodeID, newIndex - 1); }
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Scale Shared Plan"))
+	bool ScaleSharedPlan(int PlanID, float Rate) { return SharedPlans.SetRate(PlanID, Rate); }
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Create Factory from Shared Plan"))
+	UFicsitPlannerFactory* CreateFactoryFromSharedPlan(int PlanID);
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Shared Plan to String"))
+	FString SharedPlanToString(int PlanID) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Shared Plans to String"))
+	FString SharedPlansToString() const { return SharedPlans.ToString(); }
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Get All Shared Plan IDs"))
+	TArray<int> GetAllSharedPlanIDs() const;
+
+	// Memory (all factories & recipe data, or one factory with its history)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Get Memory Stats"))
+	FFicsitPlannerMemoryStats GetMemoryStats() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Get Factory Memory Stats"))
+	FFicsitPlannerMemoryStats GetFactoryMemoryStats(int FactoryID) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Memory Stats to String"))
+	FString MemoryStatsToString(const FFicsitPlannerMemoryStats& Stats) const;
+
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	// Memory budget for saved factories (0 = unlimited), new factories over it are refused, or evict the least recently used ones
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Set Factory Memory Budget"))
+	void SetFactoryMemoryBudget(int64 MaxBytes, bool bEvict);
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Ficsit Planner")
+	int64 MaxFactoryMemory = 0;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Ficsit Planner")
+	bool bEvictFactories = false;
+
+	// Job Queue (create / optimize requests planned on worker threads, highest priority first, identical requests coalesced)
+	// Returns the job ID (shared by coalesced requests), or INDEX_NONE if the request is invalid
+	// Jobs are estimated & planned with the same strategy as Create Factory Plan (too large or unconfirmed large plans fail)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Enqueue Create Factory"))
+	int EnqueueCreateFactory(FItemAmount TargetProduct, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, int Priority, bool bConfirmLargePlan = false);
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Enqueue Optimize Factory"))
+	int EnqueueOptimizeFactory(int FactoryID, EFactoryOptimizationType Optimization, int Priority);
+
+	int32 EnqueueJob(const FFicsitPlannerJobRequest& Request, int32 Priority, FFicsitPlannerJobCallback&& OnCompleted);
+
+	// Position in the queue (0 = running, 1 = next, ...), or INDEX_NONE if the job is done or unknown
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Get Job Position"))
+	int GetJobPosition(int JobID) const { return JobQueue.GetPosition(JobID); }
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Jobs to String"))
+	FString JobsToString() const { return JobQueue.ToString(); }
+
+	// Starts queued jobs & finishes planned ones, until the frame budget is spent (at least one job per call)
+	void ProcessJobs();
+
+	UPROPERTY(BlueprintAssignable, Category = "Ficsit Planner")
+	FFicsitPlannerJobCompleted OnJobCompleted;
+
+	// Game thread time spent finishing jobs per frame (ms)
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Ficsit Planner")
+	float JobFrameBudgetMs = 4.0f;
+
+	// Jobs planned at once on worker threads
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Ficsit Planner")
+	int32 MaxRunningJobs = 2;
+
+	// Exclusion Rules (class names or paths, e.g. "Desc_SAM_C"), saved to Game.ini & applied without reloading game data
+	// Returns false if the rule was already there (add) or missing (remove)
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Add Exclusion Rule"))
+	bool AddExclusionRule(EFactoryExclusionType Type, const FString& Rule);
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Remove Exclusion Rule"))
+	bool RemoveExclusionRule(EFactoryExclusionType Type, const FString& Rule);
+
+	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Exclusion Rules to String"))
+	FString ExclusionRulesToString() const;
+
+	FFicsitPlannerExclusionRules GetExclusionRules() const { return {ExcludedItems, ExcludedRecipes, ExcludedBuildings}; }
+
+	// Excluding an item excludes every recipe consuming or producing it, excluding a building every recipe made in it
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Ficsit Planner")
+	TArray<FString> ExcludedItems = {TEXT("Desc_SAM_C"), TEXT("Desc_SAMIngot_C")};
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Ficsit Planner")
+	TArray<FString> ExcludedRecipes;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Ficsit Planner")
+	TArray<FString> ExcludedBuildings;
+
 	// Item Search
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner", meta = (DisplayName = "Find Item"))
 	TSubclassOf<UFGItemDescriptor> FindItem(const FString& ItemName);
@@ -85,18 +502,74 @@ public:
 	
 
 private:
-	// Items / Recipes
-	TArray<TSubclassOf<UFGItemDescriptor>> UnlockedItems;
-	TArray<TSubclassOf<UFGItemDescriptor>> AllItems;
-	TMap<TSubclassOf<UFGItemDescriptor>, TArray<TSubclassOf<UFGRecipe>>> UnlockedRecipesMap;
-	TMap<TSubclassOf<UFGItemDescriptor>, TArray<TSubclassOf<UFGRecipe>>> AllRecipesMap;
+	// Recipe data (compiled index, items & recipe maps), replaced by a new version on reload (see PublishDataset)
+	FFicsitPlannerRecipeDatasetRef Dataset = MakeShared<FFicsitPlannerRecipeDataset, ESPMode::ThreadSafe>();
+
+	// Shared plans
+	FFicsitPlannerPlanLibrary SharedPlans{Dataset};
+
+	// Unlocked belt / pipe tiers
+	FFicsitPlannerLogistics Logistics;
+
+	// Saved Factories (generational slot map)
+	// Factories & FactoryIDs are dense (no holes, for iteration), slots map an ID to its dense entry in O(1)
+	// ID = (Generation << FACTORY_SLOT_BITS) | Slot, the slot's generation is bumped when its factory is deleted
+	static constexpr int FACTORY_SLOT_BITS = 16;
+	static constexpr int FACTORY_SLOT_MASK = (1 << FACTORY_SLOT_BITS) - 1;
+	static constexpr int FACTORY_GENERATION_MASK = 0x7FFF;
 
-	// Saved Factories
 	UPROPERTY()
 	TArray<UFicsitPlannerFactory*> Factories;
 
+	TArray<int> FactoryIDs;
+	TArray<int32> FactorySlotEntries;
+	TArray<uint16> FactorySlotGenerations;
+	TArray<int32> FreeFactorySlots;
+
+	// Factory history (same order as Factories)
+	static constexpr int MAX_FACTORY_HISTORY = 32;
+
+	UPROPERTY()
+	TArray<FFicsitPlannerFactoryHistory> FactoryHistories;
+
+	// Factory ID -> preorder index of its current version (rebuilt when the version changed, see GetFactoryRows)
+	TMap<int32, FFicsitPlannerFactoryTree> FactoryTrees;
+
+	// Factory memory (bytes of every version, same order as Factories) & last use, for the memory budget
+	// Nodes are counted once per parent or version holding them, so a version only adds the nodes it copied & only frees the ones it held alone
+	TArray<TMap<UFicsitPlannerFactory*, int32>> FactoryNodeRefs;
+	TArray<int64> FactoryMemory;
+	int64 UsedFactoryMemory = 0;
+	TArray<uint64> FactoryLastUsed;
+	uint64 FactoryUseCounter = 0;
+
+	// Queued create / optimize jobs
+	FFicsitPlannerJobQueue JobQueue;
+
+	// Chat Commands
+	bool bRegisteredChatCommands = false;
+
+	// Flows below this are treated as balanced (items / min)
+	static constexpr float FLOW_TOLERANCE = 0.001f;
+
 	// Helpers
 	static bool RecipeProducedInBuilding(TSubclassOf<UFGRecipe> Recipe);
-	void RegisterUnlockedRecipe(TSubclassOf<UFGRecipe> Recipe);
-	void RegisterRecipe(TSubclassOf<UFGRecipe> Recipe);
+	void ApplyExclusionRules();
+	void PublishDataset(const FFicsitPlannerRecipeDatasetRef& NewDataset);
+	TArray<FString>& GetExclusionList(EFactoryExclusionType Type);
+	static FString GetRecipeSnapshotPath();
+	static UFicsitPlannerFactory* ResolveFactory(UFicsitPlannerFactory* Factory);
+	int32 FindFactoryEntry(int FactoryID) const;
+	int32 FinishJob(const FFicsitPlannerJob& Job);
+	void GetFactoryVersions(int32 Entry, TArray<UFicsitPlannerFactory*>& OutVersions) const;
+	static void CollectFactoryMemory(TConstArrayView<UFicsitPlannerFactory*> Versions, TSet<UFicsitPlannerFactory*>& VisitedNodes, FFicsitPlannerMemoryStats& Stats);
+	static int64 GetNodeMemory(UFicsitPlannerFactory* Node);
+	static int64 AddNodeRefs(TMap<UFicsitPlannerFactory*, int32>& NodeRefs, UFicsitPlannerFactory* Version);
+	static int64 ReleaseNodeRefs(TMap<UFicsitPlannerFactory*, int32>& NodeRefs, UFicsitPlannerFactory* Version);
+	void AddFactoryVersion(int32 Entry, UFicsitPlannerFactory* Version);
+	void ReleaseFactoryVersion(int32 Entry, UFicsitPlannerFactory* Version);
+	int64 GetUsedFactoryMemory() const { return UsedFactoryMemory; }
+	bool ReserveFactoryMemory(int64 Bytes);
+	bool CommitFactoryVersion(int32 FactoryID, UFicsitPlannerFactory* Factory);
+	static UFicsitPlannerFactory* CopyFactoryPath(UFicsitPlannerFactory* Root, const TArray<int32>& Path, UFicsitPlannerFactory*& OutNode);
 };
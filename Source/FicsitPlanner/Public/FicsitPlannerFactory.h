@@ -12,9 +12,58 @@ enum EFactoryOptimizationType
 	EFOT_None,
 	EFOT_Complexity,
 	EFOT_PowerConsumption,
+	EFOT_ClockSpeed,
+};
+
+// How a factory is planned (picked from the estimated plan size, see FFicsitPlannerCore::ChooseStrategy)
+UENUM()
+enum EFactoryPlanStrategy
+{
+	// Every alternative expanded, node by node (small plans)
+	EFPS_Full,
+
+	// Every alternative expanded on the planner core, sharing identical sub-plans
+	EFPS_Memoized,
+
+	// Least-power plan straight from the unit cost table (best recipes only, no alternatives)
+	EFPS_Optimal,
+
+	// Too large to plan in full, and no exact unit cost table to fall back to
+	EFPS_TooLarge,
+};
+
+// What an exclusion rule matches (see FFicsitPlannerExclusionRules)
+UENUM()
+enum EFactoryExclusionType
+{
+	EFET_Item,
+	EFET_Recipe,
+	EFET_Building,
+};
+
+// What unlocking a recipe would save (see FFicsitPlannerCore::RankLockedRecipes)
+UENUM()
+enum EFactoryResearchMetric
+{
+	// Power consumption (MW)
+	EFRM_Power,
+
+	// Buildings (the unit cost table's complexity bound)
+	EFRM_Complexity,
+
+	// Raw resources (items / min)
+	EFRM_RawResources,
+};
+
+UENUM()
+enum EFactoryExportFormat
+{
+	EFEF_Json,
+	EFEF_Csv,
 };
 
 class AFicsitPlannerEngine;
+struct FFicsitPlannerPlan;
 
 /**
  *
@@ -24,11 +73,11 @@ class FICSITPLANNER_API UFicsitPlannerFactory : public UObject
 {
 	GENERATED_BODY()
 
+protected:
 	// Configuration
 	const int RECIPE_COMPLEXITY = 10;
 	const int BUILDING_COMPLEXITY = 1;
 
-private:
 	// Cached Factory Metrics
 	UPROPERTY()
 	float Multiplier;
@@ -53,6 +102,8 @@ private:
 	UPROPERTY()
 	TArray<UFicsitPlannerFactory*> Subfactories;
 
+	// Scaling (this node's metrics only, see CreateScaledCopy)
+	virtual void ScaleMetrics(float Factor);
 
 public:
 	// Constructor / Destructor
@@ -63,6 +114,13 @@ public:
 	void Init(FItemAmount Target, TSubclassOf<UFGRecipe> InRecipe, const TArray<TSubclassOf<UFGRecipe>>& VisitedRecipes,
 	          bool AllowLockedRecipes, EFactoryOptimizationType Optimization, AFicsitPlannerEngine* Engine);
 
+	// Init (from a node of a plan made by FFicsitPlannerCore, see AFicsitPlannerEngine::CreateFactoryFromPlan)
+	virtual void InitFromPlan(const FFicsitPlannerPlan& Plan, int32 Node, AFicsitPlannerEngine* Engine);
+
+	// Copy of the whole tree with every rate scaled by Factor, in one traversal (selections kept, nothing re-expanded)
+	// Multipliers & power are linear in the rate, amounts are rounded to whole items, complexity is recomputed
+	virtual UFicsitPlannerFactory* CreateScaledCopy(float Factor) const;
+
 	// Getters (Factory Metrics - Individual)
 	virtual float GetMultiplier() const;
 	virtual float GetPowerConsumption() const;
@@ -80,6 +138,12 @@ public:
 	// Getters subfactories
 	virtual TArray<UFicsitPlannerFactory*>* GetSubfactories();
 
+	// Child nodes (subfactories, or every alternative of a group), for walking whole plan trees
+	virtual void GetChildNodes(TArray<UFicsitPlannerFactory*>& OutNodes) const;
+
+	// Memory (arrays owned by this node only, child nodes may be shared between versions, see AFicsitPlannerEngine::GetMemoryStats)
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
 	UPROPERTY()
 	bool UsesLockedRecipes;
 };
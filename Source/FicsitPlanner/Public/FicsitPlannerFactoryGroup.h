@@ -6,6 +6,8 @@
 #include "FicsitPlannerFactory.h"
 #include "FicsitPlannerFactoryGroup.generated.h"
 
+struct FFicsitPlannerLoopSolution;
+
 /**
  * 
  */
@@ -22,13 +24,35 @@ private:
 	UPROPERTY()
 	int SelectedFactoryIndex;
 
+	// Alternative Metrics (struct-of-arrays, one entry per factory)
+	UPROPERTY()
+	TArray<float> AlternativeMultipliers;
+
+	UPROPERTY()
+	TArray<float> AlternativePowerConsumptions;
+
+	UPROPERTY()
+	TArray<int> AlternativeComplexities;
+
+	UPROPERTY()
+	TArray<float> AlternativeTotalPowerConsumptions;
+
+	UPROPERTY()
+	TArray<int> AlternativeTotalComplexities;
+
+	// Helpers
+	void AddFactory(UFicsitPlannerFactory* Factory);
+	void RefreshAlternativeTotals();
+
 public:
 	// Constructor / Destructor
 	UFicsitPlannerFactoryGroup();
 	virtual ~UFicsitPlannerFactoryGroup() override;
 
 	// Init
-	void Init(FItemAmount Target, TArray<TSubclassOf<UFGRecipe>> Recipes, const TArray<TSubclassOf<UFGRecipe>>& VisitedRecipes, bool AllowLockedRecipes, EFactoryOptimizationType Optimization, AFicsitPlannerEngine* Engine);
+	void Init(FItemAmount Target, TArray<TSubclassOf<UFGRecipe>> Recipes, const TArray<const FFicsitPlannerLoopSolution*>& Loops, const TArray<TSubclassOf<UFGRecipe>>& VisitedRecipes, bool AllowLockedRecipes, EFactoryOptimizationType Optimization, AFicsitPlannerEngine* Engine);
+	virtual void InitFromPlan(const FFicsitPlannerPlan& Plan, int32 Node, AFicsitPlannerEngine* Engine) override;
+	virtual UFicsitPlannerFactory* CreateScaledCopy(float Factor) const override;
 
 	// Getters (Factory Metrics - Selected Factory - Individual)
 	virtual float GetMultiplier() const override;
@@ -40,13 +64,23 @@ public:
 	virtual int GetTotalComplexity() override;
 
 	// Getters (Factory Metrics - All Factories - Individual)
-	TArray<float> GetAllMultipliers() const;
-	TArray<float> GetAllPowerConsumptions() const;
-	TArray<int> GetAllComplexities() const;
+	TConstArrayView<float> GetAllMultipliers() const { return AlternativeMultipliers; }
+	TConstArrayView<float> GetAllPowerConsumptions() const { return AlternativePowerConsumptions; }
+	TConstArrayView<int> GetAllComplexities() const { return AlternativeComplexities; }
 
 	// Getters (Factory Metrics - All Factories - Sum)
-	TArray<float> GetAllTotalPowerConsumption();
-	TArray<int> GetAllTotalComplexity();
+	TConstArrayView<float> GetAllTotalPowerConsumption();
+	TConstArrayView<int> GetAllTotalComplexity();
+
+	// Optimization (weighted min over all factories, individual or summed metrics)
+	int FindBestFactoryIndex(float PowerWeight, float ComplexityWeight) const;
+	int FindBestTotalFactoryIndex(float PowerWeight, float ComplexityWeight);
+	void SelectBestFactory(EFactoryOptimizationType Optimization);
+	static void GetOptimizationWeights(EFactoryOptimizationType Optimization, float& OutPowerWeight, float& OutComplexityWeight);
+
+	// Weighted argmin over two metric columns (Score = Power * PowerWeight + Complexity * ComplexityWeight), four alternatives per step
+	// Ties resolve to the lowest index, and a non-empty list always returns a valid index (INDEX_NONE only if it's empty)
+	static int FindMinWeightedIndex(TConstArrayView<float> Power, TConstArrayView<int> Complexity, float PowerWeight, float ComplexityWeight);
 
 	// Getters (Factory Data - Selected Factory)
 	virtual TSubclassOf<UFGRecipe> GetRecipe() const override;
@@ -58,11 +92,19 @@ public:
 	TArray<FItemAmount> GetAllPrimaryProducts() const;
 	TArray<TArray<FItemAmount>> GetAllByproducts() const;
 
+	// Getters (Selected Factory, nullptr if the selection is out of bounds)
+	UFicsitPlannerFactory* GetSelectedFactory() const { return Factories.IsValidIndex(SelectedFactoryIndex) ? Factories[SelectedFactoryIndex] : nullptr; }
+	int32 NumFactories() const { return Factories.Num(); }
+
 	// Getters (Subfactories - Selected Factory)
 	virtual TArray<UFicsitPlannerFactory*>* GetSubfactories() override;
 
 	// Getters (Subfactories - All Factories)
 	TArray<TArray<UFicsitPlannerFactory*>> GetAllSubfactories() const;
+	virtual void GetChildNodes(TArray<UFicsitPlannerFactory*>& OutNodes) const override;
+
+	// Memory
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 
 	// Getter / Setters (Selected Factory)
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner")
@@ -70,4 +112,7 @@ public:
 	
 	UFUNCTION(BlueprintCallable, Category = "Ficsit Planner")
 	int GetSelectedFactoryIndex() const { return SelectedFactoryIndex; }
+
+	// Setters (Factory - replaces an alternative, e.g. with a copy when editing a saved plan)
+	void SetFactory(int Index, UFicsitPlannerFactory* Factory);
 };
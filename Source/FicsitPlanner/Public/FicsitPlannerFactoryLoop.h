@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FicsitPlannerFactory.h"
+#include "FicsitPlannerFactoryLoop.generated.h"
+
+struct FFicsitPlannerLoopSolution;
+
+/**
+ * Factory running a closed set of recipes inside a recipe loop (e.g. recycled rubber / plastic) at its steady state.
+ * Subfactories only supply the inputs crossing the loop boundary.
+ */
+UCLASS()
+class FICSITPLANNER_API UFicsitPlannerFactoryLoop : public UFicsitPlannerFactory
+{
+	GENERATED_BODY()
+
+private:
+	// Loop recipes and their multipliers (index 0 produces the primary product)
+	UPROPERTY()
+	TArray<TSubclassOf<UFGRecipe>> LoopRecipes;
+
+	UPROPERTY()
+	TArray<float> LoopMultipliers;
+
+public:
+	// Constructor / Destructor
+	UFicsitPlannerFactoryLoop();
+	virtual ~UFicsitPlannerFactoryLoop() override;
+
+	// Init
+	void Init(FItemAmount Target, const FFicsitPlannerLoopSolution& Solution, const TArray<TSubclassOf<UFGRecipe>>& VisitedRecipes,
+	          bool AllowLockedRecipes, EFactoryOptimizationType Optimization, AFicsitPlannerEngine* Engine);
+	virtual void InitFromPlan(const FFicsitPlannerPlan& Plan, int32 Node, AFicsitPlannerEngine* Engine) override;
+
+	// Getters (Loop Data)
+	const TArray<TSubclassOf<UFGRecipe>>& GetLoopRecipes() const { return LoopRecipes; }
+	const TArray<float>& GetLoopMultipliers() const { return LoopMultipliers; }
+
+	// Memory
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+protected:
+	// Scaling (every loop recipe)
+	virtual void ScaleMetrics(float Factor) override;
+};
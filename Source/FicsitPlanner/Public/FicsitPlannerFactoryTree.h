@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FicsitPlannerFactory.h"
+
+/**
+ * Preorder index of a factory version, for windowed queries over its visible rows (see AFicsitPlannerEngine::GetFactoryRows).
+ * Nodes are numbered like FactoryPlanToString (node ID = preorder index + 1), so a subtree is the range [Node, Node + Size).
+ * Built once per version in O(n): versions aren't edited in place (edits copy the path they change, see CopyFactoryPath).
+ */
+class FICSITPLANNER_API FFicsitPlannerFactoryTree
+{
+public:
+	void Build(UFicsitPlannerFactory* Root);
+	bool IsBuiltFor(const UFicsitPlannerFactory* Root) const { return Root && BuiltRoot.Get() == Root; }
+
+	// Expansion: nodes above MaxDepth, and the expanded ones (by node ID), show their inputs
+	void SetExpansion(const TSet<int32>& ExpandedNodeIDs, int32 InMaxDepth);
+	bool IsExpanded(const int32 Node) const { return Depths[Node] < MaxDepth || Expanded.Contains(Node); }
+
+	// Visible rows: seeking the first row descends from the root, counting the visible rows of each input in O(MaxDepth log n),
+	// then every row is the next node in preorder (skipping collapsed subtrees) in O(1)
+	int32 NumVisibleRows() const { return Nodes.Num() > 0 ? CountVisible(0) : 0; }
+	void GetVisibleRows(int32 FirstRow, int32 NumRows, TArray<int32>& OutNodes) const;
+
+	// Nodes (by preorder index)
+	int32 Num() const { return Nodes.Num(); }
+	UFicsitPlannerFactory* GetFactory(const int32 Node) const { return Nodes[Node]; }
+	int32 GetParent(const int32 Node) const { return Parents[Node]; }
+	int32 GetDepth(const int32 Node) const { return Depths[Node]; }
+	int32 GetNumChildren(const int32 Node) const { return NumChildren[Node]; }
+
+	// Memory
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	TWeakObjectPtr<UFicsitPlannerFactory> BuiltRoot;
+
+	// Preorder index -> node, parent (INDEX_NONE for the root), depth, subtree size & input count
+	TArray<UFicsitPlannerFactory*> Nodes;
+	TArray<int32> Parents;
+	TArray<int32> Depths;
+	TArray<int32> SubtreeSizes;
+	TArray<int32> NumChildren;
+
+	// Depth -> nodes at that depth, in preorder (nodes of a subtree at a depth are counted by binary search)
+	TArray<TArray<int32>> DepthNodes;
+
+	// Expanded nodes (preorder indices), and the rows they add (node -> visible rows - 1) for the ones at or past MaxDepth
+	int32 MaxDepth = 0;
+	TSet<int32> Expanded;
+	TMap<int32, int32> ExtraRows;
+
+	// Expanded nodes at MaxDepth (in preorder, and the prefix sums of their extra rows), counted by every node above them
+	TArray<int32> FrontierNodes;
+	TArray<int32> FrontierRows;
+
+	// Helpers
+	int32 CountVisible(int32 Node) const;
+	int32 CountAtDepth(int32 Depth, int32 First, int32 End) const;
+};
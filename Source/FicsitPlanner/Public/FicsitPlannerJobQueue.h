@@ -0,0 +1,117 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "FicsitPlannerCore.h"
+#include "FicsitPlannerRecipeDataset.h"
+
+/**
+ * Kind of planner job.
+ */
+enum class EFicsitPlannerJobType : uint8
+{
+	// Plan & save a new factory
+	Create,
+
+	// Plan a saved factory again with an objective, replacing it (kept for undo)
+	Optimize,
+};
+
+/**
+ * What a planner job plans. Identical requests are coalesced into one job.
+ */
+struct FICSITPLANNER_API FFicsitPlannerJobRequest
+{
+	EFicsitPlannerJobType Type = EFicsitPlannerJobType::Create;
+	int32 Item = INDEX_NONE;
+	float Rate = 0.0f;
+	bool bAllowLockedRecipes = false;
+	EFactoryOptimizationType Optimization = EFactoryOptimizationType::EFOT_None;
+
+	// Factory to replace (optimize jobs only)
+	int32 FactoryID = INDEX_NONE;
+
+	// Plan it even if it's too large to expand node by node (see FFicsitPlannerCore::NeedsConfirmation)
+	bool bConfirmLargePlan = false;
+
+	bool operator==(const FFicsitPlannerJobRequest& Other) const
+	{
+		return Type == Other.Type && Item == Other.Item && Rate == Other.Rate && bAllowLockedRecipes == Other.bAllowLockedRecipes
+			&& Optimization == Other.Optimization && FactoryID == Other.FactoryID && bConfirmLargePlan == Other.bConfirmLargePlan;
+	}
+};
+
+/**
+ * Called once a job is done, with the created / replaced factory ID (INDEX_NONE if it failed).
+ */
+using FFicsitPlannerJobCallback = TFunction<void(int32 JobID, int32 FactoryID)>;
+
+/**
+ * Planner job, and every requester waiting on it.
+ */
+struct FICSITPLANNER_API FFicsitPlannerJob
+{
+	int32 JobID = INDEX_NONE;
+	FFicsitPlannerJobRequest Request;
+	int32 Priority = 0;
+	uint64 Sequence = 0;
+	TArray<FFicsitPlannerJobCallback> Callbacks;
+
+	// Recipe data version the request was made for (item IDs refer to it, kept across reloads)
+	TSharedPtr<const FFicsitPlannerRecipeDataset, ESPMode::ThreadSafe> Dataset;
+
+	// Result (filled by the worker thread), and the strategy picked from the plan's estimate
+	FFicsitPlannerPlan Plan;
+	bool bPlanned = false;
+	EFactoryPlanStrategy Strategy = EFactoryPlanStrategy::EFPS_Full;
+};
+
+/**
+ * Queue of planner jobs: highest priority first, then oldest first, with identical requests coalesced.
+ * Jobs are planned on the planner core on worker threads (MaxRunning at a time), and finished on the game thread by the engine
+ * (see AFicsitPlannerEngine::ProcessJobs), which creates & saves the factories within a per-frame time budget.
+ */
+class FICSITPLANNER_API FFicsitPlannerJobQueue
+{
+public:
+	~FFicsitPlannerJobQueue() { Wait(); }
+
+	// Adds a job, or joins the identical queued / running one for the same recipe data (raising its priority), returns its job ID
+	int32 Enqueue(const FFicsitPlannerJobRequest& Request, const FFicsitPlannerRecipeDatasetRef& Dataset, int32 Priority, FFicsitPlannerJobCallback&& OnCompleted);
+
+	// Position of a job (0 = running, 1 = next, ...), or INDEX_NONE if it's done or unknown
+	int32 GetPosition(int32 JobID) const;
+
+	// Starts queued jobs on worker threads (up to MaxRunning at a time, each on its own recipe data), returns how many are running
+	// Each job is estimated first, and planned with the strategy for its size (see FFicsitPlannerCore::ChooseStrategy)
+	int32 StartJobs(int32 MaxRunning, int32 MaxFullNodes, int32 MaxNodes);
+
+	// Takes a running job once it's planned (nullptr if none is)
+	TUniquePtr<FFicsitPlannerJob> TakeFinishedJob();
+
+	// Blocks until every running job is planned (before the engine goes away)
+	void Wait();
+
+	int32 NumQueued() const { return Queued.Num(); }
+	int32 NumRunning() const { return Running.Num(); }
+
+	// Output
+	FString ToString() const;
+
+private:
+	struct FRunningJob
+	{
+		TUniquePtr<FFicsitPlannerJob> Job;
+		TFuture<void> Task;
+	};
+
+	// Queued jobs, best first
+	TArray<TUniquePtr<FFicsitPlannerJob>> Queued;
+	TArray<FRunningJob> Running;
+	int32 NextJobID = 0;
+	uint64 NextSequence = 0;
+
+	// Helpers
+	static bool RunsBefore(const FFicsitPlannerJob& A, const FFicsitPlannerJob& B);
+	void InsertQueued(TUniquePtr<FFicsitPlannerJob>&& Job);
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FGRecipe.h"
+
+/**
+ * Belt or pipe tier.
+ */
+struct FICSITPLANNER_API FFicsitPlannerTransportTier
+{
+	const TCHAR* Name;
+
+	// Throughput of one line (items / min, or liters / min for fluids, matching recipe rates)
+	float Capacity;
+
+	// Build recipe unlocking the tier
+	const TCHAR* RecipeName;
+};
+
+/**
+ * Transport sized for one plan edge (a node's output, carried to its parent).
+ */
+struct FICSITPLANNER_API FFicsitPlannerTransport
+{
+	// Tier (index in the belt / pipe tiers), or INDEX_NONE if no tier is unlocked
+	int32 Tier = INDEX_NONE;
+	bool bFluid = false;
+
+	// Parallel lines needed
+	int32 Lines = 0;
+
+	// More than one line of the best unlocked tier (needs a manifold / split), or no tier unlocked at all
+	bool bOverCapacity = false;
+};
+
+/**
+ * Logistics sizing: picks the cheapest unlocked belt or pipe tier carrying each edge of a plan on one line,
+ * or the best unlocked tier & the number of parallel lines when none does. O(1) per edge.
+ */
+class FICSITPLANNER_API FFicsitPlannerLogistics
+{
+public:
+	static constexpr int32 NUM_BELT_TIERS = 6;
+	static constexpr int32 NUM_PIPE_TIERS = 2;
+	static const FFicsitPlannerTransportTier BeltTiers[NUM_BELT_TIERS];
+	static const FFicsitPlannerTransportTier PipeTiers[NUM_PIPE_TIERS];
+
+	// Unlocked tiers (every tier by default, e.g. for headless planning)
+	void SetUnlockedRecipes(const TArray<TSubclassOf<UFGRecipe>>& UnlockedRecipes);
+	void SetUnlockedTiers(int32 InNumBeltTiers, int32 InNumPipeTiers);
+	int32 GetNumBeltTiers() const { return NumBeltTiers; }
+	int32 GetNumPipeTiers() const { return NumPipeTiers; }
+
+	// Sizing
+	FFicsitPlannerTransport Size(float Rate, bool bFluid) const;
+
+	// Output ("Belt Mk3", "2x Pipe Mk2 (over capacity)", ...)
+	static FString TransportToString(const FFicsitPlannerTransport& Transport);
+
+private:
+	int32 NumBeltTiers = NUM_BELT_TIERS;
+	int32 NumPipeTiers = NUM_PIPE_TIERS;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FicsitPlannerCore.h"
+#include "FicsitPlannerRecipeDataset.h"
+
+/**
+ * Explored plan of an item (every alternative, for 1 / min), shared by every shared plan for the same item & lock mode.
+ */
+struct FICSITPLANNER_API FFicsitPlannerExploredPlan
+{
+	FFicsitPlannerPlan Plan;
+
+	// Recipe data version it was explored with (its IDs refer to it, kept across reloads)
+	TSharedPtr<const FFicsitPlannerRecipeDataset, ESPMode::ThreadSafe> Dataset;
+
+	// Node -> group index (in node order), or INDEX_NONE for other nodes
+	TArray<int32> NodeGroups;
+	int32 NumGroups = 0;
+};
+
+/**
+ * Shared plan: a target rate and the selected alternative of every group of its explored plan.
+ */
+struct FICSITPLANNER_API FFicsitPlannerSharedPlan
+{
+	TSharedPtr<const FFicsitPlannerExploredPlan> Explored;
+	float Rate = 0.0f;
+
+	// Group index -> selected alternative
+	TArray<uint8> Choices;
+};
+
+/**
+ * Library of shared plans over their explored structure: each item & lock mode is explored once, and kept while a shared plan uses it
+ * (reference-counted), so a shared plan only costs its choice vector (one byte per group), and cloning one copies that vector.
+ * Plans are expanded to their rate only when they are read (see Instantiate).
+ * Kept alongside saved factories, not under them: saved factories stay full factory trees, and loading a shared plan makes one.
+ */
+class FICSITPLANNER_API FFicsitPlannerPlanLibrary
+{
+public:
+	explicit FFicsitPlannerPlanLibrary(const FFicsitPlannerRecipeDatasetRef& InDataset) : Dataset(InDataset) {}
+
+	// Saving (explores the item unless a saved plan already did, then selects the best alternatives for the objective at that rate)
+	// Returns the plan ID, or INDEX_NONE if the item can't be produced
+	int32 Save(int32 Item, float Rate, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization);
+	int32 Clone(int32 PlanID);
+
+	// Saves the K best distinct plans for the objective (see FFicsitPlannerCore::FindTopPlans), best first
+	// Explores, scales & optimizes the whole alternative tree first (only the ranking is lazy), so it's bounded like Explore
+	int32 SaveTop(int32 Item, float Rate, bool bAllowLockedRecipes, EFactoryOptimizationType Optimization, int32 K, TArray<int32>& OutPlanIDs, TArray<FFicsitPlannerRankedPlan>& OutRankedPlans);
+	bool Remove(int32 PlanID);
+
+	// Editing (NodeID follows the numbering of FFicsitPlannerCore::PlanToString, Alternative starts at 0)
+	bool Select(int32 PlanID, int32 NodeID, int32 Alternative);
+	bool SetRate(int32 PlanID, float Rate);
+
+	// Reading (expands the explored plan to the plan's rate, with its choices selected)
+	const FFicsitPlannerSharedPlan* Find(const int32 PlanID) const { return Plans.Find(PlanID); }
+	bool Instantiate(int32 PlanID, FFicsitPlannerPlan& OutPlan) const;
+	void GetPlanIDs(TArray<int32>& OutPlanIDs) const { Plans.GenerateKeyArray(OutPlanIDs); }
+	int32 Num() const { return Plans.Num(); }
+
+	// New recipe data version: new plans are explored with it, saved plans keep theirs (and the version it was explored with)
+	void SetDataset(const FFicsitPlannerRecipeDatasetRef& InDataset);
+
+	// Items whose explored plan would have more nodes than this are refused (estimated first, 0 = unlimited)
+	void SetMaxNodes(const int32 InMaxNodes) { MaxNodes = InMaxNodes; }
+
+	// Memory (explored plans counted once, however many saved plans share them)
+	SIZE_T GetAllocatedSize(int32& OutExploredPlans) const;
+
+	// Output
+	FString ToString() const;
+
+private:
+	FFicsitPlannerRecipeDatasetRef Dataset;
+	int32 MaxNodes = 0;
+
+	// (Item, lock mode) -> explored plan, alive while a saved plan holds it
+	TMap<TPair<int32, bool>, TWeakPtr<const FFicsitPlannerExploredPlan>> ExploredPlans;
+
+	// Saved plans
+	TMap<int32, FFicsitPlannerSharedPlan> Plans;
+	int32 NextPlanID = 0;
+
+	// Helpers
+	TSharedPtr<const FFicsitPlannerExploredPlan> Explore(int32 Item, bool bAllowLockedRecipes);
+	static bool ReadChoices(const FFicsitPlannerPlan& Plan, FFicsitPlannerSharedPlan& SharedPlan);
+	static void ApplyChoices(const FFicsitPlannerSharedPlan& SharedPlan, FFicsitPlannerPlan& Plan);
+	static int32 FindGroup(const FFicsitPlannerSharedPlan& SharedPlan, int32 NodeID);
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FicsitPlannerFactory.h"
+
+class FFicsitPlannerRecipeIndex;
+struct FFicsitPlannerBillOfMaterials;
+
+/**
+ * Summary of an exported plan.
+ */
+struct FICSITPLANNER_API FFicsitPlannerPlanHeader
+{
+	FString Item;
+	float Rate = 0.0f;
+	float Power = 0.0f;
+	int32 Complexity = 0;
+
+	// Node outputs needing more than one belt / pipe
+	int32 EdgesOverCapacity = 0;
+};
+
+/**
+ * Exported plan node, with names already resolved.
+ * Node IDs follow the numbering used by FactoryPlanToString & UpdateFactoryGroup.
+ */
+struct FICSITPLANNER_API FFicsitPlannerPlanRow
+{
+	int32 NodeId = 0;
+	int32 ParentId = 0;
+	int32 Depth = 0;
+	FString Item;
+	float Rate = 0.0f;
+	FString Recipe;
+	float Multiplier = 0.0f;
+	float Power = 0.0f;
+	int32 Complexity = 0;
+
+	// Selected option (1-based) & option count, for factory groups
+	int32 Option = 0;
+	int32 NumOptions = 0;
+
+	// Recipes & multipliers, for recipe loops
+	TArray<TPair<FString, float>> LoopRecipes;
+
+	// Belt / pipe carrying the node's output to its parent
+	FString Transport;
+	int32 Lines = 0;
+	bool bOverCapacity = false;
+};
+
+/**
+ * Streams plans (or bills of materials) to an archive while they are traversed, without building the document in memory.
+ * Nodes are nested: every BeginNode is closed by an EndNode, after the node's inputs.
+ */
+class FICSITPLANNER_API IFicsitPlannerPlanWriter
+{
+public:
+	virtual ~IFicsitPlannerPlanWriter() = default;
+
+	// Document (a list of plans, or of bills of materials)
+	virtual void BeginDocument(bool bBillsOfMaterials) = 0;
+	virtual void EndDocument() = 0;
+
+	// Plans
+	virtual void BeginPlan(const FFicsitPlannerPlanHeader& Header) = 0;
+	virtual void BeginNode(const FFicsitPlannerPlanRow& Row) = 0;
+	virtual void EndNode() = 0;
+	virtual void EndPlan() = 0;
+
+	// Bills of materials
+	virtual void WriteBill(const FFicsitPlannerPlanHeader& Header, const FFicsitPlannerBillOfMaterials& Bill, const FFicsitPlannerRecipeIndex& Index) = 0;
+
+	// Creates a writer for the format, writing to the archive (which must outlive the writer)
+	static TUniquePtr<IFicsitPlannerPlanWriter> Create(EFactoryExportFormat Format, FArchive& Archive);
+	static const TCHAR* GetFileExtension(EFactoryExportFormat Format);
+};
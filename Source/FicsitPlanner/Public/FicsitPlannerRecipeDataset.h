@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FicsitPlannerRecipeIndex.h"
+
+/**
+ * One version of the recipe data: the compiled index, and the item lists & recipe maps registered from it.
+ * Never modified once published (see AFicsitPlannerEngine::GetRecipeDataset): reloads & rule changes build a new version aside
+ * and swap it in, so planners holding a reference keep reading the version they started with, without any locking.
+ */
+struct FICSITPLANNER_API FFicsitPlannerRecipeDataset
+{
+	// Bumped by every published version
+	uint32 Version = 0;
+
+	// Compiled recipe data (rates, pruning, components & loops)
+	FFicsitPlannerRecipeIndex Index;
+
+	// Items / Recipes (excluded recipes left out)
+	TArray<TSubclassOf<UFGItemDescriptor>> UnlockedItems;
+	TArray<TSubclassOf<UFGItemDescriptor>> AllItems;
+	TMap<TSubclassOf<UFGItemDescriptor>, TArray<TSubclassOf<UFGRecipe>>> UnlockedRecipesMap;
+	TMap<TSubclassOf<UFGItemDescriptor>, TArray<TSubclassOf<UFGRecipe>>> AllRecipesMap;
+
+	// Fills the item lists & recipe maps from the index (before publishing)
+	void RegisterRecipes();
+
+	// Memory (heap bytes of the item lists & recipe maps, the index counts its own)
+	SIZE_T GetRecipeMapsAllocatedSize() const;
+};
+
+using FFicsitPlannerRecipeDatasetRef = TSharedRef<const FFicsitPlannerRecipeDataset, ESPMode::ThreadSafe>;
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FGRecipe.h"
+
+class IFicsitPlannerRecipeSource;
+
+/**
+ * Item flow of a compiled recipe, in items per minute at a multiplier of 1.
+ */
+struct FICSITPLANNER_API FFicsitPlannerItemRate
+{
+	int32 Item = INDEX_NONE;
+	float Rate = 0.0f;
+};
+
+/**
+ * Compiled item.
+ */
+struct FICSITPLANNER_API FFicsitPlannerItemData
+{
+	// Class, or nullptr when compiled from exported data outside the game
+	TSubclassOf<UFGItemDescriptor> Class;
+	FString Path;
+	FString Name;
+
+	// Liquid or gas (carried by pipes, amounts in liters)
+	bool bFluid = false;
+};
+
+/**
+ * Compiled recipe, with ingredients and products resolved to item indices.
+ */
+struct FICSITPLANNER_API FFicsitPlannerRecipeData
+{
+	// Class, or nullptr when compiled from exported data outside the game
+	TSubclassOf<UFGRecipe> Class;
+	FString Path;
+	FString Name;
+	TArray<FFicsitPlannerItemRate> Ingredients;
+	TArray<FFicsitPlannerItemRate> Products;
+
+	// Power consumption at a multiplier of 1 (MW)
+	float Power = 0.0f;
+
+	// Building producing it (index into the building table), INDEX_NONE if unknown
+	int32 Building = INDEX_NONE;
+};
+
+/**
+ * Items, recipes & buildings the planner must not use, by class name (e.g. "Desc_SAM_C") or full class path.
+ * Excluding an item excludes every recipe consuming or producing it, excluding a building every recipe made in it.
+ */
+struct FICSITPLANNER_API FFicsitPlannerExclusionRules
+{
+	TArray<FString> Items;
+	TArray<FString> Recipes;
+	TArray<FString> Buildings;
+};
+
+/**
+ * Why a recipe was pruned from an item's alternatives at load time.
+ */
+enum class EFicsitPlannerPruneReason : uint8
+{
+	// An ingredient can never be obtained in this lock mode
+	DeadEnd,
+
+	// Another recipe for the same item is at least as good on every metric, per unit of output
+	Dominated,
+};
+
+/**
+ * Recipe removed from an item's alternatives, kept for diagnostics.
+ */
+struct FICSITPLANNER_API FFicsitPlannerPrunedRecipe
+{
+	int32 Item = INDEX_NONE;
+	int32 Recipe = INDEX_NONE;
+	EFicsitPlannerPruneReason Reason = EFicsitPlannerPruneReason::DeadEnd;
+
+	// Unobtainable ingredient (dead ends) or dominating recipe (dominated)
+	int32 Cause = INDEX_NONE;
+};
+
+/**
+ * Steady-state solution of a closed set of recipes inside a cyclic component, normalized to 1 / min of the target item.
+ * Every item of the component consumed by the set is balanced within it; only Inputs cross the component boundary.
+ * Recipes[0] is the recipe producing the target item.
+ */
+struct FICSITPLANNER_API FFicsitPlannerLoopSolution
+{
+	int32 TargetItem = INDEX_NONE;
+	TArray<int32> Recipes;
+	TArray<float> Multipliers;
+	TArray<FFicsitPlannerItemRate> Inputs;
+	TArray<FFicsitPlannerItemRate> Byproducts;
+};
+
+/**
+ * Optimal cost of producing 1 / min of an item, inputs included (following the planner's rules, with no visited recipes).
+ * Power is linear in the rate, so the least power & the recipe / loop reaching it hold for any rate.
+ * Complexity isn't (whole buildings, fixed cost per recipe), so only lower bounds are kept for it:
+ * Complexity(Rate) >= RECIPE_COMPLEXITY * RecipesRun + BUILDING_COMPLEXITY * Buildings * Rate.
+ */
+struct FICSITPLANNER_API FFicsitPlannerUnitCost
+{
+	// Least power (MW), and its recipe or loop (both INDEX_NONE for leaf inputs)
+	float Power = 0.0f;
+	int32 PowerRecipe = INDEX_NONE;
+	int32 PowerLoop = INDEX_NONE;
+
+	// Fewest buildings (fractional) & fewest recipes run
+	float Buildings = 0.0f;
+	int32 RecipesRun = 0;
+
+	// Fewest raw resources (items / min, leaf inputs count as raw)
+	float RawInputs = 0.0f;
+
+	// False if the least-power alternative reaches a cycle without solved loops (the planner cuts it where recipes repeat, so its power is a lower bound only)
+	bool bExact = true;
+};
+
+/**
+ * Recipe graph for one lock mode (unlocked recipes only, or all recipes).
+ * Items are split into strongly connected components; loops inside cyclic components are pre-solved.
+ * The all-recipes graph only depends on the tables & exclusion masks, so it is shared by every world with the same ones.
+ */
+struct FICSITPLANNER_API FFicsitPlannerRecipeGraph
+{
+	// Item -> recipes producing it (pruned recipes excluded)
+	TArray<TArray<int32>> Producers;
+
+	// Item -> whether it can be obtained at all (raw resource, or a recipe that can complete)
+	TArray<bool> ObtainableItems;
+
+	// Recipes removed from Producers, and why
+	TArray<FFicsitPlannerPrunedRecipe> PrunedRecipes;
+
+	// Item -> strongly connected component
+	TArray<int32> ItemComponents;
+
+	// Component -> whether it contains a loop
+	TArray<bool> CyclicComponents;
+
+	// Component -> recipes its items can run, directly or through their inputs (so visited recipes outside it can't change its plans)
+	TArray<TBitArray<>> ComponentRecipes;
+
+	// Item -> loop solutions producing it (only for items in cyclic components)
+	TArray<TArray<FFicsitPlannerLoopSolution>> Loops;
+
+	// Item -> optimal cost of 1 / min (bottom-up over components, ingredients first)
+	TArray<FFicsitPlannerUnitCost> UnitCosts;
+
+	// Memory
+	SIZE_T GetAllocatedSize() const;
+};
+
+using FFicsitPlannerRecipeGraphRef = TSharedRef<const FFicsitPlannerRecipeGraph, ESPMode::ThreadSafe>;
+
+/**
+ * Compiled recipe tables (items, recipes with their rates & power, buildings), never modified once compiled.
+ * The same for every world loading the same recipes, so they are shared process-wide (see FFicsitPlannerRecipeIndex::LoadSharedTables).
+ */
+struct FICSITPLANNER_API FFicsitPlannerRecipeTables
+{
+	TArray<FFicsitPlannerItemData> Items;
+	TArray<FFicsitPlannerRecipeData> Recipes;
+	TArray<bool> RawItems;
+	TMap<FString, int32> ItemPathIds;
+	TMap<TSubclassOf<UFGItemDescriptor>, int32> ItemIds;
+	TMap<TSubclassOf<UFGRecipe>, int32> RecipeIds;
+	TArray<FString> BuildingPaths;
+	TMap<FString, int32> BuildingIds;
+
+	// Interning (while compiling)
+	int32 AddItem(FFicsitPlannerItemData&& Item);
+	int32 AddRecipe(FFicsitPlannerRecipeData&& Recipe);
+	int32 AddBuilding(const FString& Path);
+
+	// Memory
+	SIZE_T GetAllocatedSize() const;
+};
+
+using FFicsitPlannerRecipeTablesRef = TSharedRef<const FFicsitPlannerRecipeTables, ESPMode::ThreadSafe>;
+
+/**
+ * Compiled recipe data (rates, power, graph analysis), used by the planner instead of the recipe CDOs.
+ * Compiled from a recipe source (game CDOs or exported JSON), or loaded from an on-disk snapshot, in ReloadGameData.
+ * The recipe tables & all-recipes graph are shared (copying an index only copies its unlock mask, exclusion masks & unlocked graph).
+ */
+class FICSITPLANNER_API FFicsitPlannerRecipeIndex
+{
+public:
+	// Limits for loop solving (recipes per loop, solutions kept per item)
+	static constexpr int32 MAX_LOOP_RECIPES = 4;
+	static constexpr int32 MAX_LOOP_SOLUTIONS = 16;
+
+	// Snapshot format version (bump when the layout or compiled data changes)
+	static constexpr uint32 SNAPSHOT_VERSION = 3;
+
+	// Compile / Reset (compiling keeps the source's unlocked recipes, call BuildGraphs or SetUnlockedRecipes afterwards)
+	bool Compile(const IFicsitPlannerRecipeSource& Source);
+	void SetUnlockedRecipes(const TArray<TSubclassOf<UFGRecipe>>& UnlockedRecipes);
+	void BuildGraphs();
+	void Reset();
+
+	// Exclusions (compiled into item & recipe masks over the compiled data, graphs are only rebuilt if the masks changed)
+	// Kept across Compile / LoadSnapshot, so changing a rule never needs the recipe CDOs; returns true if the graphs were rebuilt
+	bool SetExclusionRules(const FFicsitPlannerExclusionRules& Rules);
+	const FFicsitPlannerExclusionRules& GetExclusionRules() const { return ExclusionRules; }
+	bool IsItemExcluded(const int32 Item) const { return ExcludedItems[Item]; }
+	bool IsRecipeExcluded(const int32 Recipe) const { return ExcludedRecipes[Recipe]; }
+	int32 NumExcludedRecipes() const { return ExcludedRecipes.CountSetBits(); }
+
+	// Snapshots (compiled data only, unlocked recipes are applied afterwards)
+	static uint64 ComputeSnapshotHash(const TArray<TSubclassOf<UFGRecipe>>& LoadedRecipes);
+	bool SaveSnapshot(const FString& Path, uint64 Hash) const;
+	bool LoadSnapshot(const FString& Path, uint64 Hash);
+
+	// Process-wide tables (keyed by snapshot hash): other worlds & reloads reuse the tables compiled or loaded first
+	bool LoadSharedTables(uint64 Hash);
+	void ShareTables(uint64 Hash) const;
+	const FFicsitPlannerRecipeTablesRef& GetTables() const { return Tables; }
+
+	// Lookups
+	int32 FindItem(TSubclassOf<UFGItemDescriptor> Item) const;
+	int32 FindRecipe(TSubclassOf<UFGRecipe> Recipe) const;
+	int32 FindItemByPath(const FString& Path) const;
+	int32 FindItemByName(const FString& Name) const;
+	int32 NumItems() const { return Tables->Items.Num(); }
+	int32 NumRecipes() const { return Tables->Recipes.Num(); }
+	int32 NumBuildings() const { return Tables->BuildingPaths.Num(); }
+	const FFicsitPlannerItemData& GetItem(const int32 Item) const { return Tables->Items[Item]; }
+	TSubclassOf<UFGItemDescriptor> GetItemClass(const int32 Item) const { return Tables->Items[Item].Class; }
+	const FFicsitPlannerRecipeData& GetRecipe(const int32 Recipe) const { return Tables->Recipes[Recipe]; }
+	const FString& GetBuildingPath(const int32 Building) const { return Tables->BuildingPaths[Building]; }
+	bool IsRecipeUnlocked(const int32 Recipe) const { return UnlockedRecipes[Recipe]; }
+	float GetProductRate(int32 Recipe, int32 Item) const;
+	const FFicsitPlannerRecipeGraph& GetGraph(const bool bAllowLockedRecipes) const { return bAllowLockedRecipes ? *LockedGraph : UnlockedGraph; }
+
+	// Pruning queries
+	bool IsRawItem(const int32 Item) const { return Tables->RawItems[Item]; }
+	bool IsObtainable(bool bAllowLockedRecipes, int32 Item) const;
+	bool IsUsableRecipe(bool bAllowLockedRecipes, int32 Item, int32 Recipe) const;
+
+	// Loop queries
+	bool IsLoopItem(bool bAllowLockedRecipes, int32 Item) const;
+	bool ConsumesFromComponent(bool bAllowLockedRecipes, int32 Recipe, int32 Item) const;
+	int32 NumLoopSolutions(bool bAllowLockedRecipes) const;
+
+	// Unit cost queries
+	const FFicsitPlannerUnitCost& GetUnitCost(const bool bAllowLockedRecipes, const int32 Item) const { return GetGraph(bAllowLockedRecipes).UnitCosts[Item]; }
+
+	// Memory (heap bytes of the unlock & exclusion masks and the unlocked graph, plus the shared tables & all-recipes graph if bIncludeShared)
+	SIZE_T GetAllocatedSize(bool bIncludeShared = true) const;
+	SIZE_T GetSharedAllocatedSize() const;
+
+private:
+	// Compiled tables (shared), and this world's unlock flags over them
+	FFicsitPlannerRecipeTablesRef Tables = MakeShared<FFicsitPlannerRecipeTables, ESPMode::ThreadSafe>();
+	TArray<bool> UnlockedRecipes;
+
+	// Exclusion rules, and their masks over the compiled data
+	FFicsitPlannerExclusionRules ExclusionRules;
+	TBitArray<> ExcludedItems;
+	TBitArray<> ExcludedRecipes;
+
+	// Graphs: unlocked recipes only (this world's), and all recipes (shared, see BuildLockedGraph)
+	FFicsitPlannerRecipeGraph UnlockedGraph;
+	FFicsitPlannerRecipeGraphRef LockedGraph = MakeShared<FFicsitPlannerRecipeGraph, ESPMode::ThreadSafe>();
+
+	// Helpers
+	bool CompileExclusions();
+	void BuildGraph(FFicsitPlannerRecipeGraph& Graph, bool bAllowLockedRecipes) const;
+	void BuildLockedGraph();
+	void PruneRecipes(FFicsitPlannerRecipeGraph& Graph) const;
+	bool Dominates(int32 Recipe, int32 OtherRecipe, int32 Item) const;
+	void FindComponents(FFicsitPlannerRecipeGraph& Graph) const;
+	void SolveLoops(FFicsitPlannerRecipeGraph& Graph, int32 TargetItem) const;
+	void ComputeUnitCosts(FFicsitPlannerRecipeGraph& Graph) const;
+	void FindComponentRecipes(FFicsitPlannerRecipeGraph& Graph) const;
+	void EnumerateLoops(FFicsitPlannerRecipeGraph& Graph, int32 TargetItem, TArray<int32>& AssignedItems, TArray<int32>& ChosenRecipes) const;
+	bool EvaluateLoop(const TArray<int32>& AssignedItems, const TArray<int32>& ChosenRecipes, FFicsitPlannerLoopSolution& OutSolution) const;
+	static bool SolveLinearSystem(TArray<double>& Matrix, TArray<double>& Values, int32 Size);
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FGRecipe.h"
+
+class FFicsitPlannerRecipeIndex;
+
+/**
+ * Item as provided by a recipe source, identified by its class path.
+ */
+struct FICSITPLANNER_API FFicsitPlannerSourceItem
+{
+	FString Path;
+	FString Name;
+
+	// Raw resource (ores, water, ...), planned as an input instead of being produced
+	bool bResource = false;
+
+	// Liquid or gas (carried by pipes, amounts in liters)
+	bool bFluid = false;
+
+	// Class, or nullptr when the source has no game data loaded (exported data)
+	TSubclassOf<UFGItemDescriptor> Class;
+};
+
+/**
+ * Item flow of a source recipe, in items per minute at a multiplier of 1.
+ */
+struct FICSITPLANNER_API FFicsitPlannerSourceRate
+{
+	FString ItemPath;
+	float Rate = 0.0f;
+};
+
+/**
+ * Recipe as provided by a recipe source, with rates already converted to items per minute.
+ */
+struct FICSITPLANNER_API FFicsitPlannerSourceRecipe
+{
+	FString Path;
+	FString Name;
+	TArray<FFicsitPlannerSourceRate> Ingredients;
+	TArray<FFicsitPlannerSourceRate> Products;
+
+	// Power consumption at a multiplier of 1 (MW)
+	float Power = 0.0f;
+
+	// Class path of the building producing it (empty if unknown)
+	FString BuildingPath;
+
+	// Unlocked when the data was gathered
+	bool bUnlocked = false;
+
+	// Class, or nullptr when the source has no game data loaded (exported data)
+	TSubclassOf<UFGRecipe> Class;
+};
+
+/**
+ * Where the planner gets its recipe data from.
+ * The recipe index is compiled from a source, so the planner core doesn't depend on recipe CDOs or the recipe manager.
+ */
+class FICSITPLANNER_API IFicsitPlannerRecipeSource
+{
+public:
+	virtual ~IFicsitPlannerRecipeSource() = default;
+
+	// Fills every item & recipe the planner may use, returns false if the data couldn't be loaded
+	virtual bool LoadRecipes(TArray<FFicsitPlannerSourceItem>& OutItems, TArray<FFicsitPlannerSourceRecipe>& OutRecipes) const = 0;
+};
+
+/**
+ * Recipe source reading the recipe CDOs of a running game.
+ * Recipes should already be produced in a building (see AFicsitPlannerEngine::ReloadGameData), exclusions are applied by the index.
+ */
+class FICSITPLANNER_API FFicsitPlannerGameRecipeSource : public IFicsitPlannerRecipeSource
+{
+public:
+	FFicsitPlannerGameRecipeSource(const TArray<TSubclassOf<UFGRecipe>>& InRecipes, const TArray<TSubclassOf<UFGRecipe>>& InUnlockedRecipes);
+
+	virtual bool LoadRecipes(TArray<FFicsitPlannerSourceItem>& OutItems, TArray<FFicsitPlannerSourceRecipe>& OutRecipes) const override;
+
+private:
+	const TArray<TSubclassOf<UFGRecipe>>& Recipes;
+	const TArray<TSubclassOf<UFGRecipe>>& UnlockedRecipes;
+};
+
+/**
+ * Recipe source reading game data exported to JSON (see AFicsitPlannerEngine::ExportGameData).
+ * Used to plan outside the game, e.g. with the FicsitPlanner commandlet.
+ */
+class FICSITPLANNER_API FFicsitPlannerJsonRecipeSource : public IFicsitPlannerRecipeSource
+{
+public:
+	// Export format version (bump when the layout changes)
+	static constexpr int32 JSON_VERSION = 1;
+
+	explicit FFicsitPlannerJsonRecipeSource(const FString& InPath);
+
+	virtual bool LoadRecipes(TArray<FFicsitPlannerSourceItem>& OutItems, TArray<FFicsitPlannerSourceRecipe>& OutRecipes) const override;
+
+	// Writes a compiled index to the export format (unlocked recipes included)
+	static bool SaveIndex(const FFicsitPlannerRecipeIndex& Index, const FString& Path);
+
+private:
+	FString Path;
+};